@@ -0,0 +1,198 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+// Persistent order statistic treap. Nodes are immutable once constructed and shared between versions of the tree,
+// modifications copy only the O(log N) nodes on the search path and return a new root. Node lifetime is managed with
+// reference counting, so a node is reclaimed as soon as the last version that contains it is dropped. Nothing reachable
+// from a root ever changes, so a version is traversed wait-free once a reference to its root is held.
+
+namespace throttle {
+namespace detail {
+
+template <typename t_value_type_> struct persistent_treap_node_ {
+  using node_type_ = persistent_treap_node_<t_value_type_>;
+  using node_ptr_ = std::shared_ptr<const node_type_>;
+  using size_type = std::size_t;
+  using priority_type_ = std::uint32_t;
+
+  t_value_type_ m_value_;
+  priority_type_ m_priority_;
+  size_type m_size_;
+  node_ptr_ m_left_;
+  node_ptr_ m_right_;
+
+  persistent_treap_node_(const t_value_type_ &p_value, priority_type_ p_priority, node_ptr_ p_left, node_ptr_ p_right)
+      : m_value_{p_value}, m_priority_{p_priority}, m_size_{size(p_left) + size(p_right) + 1},
+        m_left_{std::move(p_left)}, m_right_{std::move(p_right)} {}
+
+  static size_type size(const node_ptr_ &p_x) noexcept { return (p_x ? p_x->m_size_ : 0); }
+};
+
+template <typename t_value_type, typename t_comp> class persistent_treap_ {
+public:
+  using node_type_ = persistent_treap_node_<t_value_type>;
+  using node_ptr_ = typename node_type_::node_ptr_;
+  using size_type = typename node_type_::size_type;
+  using priority_type_ = typename node_type_::priority_type_;
+
+private:
+  static node_ptr_ make_node_(const t_value_type &p_value, priority_type_ p_priority, node_ptr_ p_left,
+                              node_ptr_ p_right) {
+    return std::make_shared<const node_type_>(p_value, p_priority, std::move(p_left), std::move(p_right));
+  }
+
+  static node_ptr_ copy_with_children_(const node_ptr_ &p_n, node_ptr_ p_left, node_ptr_ p_right) {
+    return make_node_(p_n->m_value_, p_n->m_priority_, std::move(p_left), std::move(p_right));
+  }
+
+  static priority_type_ random_priority_() {
+    thread_local std::minstd_rand gen{std::random_device{}()};
+    return static_cast<priority_type_>(gen());
+  }
+
+  // Split a tree into elements less than p_key and elements not less than p_key.
+  static std::pair<node_ptr_, node_ptr_> split_(const node_ptr_ &p_n, const t_value_type &p_key) {
+    if (!p_n) return {nullptr, nullptr};
+
+    if (t_comp{}(p_n->m_value_, p_key)) {
+      auto [left, right] = split_(p_n->m_right_, p_key);
+      return {copy_with_children_(p_n, p_n->m_left_, std::move(left)), std::move(right)};
+    }
+
+    auto [left, right] = split_(p_n->m_left_, p_key);
+    return {std::move(left), copy_with_children_(p_n, std::move(right), p_n->m_right_)};
+  }
+
+  // Merge two trees, where every element of p_left is less than every element of p_right.
+  static node_ptr_ merge_(const node_ptr_ &p_left, const node_ptr_ &p_right) {
+    if (!p_left) return p_right;
+    if (!p_right) return p_left;
+
+    if (p_left->m_priority_ > p_right->m_priority_) {
+      return copy_with_children_(p_left, p_left->m_left_, merge_(p_left->m_right_, p_right));
+    }
+
+    return copy_with_children_(p_right, merge_(p_left, p_right->m_left_), p_right->m_right_);
+  }
+
+  static node_ptr_ insert_impl_(const node_ptr_ &p_n, const t_value_type &p_key, priority_type_ p_priority) {
+    if (!p_n || p_n->m_priority_ < p_priority) {
+      if (contains(p_n, p_key)) throw std::out_of_range("Double insert");
+      auto [left, right] = split_(p_n, p_key);
+      return make_node_(p_key, p_priority, std::move(left), std::move(right));
+    }
+
+    if (t_comp{}(p_key, p_n->m_value_)) {
+      return copy_with_children_(p_n, insert_impl_(p_n->m_left_, p_key, p_priority), p_n->m_right_);
+    } else if (t_comp{}(p_n->m_value_, p_key)) {
+      return copy_with_children_(p_n, p_n->m_left_, insert_impl_(p_n->m_right_, p_key, p_priority));
+    }
+
+    throw std::out_of_range("Double insert");
+  }
+
+public:
+  static bool contains(const node_ptr_ &p_n, const t_value_type &p_key) noexcept {
+    const node_type_ *curr = p_n.get();
+    while (curr) {
+      if (t_comp{}(p_key, curr->m_value_)) {
+        curr = curr->m_left_.get();
+      } else if (t_comp{}(curr->m_value_, p_key)) {
+        curr = curr->m_right_.get();
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static node_ptr_ insert(const node_ptr_ &p_root, const t_value_type &p_key) {
+    return insert_impl_(p_root, p_key, random_priority_());
+  }
+
+  static node_ptr_ erase(const node_ptr_ &p_n, const t_value_type &p_key) {
+    if (!p_n) throw std::out_of_range("Can't erase element a non-present element");
+
+    if (t_comp{}(p_key, p_n->m_value_)) {
+      return copy_with_children_(p_n, erase(p_n->m_left_, p_key), p_n->m_right_);
+    } else if (t_comp{}(p_n->m_value_, p_key)) {
+      return copy_with_children_(p_n, p_n->m_left_, erase(p_n->m_right_, p_key));
+    }
+
+    return merge_(p_n->m_left_, p_n->m_right_);
+  }
+
+  static const t_value_type &select_rank(const node_ptr_ &p_root, size_type p_rank) {
+    if (p_rank > node_type_::size(p_root) || !(p_rank > 0)) {
+      throw std::out_of_range("Rank is greater than size or is zero");
+    }
+
+    const node_type_ *curr = p_root.get();
+    size_type r = node_type_::size(curr->m_left_) + 1;
+    while (r != p_rank) {
+      if (p_rank < r) {
+        curr = curr->m_left_.get();
+      } else {
+        curr = curr->m_right_.get();
+        p_rank -= r;
+      }
+      r = node_type_::size(curr->m_left_) + 1;
+    }
+
+    return curr->m_value_;
+  }
+
+  // There are no parent pointers, so the rank is accumulated on the way down.
+  static size_type get_rank_of(const node_ptr_ &p_root, const t_value_type &p_elem) {
+    const node_type_ *curr = p_root.get();
+    size_type rank = 0;
+
+    while (curr) {
+      if (t_comp{}(p_elem, curr->m_value_)) {
+        curr = curr->m_left_.get();
+      } else if (t_comp{}(curr->m_value_, p_elem)) {
+        rank += node_type_::size(curr->m_left_) + 1;
+        curr = curr->m_right_.get();
+      } else {
+        return rank + node_type_::size(curr->m_left_) + 1;
+      }
+    }
+
+    throw std::out_of_range("Element not present");
+  }
+
+  static const t_value_type &min(const node_ptr_ &p_root) {
+    if (!p_root) throw std::out_of_range("Container is empty");
+    const node_type_ *curr = p_root.get();
+    while (curr->m_left_)
+      curr = curr->m_left_.get();
+    return curr->m_value_;
+  }
+
+  static const t_value_type &max(const node_ptr_ &p_root) {
+    if (!p_root) throw std::out_of_range("Container is empty");
+    const node_type_ *curr = p_root.get();
+    while (curr->m_right_)
+      curr = curr->m_right_.get();
+    return curr->m_value_;
+  }
+};
+
+} // namespace detail
+} // namespace throttle
@@ -18,6 +18,8 @@
 #include <tuple>
 #include <type_traits>
 
+#include "monoid.hpp"
+
 namespace throttle {
 namespace detail {
 enum rb_tree_ranged_color_ { k_black_, k_red_ };
@@ -87,15 +89,24 @@ struct rb_tree_ranged_node_base_ {
   }
 };
 
-template <typename t_value_type_> struct rb_tree_ranged_node_ : public rb_tree_ranged_node_base_ {
-  using node_type_ = rb_tree_ranged_node_<t_value_type_>;
+// Monoid aggregate of a subtree. Size is already stored in the base node, so the default augmentation takes no space.
+template <typename t_monoid_> struct rb_tree_ranged_aggregate_ {
+  typename t_monoid_::value_type m_value_;
+};
+
+template <typename T> struct rb_tree_ranged_aggregate_<size_monoid<T>> {};
+
+template <typename t_value_type_, typename t_monoid_ = size_monoid<t_value_type_>>
+struct rb_tree_ranged_node_ : public rb_tree_ranged_node_base_ {
+  using node_type_ = rb_tree_ranged_node_<t_value_type_, t_monoid_>;
   using node_ptr_ = node_type_ *;
   using const_node_ptr_ = const node_type_ *;
 
   t_value_type_ m_value_;
+  [[no_unique_address]] rb_tree_ranged_aggregate_<t_monoid_> m_aggregate_;
 
   rb_tree_ranged_node_(const t_value_type_ &p_key)
-      : rb_tree_ranged_node_base_{k_red_, 1, nullptr, nullptr, nullptr}, m_value_{p_key} {};
+      : rb_tree_ranged_node_base_{k_red_, 1, nullptr, nullptr, nullptr}, m_value_{p_key}, m_aggregate_{} {};
 };
 
 class rb_tree_ranged_impl_ {
@@ -104,9 +115,12 @@ public:
   using const_base_ptr_ = rb_tree_ranged_node_base_ ::const_base_ptr_;
   using link_type_ = rb_tree_ranged_node_base_;
   using size_type = rb_tree_ranged_node_base_::size_type;
+  using augment_hook_ = void (*)(base_ptr_) noexcept;
 
 protected:
   base_ptr_ m_root_;
+  // Recomputes monoid aggregate of a node from its children after a rotation. Null when only sizes are maintained.
+  augment_hook_ m_augment_;
 
   void rotate_left_(base_ptr_) noexcept;
   void rotate_right_(base_ptr_) noexcept;
@@ -118,26 +132,66 @@ protected:
   base_ptr_ successor_for_erase_(base_ptr_) noexcept;
   base_ptr_ predecessor_for_erase_(base_ptr_) noexcept;
 
-  rb_tree_ranged_impl_() : m_root_{} {}
+  rb_tree_ranged_impl_(augment_hook_ p_augment = nullptr) : m_root_{}, m_augment_{p_augment} {}
 };
 
-template <typename t_value_type, typename t_comp> class rb_tree_ranged_ : public rb_tree_ranged_impl_ {
+template <typename t_value_type, typename t_comp, typename t_monoid = size_monoid<t_value_type>>
+class rb_tree_ranged_ : public rb_tree_ranged_impl_ {
 private:
   static_assert(std::is_swappable_v<t_value_type>, "t_value_type must be swappable");
 
-  using node_type_ = rb_tree_ranged_node_<t_value_type>;
+  using node_type_ = rb_tree_ranged_node_<t_value_type, t_monoid>;
   using node_ptr_ = typename node_type_::node_ptr_;
   using const_node_ptr_ = typename node_type_::const_node_ptr_;
 
-  using self_type_ = rb_tree_ranged_<t_value_type, t_comp>;
+  using self_type_ = rb_tree_ranged_<t_value_type, t_comp, t_monoid>;
   using const_self_type_ = const self_type_;
 
+  static constexpr bool is_size_augmented_ = std::is_same_v<t_monoid, size_monoid<t_value_type>>;
+
+public:
+  using aggregate_type = typename t_monoid::value_type;
+
 public:
   bool empty() const noexcept { return !m_root_; }
   size_type size() const noexcept { return (m_root_ ? m_root_->m_size_ : 0); }
   bool contains(const t_value_type &p_key) const noexcept { return bst_lookup(p_key); }
 
 private:
+  static aggregate_type aggregate_(const_base_ptr_ p_n) noexcept {
+    if (!p_n) return t_monoid::identity();
+    if constexpr (is_size_augmented_) {
+      return p_n->m_size_;
+    } else {
+      return static_cast<const_node_ptr_>(p_n)->m_aggregate_.m_value_;
+    }
+  }
+
+  static void update_aggregate_(base_ptr_ p_n) noexcept {
+    if constexpr (!is_size_augmented_) {
+      static_cast<node_ptr_>(p_n)->m_aggregate_.m_value_ = t_monoid::combine(
+          t_monoid::combine(aggregate_(p_n->m_left_), t_monoid::lift(static_cast<node_ptr_>(p_n)->m_value_)),
+          aggregate_(p_n->m_right_));
+    }
+  }
+
+  // Recompute aggregates on the path from p_n to the root after the set of values in its subtree has changed.
+  static void update_path_aggregates_(base_ptr_ p_n) noexcept {
+    if constexpr (!is_size_augmented_) {
+      for (; p_n; p_n = p_n->m_parent_) {
+        update_aggregate_(p_n);
+      }
+    }
+  }
+
+  static augment_hook_ get_augment_hook_() noexcept {
+    if constexpr (is_size_augmented_) {
+      return nullptr;
+    } else {
+      return &update_aggregate_;
+    }
+  }
+
   void prune_leaf(node_ptr_ p_n) {
     if (!p_n->m_parent_) {
       m_root_ = nullptr;
@@ -328,10 +382,12 @@ private:
 public:
   using value_type = t_value_type;
   using comp = t_comp;
+  using monoid_type = t_monoid;
   using size_type = typename node_type_::size_type;
 
   void insert(const t_value_type &p_key) {
     node_ptr_ leaf = bst_insert(p_key);
+    update_path_aggregates_(leaf);
     rebalance_after_insert_(leaf);
   }
 
@@ -347,7 +403,10 @@ public:
     leaf->m_size_ = 0;
     rebalance_after_erase_(leaf);
 
+    // Rotations keep aggregates of nodes outside of the path to the leaf valid, so only this path has to be updated.
+    base_ptr_ parent = leaf->m_parent_;
     prune_leaf(leaf);
+    update_path_aggregates_(parent);
   }
 
   void clear() noexcept {
@@ -441,6 +500,53 @@ public:
     return rank;
   }
 
+  // Combine monoid values of all elements in [p_first, p_second] in O(log N). Descend to the node where search paths
+  // for the bounds split, then collect whole subtrees hanging inside of the range along the two boundary paths.
+  aggregate_type range_aggregate(const t_value_type &p_first, const t_value_type &p_second) const {
+    if (t_comp{}(p_second, p_first)) return t_monoid::identity();
+
+    const_base_ptr_ split = m_root_;
+    while (split) {
+      const t_value_type &val = static_cast<const_node_ptr_>(split)->m_value_;
+      if (t_comp{}(val, p_first)) {
+        split = split->m_right_;
+      } else if (t_comp{}(p_second, val)) {
+        split = split->m_left_;
+      } else {
+        break;
+      }
+    }
+
+    if (!split) return t_monoid::identity();
+
+    aggregate_type left = t_monoid::identity();
+    for (const_base_ptr_ curr = split->m_left_; curr;) {
+      if (t_comp{}(static_cast<const_node_ptr_>(curr)->m_value_, p_first)) {
+        curr = curr->m_right_;
+      } else {
+        left = t_monoid::combine(
+            t_monoid::combine(t_monoid::lift(static_cast<const_node_ptr_>(curr)->m_value_), aggregate_(curr->m_right_)),
+            left);
+        curr = curr->m_left_;
+      }
+    }
+
+    aggregate_type right = t_monoid::identity();
+    for (const_base_ptr_ curr = split->m_right_; curr;) {
+      if (t_comp{}(p_second, static_cast<const_node_ptr_>(curr)->m_value_)) {
+        curr = curr->m_left_;
+      } else {
+        right = t_monoid::combine(
+            right,
+            t_monoid::combine(aggregate_(curr->m_left_), t_monoid::lift(static_cast<const_node_ptr_>(curr)->m_value_)));
+        curr = curr->m_right_;
+      }
+    }
+
+    return t_monoid::combine(t_monoid::combine(left, t_monoid::lift(static_cast<const_node_ptr_>(split)->m_value_)),
+                             right);
+  }
+
   const t_value_type &min() const {
     if (!m_root_) throw std::out_of_range("Container is empty");
     return static_cast<node_ptr_>(m_root_->minimum_())->m_value_;
@@ -451,10 +557,10 @@ public:
     return static_cast<node_ptr_>(m_root_->maximum_())->m_value_;
   }
 
-  rb_tree_ranged_() : rb_tree_ranged_impl_{} {}
+  rb_tree_ranged_() : rb_tree_ranged_impl_{get_augment_hook_()} {}
   ~rb_tree_ranged_() { clear(); }
 
-  rb_tree_ranged_(const_self_type_ &p_rhs) {
+  rb_tree_ranged_(const_self_type_ &p_rhs) : rb_tree_ranged_impl_{get_augment_hook_()} {
     self_type_ temp{};
     traverse_postorder(static_cast<const_node_ptr_>(p_rhs.m_root_),
                        [&](const_base_ptr_ p_n) { temp.insert(static_cast<const_node_ptr_>(p_n)->m_value_); });
@@ -469,7 +575,7 @@ public:
     return *this;
   }
 
-  rb_tree_ranged_(self_type_ &&p_rhs) noexcept {
+  rb_tree_ranged_(self_type_ &&p_rhs) noexcept : rb_tree_ranged_impl_{get_augment_hook_()} {
     m_root_ = p_rhs.m_root_;
     p_rhs.m_root_ = nullptr;
   }
@@ -0,0 +1,67 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+// Monoids that can be used to augment order statistic trees. Every node stores the combination of values in its subtree,
+// so that an aggregate over any key range can be computed in O(log N). A monoid policy should provide:
+//   value_type                         - type of the aggregate;
+//   identity()                         - neutral element, aggregate of an empty subtree;
+//   lift(const T &)                    - aggregate of a single element;
+//   combine(value_type, value_type)    - associative operation. Left operand always holds smaller keys.
+
+namespace throttle {
+
+// Default augmentation. Aggregate of a subtree is its size, which trees keep anyway for rank operations.
+template <typename T> struct size_monoid {
+  using value_type = std::size_t;
+
+  static value_type identity() noexcept { return 0; }
+
+  static value_type lift(const T &) noexcept { return 1; }
+
+  static value_type combine(value_type p_lhs, value_type p_rhs) noexcept { return p_lhs + p_rhs; }
+};
+
+template <typename T, typename t_result = T> struct sum_monoid {
+  using value_type = t_result;
+
+  static value_type identity() noexcept { return value_type{}; }
+
+  static value_type lift(const T &p_val) noexcept { return value_type{p_val}; }
+
+  static value_type combine(value_type p_lhs, value_type p_rhs) noexcept { return p_lhs + p_rhs; }
+};
+
+template <typename T> struct min_monoid {
+  using value_type = T;
+
+  static value_type identity() noexcept { return std::numeric_limits<T>::max(); }
+
+  static value_type lift(const T &p_val) noexcept { return p_val; }
+
+  static value_type combine(value_type p_lhs, value_type p_rhs) noexcept { return std::min(p_lhs, p_rhs); }
+};
+
+template <typename T> struct max_monoid {
+  using value_type = T;
+
+  static value_type identity() noexcept { return std::numeric_limits<T>::lowest(); }
+
+  static value_type lift(const T &p_val) noexcept { return p_val; }
+
+  static value_type combine(value_type p_lhs, value_type p_rhs) noexcept { return std::max(p_lhs, p_rhs); }
+};
+
+} // namespace throttle
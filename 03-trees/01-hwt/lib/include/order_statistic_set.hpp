@@ -9,18 +9,19 @@
  */
 
 #include "detail/rb_tree_ranged.hpp"
+#include "monoid.hpp"
 #include <functional>
 #include <initializer_list>
 
 namespace throttle {
-template <typename T, typename t_comp = std::less<T>>
-class order_statistic_set : public detail::rb_tree_ranged_<T, t_comp> {
+template <typename T, typename t_comp = std::less<T>, typename t_monoid = size_monoid<T>>
+class order_statistic_set : public detail::rb_tree_ranged_<T, t_comp, t_monoid> {
 public:
-  order_statistic_set() : detail::rb_tree_ranged_<T, t_comp>{} {
+  order_statistic_set() : detail::rb_tree_ranged_<T, t_comp, t_monoid>{} {
 
   }
 
-  order_statistic_set(std::initializer_list<T> p_list) : detail::rb_tree_ranged_<T, t_comp>{} {
+  order_statistic_set(std::initializer_list<T> p_list) : detail::rb_tree_ranged_<T, t_comp, t_monoid>{} {
     this->insert_range(p_list.begin(), p_list.end());
   }
 };
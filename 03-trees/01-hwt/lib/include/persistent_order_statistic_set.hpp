@@ -0,0 +1,108 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "detail/persistent_treap.hpp"
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+
+namespace throttle {
+
+// Order statistic set for read-mostly workloads. Every modification builds a new version of the tree by path-copying
+// and publishes its root with a single atomic store. A reader takes a snapshot, which is an immutable version of the
+// set that stays valid and unchanged for as long as the reader holds it, and traverses it wait-free. Acquiring a
+// snapshot isn't lock-free: std::atomic<std::shared_ptr> in libstdc++ guards the root with a short internal lock, held
+// only while the reference count is copied, so readers can briefly wait for writers publishing a root.
+template <typename T, typename t_comp = std::less<T>> class persistent_order_statistic_set {
+private:
+  using tree_ = detail::persistent_treap_<T, t_comp>;
+  using node_ptr_ = typename tree_::node_ptr_;
+
+public:
+  using value_type = T;
+  using comp = t_comp;
+  using size_type = typename tree_::size_type;
+
+  class snapshot {
+    friend class persistent_order_statistic_set<T, t_comp>;
+    node_ptr_ m_root_;
+
+    snapshot(node_ptr_ p_root) : m_root_{std::move(p_root)} {}
+
+  public:
+    snapshot() : m_root_{} {}
+
+    bool empty() const noexcept { return !m_root_; }
+    size_type size() const noexcept { return tree_::node_type_::size(m_root_); }
+    bool contains(const T &p_key) const noexcept { return tree_::contains(m_root_, p_key); }
+
+    const T &select_rank(size_type p_rank) const { return tree_::select_rank(m_root_, p_rank); }
+    size_type get_rank_of(const T &p_elem) const { return tree_::get_rank_of(m_root_, p_elem); }
+
+    const T &min() const { return tree_::min(m_root_); }
+    const T &max() const { return tree_::max(m_root_); }
+  };
+
+private:
+  std::atomic<node_ptr_> m_root_;
+
+  // Writers race on the published root with compare-and-swap. If another writer got ahead, the update is rebuilt on
+  // top of the new version. A failed update throws before anything is published.
+  template <typename F> void update(F p_modify) {
+    node_ptr_ expected = m_root_.load(std::memory_order_acquire);
+    node_ptr_ desired = p_modify(expected);
+    while (!m_root_.compare_exchange_weak(expected, desired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      desired = p_modify(expected);
+    }
+  }
+
+public:
+  persistent_order_statistic_set() : m_root_{} {}
+
+  persistent_order_statistic_set(std::initializer_list<T> p_list) : m_root_{} {
+    for (const auto &v : p_list) {
+      insert(v);
+    }
+  }
+
+  // Copying shares all nodes with the original, it's O(1).
+  persistent_order_statistic_set(const persistent_order_statistic_set &p_rhs)
+      : m_root_{p_rhs.m_root_.load(std::memory_order_acquire)} {}
+
+  persistent_order_statistic_set &operator=(const persistent_order_statistic_set &p_rhs) {
+    m_root_.store(p_rhs.m_root_.load(std::memory_order_acquire), std::memory_order_release);
+    return *this;
+  }
+
+  snapshot get_snapshot() const { return snapshot{m_root_.load(std::memory_order_acquire)}; }
+
+  void insert(const T &p_key) {
+    update([&p_key](const node_ptr_ &p_root) { return tree_::insert(p_root, p_key); });
+  }
+
+  void erase(const T &p_key) {
+    update([&p_key](const node_ptr_ &p_root) { return tree_::erase(p_root, p_key); });
+  }
+
+  void clear() { m_root_.store(nullptr, std::memory_order_release); }
+
+  // Convenience selectors that operate on the latest published version.
+  bool empty() const { return get_snapshot().empty(); }
+  size_type size() const { return get_snapshot().size(); }
+  bool contains(const T &p_key) const { return get_snapshot().contains(p_key); }
+
+  T select_rank(size_type p_rank) const { return get_snapshot().select_rank(p_rank); }
+  size_type get_rank_of(const T &p_elem) const { return get_snapshot().get_rank_of(p_elem); }
+};
+
+} // namespace throttle
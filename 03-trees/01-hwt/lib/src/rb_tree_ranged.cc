@@ -40,6 +40,11 @@ void rb_tree_ranged_impl_::rotate_left_(base_ptr_ p_n) noexcept {
 
   rchild->m_size_ = root->m_size_;
   root->m_size_ = link_type_::size(root->m_left_) + link_type_::size(root->m_right_) + 1;
+
+  if (m_augment_) {
+    m_augment_(root);
+    m_augment_(rchild);
+  }
 }
 
 void rb_tree_ranged_impl_::rotate_right_(base_ptr_ p_n) noexcept {
@@ -65,6 +70,11 @@ void rb_tree_ranged_impl_::rotate_right_(base_ptr_ p_n) noexcept {
 
   lchild->m_size_ = root->m_size_;
   root->m_size_ = link_type_::size(root->m_left_) + link_type_::size(root->m_right_) + 1;
+
+  if (m_augment_) {
+    m_augment_(root);
+    m_augment_(lchild);
+  }
 }
 
 void rb_tree_ranged_impl_::rotate_to_parent_(base_ptr_ p_n) noexcept {
@@ -114,9 +124,10 @@ void rb_tree_ranged_impl_::rebalance_after_erase_(base_ptr_ p_leaf) noexcept {
       continue;
     }
 
-    // Nephew is the right child of a sibling
-    // Niece is the left child of a sibling
-    base_ptr_ nephew = (sibling ? sibling->m_right_ : nullptr);
+    // Nephew is the child of a sibling on the far side from the leaf
+    // Niece is the child of a sibling on the near side
+    bool is_left = p_leaf->is_left_child_();
+    base_ptr_ nephew = (sibling ? (is_left ? sibling->m_right_ : sibling->m_left_) : nullptr);
     if (link_type_::get_color_(nephew) == k_red_) {
       sibling->m_color_ = p_leaf->m_parent_->m_color_;
       p_leaf->m_parent_->m_color_ = k_black_;
@@ -126,7 +137,7 @@ void rb_tree_ranged_impl_::rebalance_after_erase_(base_ptr_ p_leaf) noexcept {
       break;
     }
 
-    base_ptr_ niece = (sibling ? sibling->m_left_ : nullptr);
+    base_ptr_ niece = (sibling ? (is_left ? sibling->m_left_ : sibling->m_right_) : nullptr);
     if (link_type_::get_color_(niece) == k_red_) {
       niece->m_color_ = k_black_;
       sibling->m_color_ = k_red_;
@@ -2,12 +2,17 @@
 #include <cstdlib>
 #include <functional>
 #include <gtest/gtest.h>
+#include <limits>
+#include <numeric>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define private public
 #define protected public
 #include "order_statistic_set.hpp"
+#include "persistent_order_statistic_set.hpp"
 #undef private
 #undef protected
 
@@ -284,6 +289,137 @@ TEST(test_rb_tree_private, test_12) {
   }
 }
 
+TEST(test_rb_tree_private, test_13) {
+  using sum_tree = rb_tree_ranged_<int, std::less<int>, throttle::sum_monoid<int, long long>>;
+  sum_tree t;
+  std::set<int> s;
+
+  for (int i = 0; i < 16384; i++) {
+    int temp = std::rand() % 65536;
+    if (!t.contains(temp)) {
+      t.insert(temp);
+      s.insert(temp);
+    }
+  }
+
+  for (int i = 0; i < 4096; i++) {
+    int temp = std::rand() % 65536;
+    if (t.contains(temp)) {
+      t.erase(temp);
+      s.erase(temp);
+    }
+  }
+
+  EXPECT_EQ(validate_red_black_helper(t.m_root_).second, true);
+  EXPECT_EQ(validate_size_helper(t.m_root_), true);
+
+  for (int i = 0; i < 4096; i++) {
+    int first = std::rand() % 65536, second = first + std::rand() % 4096;
+    long long expected = std::accumulate(s.lower_bound(first), s.upper_bound(second), 0ll);
+    ASSERT_EQ(t.range_aggregate(first, second), expected);
+  }
+
+  EXPECT_EQ(t.range_aggregate(10, 5), 0);
+  EXPECT_EQ(t.range_aggregate(-100, 100000), std::accumulate(s.begin(), s.end(), 0ll));
+}
+
+TEST(test_rb_tree_private, test_14) {
+  throttle::order_statistic_set<int, std::less<int>, throttle::max_monoid<int>> t{1, 5, 10, 12, 14, 18, 21, 276};
+
+  EXPECT_EQ(t.range_aggregate(2, 13), 12);
+  EXPECT_EQ(t.range_aggregate(13, 300), 276);
+  EXPECT_EQ(t.range_aggregate(-10, 0), std::numeric_limits<int>::lowest());
+
+  throttle::order_statistic_set<int> c{1, 5, 10, 12, 14, 18, 21, 276};
+  EXPECT_EQ(c.range_aggregate(2, 13), 3);
+  EXPECT_EQ(c.range_aggregate(0, 1000), 8);
+}
+
+TEST(test_persistent_set, test_1) {
+  throttle::persistent_order_statistic_set<int> t{};
+  std::set<int> s{};
+
+  for (int i = 0; i < 16384; i++) {
+    int temp = std::rand() % 65536;
+    if (!t.contains(temp)) {
+      t.insert(temp);
+      s.insert(temp);
+    } else {
+      ASSERT_THROW(t.insert(temp), std::out_of_range);
+    }
+  }
+
+  for (int i = 0; i < 4096; i++) {
+    int temp = std::rand() % 65536;
+    if (t.contains(temp)) {
+      t.erase(temp);
+      s.erase(temp);
+    } else {
+      ASSERT_THROW(t.erase(temp), std::out_of_range);
+    }
+  }
+
+  ASSERT_EQ(t.size(), s.size());
+  auto snap = t.get_snapshot();
+  std::size_t rank = 1;
+  for (auto v : s) {
+    ASSERT_EQ(snap.select_rank(rank), v);
+    ASSERT_EQ(snap.get_rank_of(v), rank);
+    ++rank;
+  }
+
+  EXPECT_EQ(snap.min(), *s.begin());
+  EXPECT_EQ(snap.max(), *s.rbegin());
+  EXPECT_THROW(snap.select_rank(0), std::out_of_range);
+  EXPECT_THROW(snap.select_rank(s.size() + 1), std::out_of_range);
+}
+
+TEST(test_persistent_set, test_2) {
+  throttle::persistent_order_statistic_set<int> t{1, 2, 3, 4, 5};
+  auto snap = t.get_snapshot();
+
+  t.erase(3);
+  t.insert(10);
+  throttle::persistent_order_statistic_set<int> c{t};
+  c.clear();
+
+  EXPECT_EQ(snap.size(), 5);
+  EXPECT_TRUE(snap.contains(3));
+  EXPECT_FALSE(snap.contains(10));
+  EXPECT_EQ(snap.select_rank(5), 5);
+
+  EXPECT_EQ(t.size(), 5);
+  EXPECT_FALSE(t.contains(3));
+  EXPECT_EQ(t.select_rank(5), 10);
+  EXPECT_EQ(t.get_rank_of(4), 3);
+  EXPECT_TRUE(c.empty());
+}
+
+TEST(test_persistent_set, test_3) {
+  throttle::persistent_order_statistic_set<int> t{};
+  constexpr int threads = 4, per_thread = 2048;
+
+  std::vector<std::thread> writers{};
+  for (int i = 0; i < threads; ++i) {
+    writers.emplace_back([&t, i]() {
+      for (int j = 0; j < per_thread; ++j) {
+        t.insert(i + threads * j);
+        auto snap = t.get_snapshot();
+        EXPECT_EQ(snap.get_rank_of(snap.select_rank(snap.size())), snap.size());
+      }
+    });
+  }
+
+  for (auto &w : writers) {
+    w.join();
+  }
+
+  ASSERT_EQ(t.size(), threads * per_thread);
+  for (int i = 0; i < threads * per_thread; ++i) {
+    ASSERT_EQ(t.select_rank(i + 1), i);
+  }
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
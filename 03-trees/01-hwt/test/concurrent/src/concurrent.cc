@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef BOOST_FOUND__
+#include <boost/program_options.hpp>
+#include <boost/program_options/option.hpp>
+namespace po = boost::program_options;
+#endif
+
+#include "order_statistic_set.hpp"
+#include "persistent_order_statistic_set.hpp"
+
+// Reader/writer benchmark. Every thread runs p_ops operations and each p_ratio-th of them is a write, which alternately
+// inserts and erases an odd key unique to this thread. The rest are reads: select_rank of a random rank followed by
+// get_rank_of the selected element. Initial set consists of even keys only, so writes never collide.
+
+struct bench_params {
+  std::size_t size, ops, ratio;
+};
+
+class locked_set {
+  throttle::order_statistic_set<int> m_set;
+  mutable std::mutex m_mutex;
+
+public:
+  void insert(int p_key) {
+    std::lock_guard lock{m_mutex};
+    m_set.insert(p_key);
+  }
+
+  void erase(int p_key) {
+    std::lock_guard lock{m_mutex};
+    m_set.erase(p_key);
+  }
+
+  bool read(std::size_t p_seed) const {
+    std::lock_guard lock{m_mutex};
+    auto rank = p_seed % m_set.size() + 1;
+    return m_set.get_rank_of(m_set.select_rank(rank)) == rank;
+  }
+};
+
+class persistent_set {
+  throttle::persistent_order_statistic_set<int> m_set;
+
+public:
+  void insert(int p_key) { m_set.insert(p_key); }
+  void erase(int p_key) { m_set.erase(p_key); }
+
+  bool read(std::size_t p_seed) const {
+    auto snap = m_set.get_snapshot();
+    auto rank = p_seed % snap.size() + 1;
+    return snap.get_rank_of(snap.select_rank(rank)) == rank;
+  }
+};
+
+template <typename t_set> double measure(const bench_params &p_params, unsigned p_threads) {
+  t_set set{};
+
+  std::vector<int> keys(p_params.size);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = 2 * static_cast<int>(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{42});
+  for (auto k : keys) {
+    set.insert(k);
+  }
+
+  std::vector<std::size_t> errors(p_threads);
+  auto worker = [&](unsigned p_id) {
+    std::mt19937_64 gen{p_id};
+    bool inserted = false;
+    int key = 0;
+    for (std::size_t i = 0, writes = 0; i < p_params.ops; ++i) {
+      if (i % p_params.ratio == 0) {
+        if (inserted) {
+          set.erase(key);
+        } else {
+          key = 2 * static_cast<int>(p_id + p_threads * writes++) + 1;
+          set.insert(key);
+        }
+        inserted = !inserted;
+      } else if (!set.read(gen())) {
+        ++errors[p_id];
+      }
+    }
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads{};
+  for (unsigned t = 0; t < p_threads; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  auto finish = std::chrono::high_resolution_clock::now();
+
+  if (std::any_of(errors.begin(), errors.end(), [](auto e) { return e != 0; })) {
+    std::cerr << "Inconsistent rank queries detected\n";
+  }
+
+  auto elapsed = std::chrono::duration<double>(finish - start).count();
+  return static_cast<double>(p_params.ops) * p_threads / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  bench_params params{1 << 20, 1 << 20, 100};
+  unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+#ifdef BOOST_FOUND__
+  po::options_description desc("Available options");
+  desc.add_options()("help,h", "Print this help message")(
+      "size,n", po::value<std::size_t>(&params.size)->default_value(params.size), "Initial number of elements")(
+      "ops,o", po::value<std::size_t>(&params.ops)->default_value(params.ops), "Operations per thread")(
+      "ratio,r", po::value<std::size_t>(&params.ratio)->default_value(params.ratio), "Reads per write")(
+      "threads,t", po::value<unsigned>(&max_threads)->default_value(max_threads), "Maximum number of threads");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 1;
+  }
+#endif
+
+  params.ratio = std::max<std::size_t>(params.ratio, 1);
+  params.size = std::max<std::size_t>(params.size, 1);
+
+  std::vector<unsigned> thread_counts{};
+  for (unsigned t = 1; t < max_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::cout << std::setw(8) << "threads" << std::setw(20) << "persistent Mops/s" << std::setw(10) << "scaling"
+            << std::setw(20) << "locked Mops/s" << std::setw(10) << "scaling"
+            << "\n";
+
+  double persistent_base = 0, locked_base = 0;
+  for (auto t : thread_counts) {
+    double persistent = measure<persistent_set>(params, t), locked = measure<locked_set>(params, t);
+    if (t == thread_counts.front()) {
+      persistent_base = persistent;
+      locked_base = locked;
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(8) << t << std::setw(20) << persistent
+              << std::setw(10) << persistent / persistent_base << std::setw(20) << locked << std::setw(10)
+              << locked / locked_base << "\n";
+  }
+}
@@ -18,6 +18,8 @@
 #include <tuple>
 #include <type_traits>
 
+#include "monoid.hpp"
+
 namespace throttle {
 namespace detail {
 
@@ -118,16 +120,25 @@ struct bst_order_node_base {
   }
 };
 
-template <typename t_value_type> struct bst_order_node : public bst_order_node_base {
-  using node_type = bst_order_node<t_value_type>;
+// Monoid aggregate of a subtree. Size is already stored in the base node, so the default augmentation takes no space.
+template <typename t_monoid> struct bst_order_aggregate {
+  typename t_monoid::value_type m_value;
+};
+
+template <typename T> struct bst_order_aggregate<size_monoid<T>> {};
+
+template <typename t_value_type, typename t_monoid = size_monoid<t_value_type>>
+struct bst_order_node : public bst_order_node_base {
+  using node_type = bst_order_node<t_value_type, t_monoid>;
   using node_ptr = node_type *;
   using const_node_ptr = const node_type *;
 
   t_value_type m_value;
+  [[no_unique_address]] bst_order_aggregate<t_monoid> m_aggregate;
 
-  bst_order_node() : bst_order_node_base{}, m_value{} {}
+  bst_order_node() : bst_order_node_base{}, m_value{}, m_aggregate{} {}
   bst_order_node(const t_value_type &p_key, size_type p_size = 1)
-      : bst_order_node_base{p_size, nullptr, nullptr, nullptr}, m_value{p_key} {}
+      : bst_order_node_base{p_size, nullptr, nullptr, nullptr}, m_value{p_key}, m_aggregate{} {}
 };
 
 class bs_order_tree_impl {
@@ -136,6 +147,7 @@ protected:
   using const_base_ptr = bst_order_node_base::const_base_ptr;
   using link_type = bst_order_node_base;
   using size_type = bst_order_node_base::size_type;
+  using augment_hook = void (*)(base_ptr) noexcept;
 
 protected:
   mutable base_ptr m_root;
@@ -143,23 +155,33 @@ protected:
   // well.
   base_ptr m_leftmost;
   base_ptr m_rightmost;
+  // Recomputes monoid aggregate of a node from its children after a rotation. Null when only sizes are maintained.
+  augment_hook m_augment;
 
   void rotate_left(base_ptr) const noexcept;
   void rotate_right(base_ptr) const noexcept;
   void rotate_to_parent(base_ptr) const noexcept;
 
-  bs_order_tree_impl() : m_root{}, m_leftmost{}, m_rightmost{} {}
+  bs_order_tree_impl(augment_hook p_augment = nullptr)
+      : m_root{}, m_leftmost{}, m_rightmost{}, m_augment{p_augment} {}
 };
 
-template <typename t_value_type, typename t_comp, typename t_key_type = t_value_type>
+template <typename t_value_type, typename t_comp, typename t_key_type = t_value_type,
+          typename t_monoid = size_monoid<t_value_type>>
 class bs_order_tree : public bs_order_tree_impl {
 protected:
-  using node_type = bst_order_node<t_value_type>;
+  using node_type = bst_order_node<t_value_type, t_monoid>;
   using node_ptr = typename node_type::node_ptr;
   using const_node_ptr = typename node_type::const_node_ptr;
   using size_type = typename node_type::size_type;
   using self = bs_order_tree;
 
+  static constexpr bool is_size_augmented = std::is_same_v<t_monoid, size_monoid<t_value_type>>;
+
+public:
+  using monoid_type = t_monoid;
+  using aggregate_type = typename t_monoid::value_type;
+
 public:
   struct iterator {
     const self *m_tree;
@@ -346,6 +368,40 @@ protected:
   }
   // clang-format on
 
+  static aggregate_type aggregate(const_base_ptr p_node) noexcept {
+    if (!p_node) return t_monoid::identity();
+    if constexpr (is_size_augmented) {
+      return p_node->m_size;
+    } else {
+      return static_cast<const_node_ptr>(p_node)->m_aggregate.m_value;
+    }
+  }
+
+  static void update_aggregate(base_ptr p_node) noexcept {
+    if constexpr (!is_size_augmented) {
+      static_cast<node_ptr>(p_node)->m_aggregate.m_value = t_monoid::combine(
+          t_monoid::combine(aggregate(p_node->m_left), t_monoid::lift(static_cast<node_ptr>(p_node)->m_value)),
+          aggregate(p_node->m_right));
+    }
+  }
+
+  // Recompute aggregates on the path from p_node to the root. Used after the set of values in a subtree has changed.
+  static void update_path_aggregates(base_ptr p_node) noexcept {
+    if constexpr (!is_size_augmented) {
+      for (; p_node; p_node = p_node->m_parent) {
+        update_aggregate(p_node);
+      }
+    }
+  }
+
+  static augment_hook get_augment_hook() noexcept {
+    if constexpr (is_size_augmented) {
+      return nullptr;
+    } else {
+      return &update_aggregate;
+    }
+  }
+
   std::pair<node_ptr, node_ptr> bst_lookup(const t_key_type &p_key) const {
     auto [found, prev, is_prev_less] = traverse_bs(static_cast<node_ptr>(m_root), p_key, [](const node_type &) {});
     return {found, prev};
@@ -356,6 +412,7 @@ protected:
 
     if (empty()) {
       m_root = m_leftmost = m_rightmost = to_insert.get();
+      update_aggregate(m_root);
       return {to_insert.release(), nullptr};
     }
 
@@ -374,6 +431,8 @@ protected:
       prev->m_left = to_insert.get();
     }
 
+    update_path_aggregates(to_insert.get());
+
     if (t_comp{}(p_key, static_cast<node_ptr>(m_leftmost)->m_value)) {
       m_leftmost = to_insert.get();
     } else if (t_comp{}(static_cast<node_ptr>(m_rightmost)->m_value, p_key)) {
@@ -384,7 +443,7 @@ protected:
   }
 
   // Constructors
-  bs_order_tree() : bs_order_tree_impl{} {}
+  bs_order_tree() : bs_order_tree_impl{get_augment_hook()} {}
 
   ~bs_order_tree() {
     clear();
@@ -394,7 +453,7 @@ protected:
   bs_order_tree(const self &p_other) = delete;
   self &operator=(const self &p_other) = delete;
 
-  bs_order_tree(self &&p_other) noexcept {
+  bs_order_tree(self &&p_other) noexcept : bs_order_tree_impl{get_augment_hook()} {
     std::swap(m_root, p_other.m_root);
     std::swap(m_leftmost, p_other.m_leftmost);
     std::swap(m_rightmost, p_other.m_rightmost);
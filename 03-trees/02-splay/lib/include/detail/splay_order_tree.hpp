@@ -16,9 +16,9 @@
 
 namespace throttle {
 namespace detail {
-template <typename t_value_type, typename t_comp, typename t_key_type>
-class splay_order_tree : public bs_order_tree<t_value_type, t_comp, t_key_type> {
-  using base_tree = bs_order_tree<t_value_type, t_comp, t_key_type>;
+template <typename t_value_type, typename t_comp, typename t_key_type, typename t_monoid = size_monoid<t_value_type>>
+class splay_order_tree : public bs_order_tree<t_value_type, t_comp, t_key_type, t_monoid> {
+  using base_tree = bs_order_tree<t_value_type, t_comp, t_key_type, t_monoid>;
   using typename base_tree::base_ptr;
   using typename base_tree::const_base_ptr;
   using typename base_tree::const_node_ptr;
@@ -27,14 +27,20 @@ class splay_order_tree : public bs_order_tree<t_value_type, t_comp, t_key_type>
   using self = splay_order_tree;
 
 public:
+  using typename base_tree::aggregate_type;
   using typename base_tree::iterator;
   using typename base_tree::size_type;
 
 protected:
   void splay_to_root(base_ptr p_node) const {
-    while (p_node->m_parent) {
+    splay_to_child_of(p_node, nullptr);
+  }
+
+  // Splay p_node up until its parent is p_top. Passing nullptr as p_top moves the node all the way to the root.
+  void splay_to_child_of(base_ptr p_node, base_ptr p_top) const {
+    while (p_node->m_parent != p_top) {
 
-      if (!p_node->m_parent->m_parent) { // Case 1. Zig
+      if (p_node->m_parent->m_parent == p_top) { // Case 1. Zig
         this->rotate_to_parent(p_node);
       }
 
@@ -50,6 +56,151 @@ protected:
     }
   }
 
+  // Top-down splay [Sleator & Tarjan, 1985]. Splays the node with key p_key or the last node on the search path in a
+  // single descent. Nodes that are passed are linked into a left tree of smaller and right tree of greater elements,
+  // which are then reassembled around the new root. Sizes along the spines of the two trees are restored top-down from
+  // element counts accumulated during the descent, so parent pointers are only written, never followed.
+  void top_down_splay(const t_key_type &p_key) const {
+    base_ptr curr = this->m_root;
+    if (!curr) return;
+
+    base_ptr left_root = nullptr, left_max = nullptr, right_root = nullptr, right_min = nullptr;
+    size_type left_size = 0, right_size = 0;
+
+    for (;;) {
+      if (t_comp{}(p_key, value(curr))) {
+        if (!curr->m_left) break;
+        if (t_comp{}(p_key, value(curr->m_left))) { // Zig-zig. Rotate right
+          base_ptr child = curr->m_left;
+          curr->m_left = child->m_right;
+          if (curr->m_left) curr->m_left->m_parent = curr;
+          child->m_right = curr;
+          curr->m_parent = child;
+          curr->m_size = link_type::size(curr->m_left) + link_type::size(curr->m_right) + 1;
+          base_tree::update_aggregate(curr);
+          curr = child;
+          if (!curr->m_left) break;
+        }
+        // Link right
+        right_size += link_type::size(curr->m_right) + 1;
+        if (right_min) {
+          right_min->m_left = curr;
+          curr->m_parent = right_min;
+        } else {
+          right_root = curr;
+        }
+        right_min = curr;
+        curr = curr->m_left;
+      }
+
+      else if (t_comp{}(value(curr), p_key)) {
+        if (!curr->m_right) break;
+        if (t_comp{}(value(curr->m_right), p_key)) { // Zig-zig. Rotate left
+          base_ptr child = curr->m_right;
+          curr->m_right = child->m_left;
+          if (curr->m_right) curr->m_right->m_parent = curr;
+          child->m_left = curr;
+          curr->m_parent = child;
+          curr->m_size = link_type::size(curr->m_left) + link_type::size(curr->m_right) + 1;
+          base_tree::update_aggregate(curr);
+          curr = child;
+          if (!curr->m_right) break;
+        }
+        // Link left
+        left_size += link_type::size(curr->m_left) + 1;
+        if (left_max) {
+          left_max->m_right = curr;
+          curr->m_parent = left_max;
+        } else {
+          left_root = curr;
+        }
+        left_max = curr;
+        curr = curr->m_right;
+      }
+
+      else {
+        break;
+      }
+    }
+
+    // Assemble. Middle tree's subtrees become the innermost subtrees of the left and right trees.
+    left_size += link_type::size(curr->m_left);
+    right_size += link_type::size(curr->m_right);
+
+    if (left_max) {
+      left_max->m_right = curr->m_left;
+      if (curr->m_left) curr->m_left->m_parent = left_max;
+      curr->m_left = left_root;
+      left_root->m_parent = curr;
+    }
+
+    if (right_min) {
+      right_min->m_left = curr->m_right;
+      if (curr->m_right) curr->m_right->m_parent = right_min;
+      curr->m_right = right_root;
+      right_root->m_parent = curr;
+    }
+
+    for (base_ptr node = left_root; node != nullptr; node = (node == left_max ? nullptr : node->m_right)) {
+      node->m_size = left_size;
+      left_size -= link_type::size(node->m_left) + 1;
+    }
+
+    for (base_ptr node = right_root; node != nullptr; node = (node == right_min ? nullptr : node->m_left)) {
+      node->m_size = right_size;
+      right_size -= link_type::size(node->m_right) + 1;
+    }
+
+    if constexpr (!base_tree::is_size_augmented) {
+      for (base_ptr node = left_max; node && node != curr; node = node->m_parent) {
+        base_tree::update_aggregate(node);
+      }
+      for (base_ptr node = right_min; node && node != curr; node = node->m_parent) {
+        base_tree::update_aggregate(node);
+      }
+    }
+
+    curr->m_parent = nullptr;
+    curr->m_size = link_type::size(curr->m_left) + link_type::size(curr->m_right) + 1;
+    base_tree::update_aggregate(curr);
+    this->m_root = curr;
+  }
+
+  static const t_value_type &value(const_base_ptr p_node) {
+    return static_cast<const_node_ptr>(p_node)->m_value;
+  }
+
+  bool is_root_key(const t_key_type &p_key) const {
+    return this->m_root && !t_comp{}(value(this->m_root), p_key) && !t_comp{}(p_key, value(this->m_root));
+  }
+
+  // Non-splaying search helpers. Return the bound or nullptr.
+  base_ptr peek_lower_bound_node(const t_key_type &p_key) const {
+    base_ptr curr = this->m_root, bound = nullptr;
+    while (curr) {
+      if (t_comp{}(value(curr), p_key)) {
+        curr = curr->m_right;
+      } else {
+        bound = curr;
+        curr = curr->m_left;
+      }
+    }
+    return bound;
+  }
+
+  base_ptr peek_upper_bound_node(const t_key_type &p_key) const {
+    base_ptr curr = this->m_root, bound = nullptr;
+    while (curr) {
+      if (t_comp{}(p_key, value(curr))) {
+        bound = curr;
+        curr = curr->m_left;
+      } else {
+        curr = curr->m_right;
+      }
+    }
+    return bound;
+  }
+
   void join(base_ptr p_left, base_ptr p_right) {
     assert(p_left);
     assert(p_right);
@@ -62,6 +213,7 @@ protected:
     this->m_root = max_left;
 
     max_left->m_size = link_type::size(max_left->m_left) + link_type::size(max_left->m_right) + 1;
+    base_tree::update_aggregate(max_left);
   }
 
   void erase(base_ptr p_node) {
@@ -120,12 +272,9 @@ public:
   }
 
   void erase(const t_key_type &p_key) {
-    auto [to_erase, prev] = this->bst_lookup(p_key);
-    if (!to_erase) {
-      if (prev) splay_to_root(prev);
-      throw std::out_of_range("Trying to erase element not present in the tree");
-    }
-    erase(to_erase);
+    top_down_splay(p_key);
+    if (!is_root_key(p_key)) throw std::out_of_range("Trying to erase element not present in the tree");
+    erase(this->m_root);
   }
 
   void erase(iterator p_pos) {
@@ -133,14 +282,9 @@ public:
   }
 
   size_type get_rank_of(const t_key_type &p_elem) const {
-    base_ptr node, prev;
-    std::tie(node, prev) = this->bst_lookup(p_elem);
-    if (!node) {
-      if (prev) splay_to_root(prev);
-      throw std::out_of_range("Element not present");
-    }
-
-    return get_rank_of(node);
+    top_down_splay(p_elem);
+    if (!is_root_key(p_elem)) throw std::out_of_range("Element not present");
+    return link_type::size(this->m_root->m_left) + 1;
   }
 
   size_type get_rank_of(iterator p_pos) const {
@@ -212,14 +356,114 @@ public:
     return iterator{bound, this};
   }
 
+  // Combine monoid values of all elements with keys in [p_first, p_second]. The predecessor of the range is splayed to
+  // the root and the successor right below it, so that the elements of the range form a single subtree.
+  aggregate_type range_aggregate(const t_key_type &p_first, const t_key_type &p_second) const {
+    if (this->empty() || t_comp{}(p_second, p_first)) return t_monoid::identity();
+
+    base_ptr pred = nullptr, prev = nullptr;
+    for (base_ptr curr = this->m_root; curr;) {
+      prev = curr;
+      if (t_comp{}(static_cast<node_ptr>(curr)->m_value, p_first)) {
+        pred = curr;
+        curr = curr->m_right;
+      } else {
+        curr = curr->m_left;
+      }
+    }
+
+    splay_to_root(prev);
+    if (pred) splay_to_root(pred);
+
+    base_ptr succ = nullptr;
+    prev = nullptr;
+    for (base_ptr curr = (pred ? pred->m_right : this->m_root); curr;) {
+      prev = curr;
+      if (t_comp{}(p_second, static_cast<node_ptr>(curr)->m_value)) {
+        succ = curr;
+        curr = curr->m_left;
+      } else {
+        curr = curr->m_right;
+      }
+    }
+
+    if (prev) splay_to_child_of(prev, pred);
+    if (succ) splay_to_child_of(succ, pred);
+
+    if (succ) return base_tree::aggregate(succ->m_left);
+    return base_tree::aggregate(pred ? pred->m_right : this->m_root);
+  }
+
   iterator find(const t_key_type &p_key) const {
+    top_down_splay(p_key);
+    if (!is_root_key(p_key)) return this->end();
+    return iterator{this->m_root, this};
+  }
+
+  // Read-only queries that never restructure the tree. They cost O(depth) without amortization, but can run
+  // concurrently from several threads as long as no thread modifies or splays the tree at the same time.
+  iterator peek_find(const t_key_type &p_key) const {
     auto [found, prev] = this->bst_lookup(p_key);
-    if (!found) {
-      if (prev) splay_to_root(prev);
-      return this->end();
+    return (found ? iterator{found, this} : this->end());
+  }
+
+  bool peek_contains(const t_key_type &p_key) const {
+    return this->bst_lookup(p_key).first;
+  }
+
+  iterator peek_lower_bound(const t_key_type &p_key) const {
+    base_ptr bound = peek_lower_bound_node(p_key);
+    return (bound ? iterator{bound, this} : this->end());
+  }
+
+  iterator peek_upper_bound(const t_key_type &p_key) const {
+    base_ptr bound = peek_upper_bound_node(p_key);
+    return (bound ? iterator{bound, this} : this->end());
+  }
+
+  iterator peek_select_rank(size_type p_rank) const {
+    if (p_rank > this->size() || !(p_rank > 0)) return this->end();
+
+    base_ptr curr = this->m_root;
+    size_type r = link_type::size(curr->m_left) + 1;
+    while (r != p_rank) {
+      if (p_rank < r) {
+        curr = curr->m_left;
+      } else {
+        curr = curr->m_right;
+        p_rank -= r;
+      }
+      r = link_type::size(curr->m_left) + 1;
     }
-    splay_to_root(found);
-    return iterator{found, this};
+
+    return iterator{curr, this};
+  }
+
+  // Rank is accumulated on the way down, so the search doesn't need to climb back through parent pointers.
+  size_type peek_get_rank_of(const t_key_type &p_elem) const {
+    base_ptr curr = this->m_root;
+    size_type rank = 0;
+    while (curr) {
+      if (t_comp{}(p_elem, value(curr))) {
+        curr = curr->m_left;
+      } else if (t_comp{}(value(curr), p_elem)) {
+        rank += link_type::size(curr->m_left) + 1;
+        curr = curr->m_right;
+      } else {
+        return rank + link_type::size(curr->m_left) + 1;
+      }
+    }
+    throw std::out_of_range("Element not present");
+  }
+
+  size_type peek_get_rank_of(iterator p_pos) const {
+    const_base_ptr node = p_pos.m_curr;
+    size_type rank = link_type::size(node->m_left) + 1;
+    while (node != this->m_root) {
+      if (node->is_right_child()) rank += link_type::size(node->m_parent->m_left) + 1;
+      node = node->m_parent;
+    }
+    return rank;
   }
 
   // Use default constructor, destructor and move constructor, assigment from base class.
@@ -13,24 +13,26 @@
 #include <iostream>
 
 #include "detail/splay_order_tree.hpp"
+#include "monoid.hpp"
 
 namespace throttle {
-template <typename T, typename t_comp = std::less<T>> class splay_order_set {
+template <typename T, typename t_comp = std::less<T>, typename t_monoid = size_monoid<T>> class splay_order_set {
 private:
-  detail::splay_order_tree<T, t_comp, T> m_tree_impl;
+  using tree_impl = detail::splay_order_tree<T, t_comp, T, t_monoid>;
+  tree_impl m_tree_impl;
 
 public:
   class iterator {
-    friend class splay_order_set<T, t_comp>;
+    friend class splay_order_set<T, t_comp, t_monoid>;
 
   private:
-    typename detail::splay_order_tree<T, t_comp, T>::iterator m_it_impl;
+    typename tree_impl::iterator m_it_impl;
 
-    iterator(typename detail::splay_order_tree<T, t_comp, T>::iterator p_wrapped) : m_it_impl{p_wrapped} {}
+    iterator(typename tree_impl::iterator p_wrapped) : m_it_impl{p_wrapped} {}
 
   public:
     using iterator_category = std::bidirectional_iterator_tag;
-    using difference_type = typename detail::splay_order_tree<T, t_comp, T>::iterator::difference_type;
+    using difference_type = typename tree_impl::iterator::difference_type;
     using value_type = T;
     using pointer = const T *;
     using reference = const T &;
@@ -79,7 +81,8 @@ public:
 public:
   using value_type = T;
   using reference = const T &;
-  using size_type = typename detail::splay_order_tree<T, t_comp, T>::size_type;
+  using size_type = typename tree_impl::size_type;
+  using aggregate_type = typename tree_impl::aggregate_type;
   using key_type = T;
   using difference_type = typename iterator::difference_type;
   using const_iterator = iterator;
@@ -150,6 +153,44 @@ public: // Selectors
     return m_tree_impl.get_rank_of(p_pos.m_it_impl);
   }
 
+  // Combine all elements in [p_first, p_second] with the monoid the set was augmented with. For the default
+  // size_monoid this is the number of elements in range.
+  aggregate_type range_aggregate(const key_type &p_first, const key_type &p_second) const {
+    return m_tree_impl.range_aggregate(p_first, p_second);
+  }
+
+public: // Non-splaying selectors
+  // These never modify the tree, so any number of threads may call them concurrently during read-mostly phases, as
+  // long as nobody calls modifiers or splaying selectors above at the same time. They don't get the amortized
+  // guarantees of splaying and cost O(depth) for the current shape of the tree.
+  bool peek_contains(const key_type &p_key) const {
+    return m_tree_impl.peek_contains(p_key);
+  }
+
+  iterator peek_find(const key_type &p_key) const {
+    return iterator{m_tree_impl.peek_find(p_key)};
+  }
+
+  iterator peek_lower_bound(const key_type &p_key) const {
+    return iterator{m_tree_impl.peek_lower_bound(p_key)};
+  }
+
+  iterator peek_upper_bound(const key_type &p_key) const {
+    return iterator{m_tree_impl.peek_upper_bound(p_key)};
+  }
+
+  iterator peek_select_rank(size_type p_rank) const {
+    return iterator{m_tree_impl.peek_select_rank(p_rank)};
+  }
+
+  size_type peek_get_rank_of(const key_type &p_key) const {
+    return m_tree_impl.peek_get_rank_of(p_key);
+  }
+
+  size_type peek_get_rank_of(iterator p_pos) const {
+    return m_tree_impl.peek_get_rank_of(p_pos.m_it_impl);
+  }
+
 public:
   splay_order_set() : m_tree_impl{} {}
 
@@ -191,8 +232,8 @@ public:
   }
 };
 
-template <typename T, typename t_comp>
-std::ostream &operator<<(std::ostream &p_ostream, splay_order_set<T, t_comp> &p_set) {
+template <typename T, typename t_comp, typename t_monoid>
+std::ostream &operator<<(std::ostream &p_ostream, splay_order_set<T, t_comp, t_monoid> &p_set) {
   p_set.dump(p_ostream);
   return p_ostream;
 }
@@ -39,6 +39,11 @@ void bs_order_tree_impl::rotate_left(base_ptr p_n) const noexcept {
 
   rchild->m_size = root->m_size;
   root->m_size = link_type::size(root->m_left) + link_type::size(root->m_right) + 1;
+
+  if (m_augment) {
+    m_augment(root);
+    m_augment(rchild);
+  }
 }
 
 void bs_order_tree_impl::rotate_right(base_ptr p_n) const noexcept {
@@ -66,6 +71,11 @@ void bs_order_tree_impl::rotate_right(base_ptr p_n) const noexcept {
 
   lchild->m_size = root->m_size;
   root->m_size = link_type::size(root->m_left) + link_type::size(root->m_right) + 1;
+
+  if (m_augment) {
+    m_augment(root);
+    m_augment(lchild);
+  }
 }
 
 void bs_order_tree_impl::rotate_to_parent(base_ptr p_n) const noexcept {
@@ -4,6 +4,7 @@
 #include <functional>
 #include <gtest/gtest.h>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <set>
 #include <string>
@@ -282,6 +283,121 @@ TEST(splay_order_test, test_11) {
   EXPECT_EQ(validate_size_helper(c.m_tree_impl.m_root), true);
 }
 
+TEST(splay_order_test, test_12) {
+  throttle::splay_order_set<int, std::less<int>, throttle::sum_monoid<int, long long>> t{};
+  std::set<int> s{};
+
+  for (int i = 0; i < 16384; i++) {
+    int temp = rand() % 65536;
+    if (!t.contains(temp)) {
+      t.insert(temp);
+      s.insert(temp);
+    }
+  }
+
+  for (int i = 0; i < 4096; i++) {
+    int temp = rand() % 65536;
+    if (t.contains(temp)) {
+      t.erase(temp);
+      s.erase(temp);
+    }
+  }
+
+  EXPECT_EQ(validate_size_helper(t.m_tree_impl.m_root), true);
+
+  for (int i = 0; i < 4096; i++) {
+    int first = rand() % 65536, second = first + rand() % 4096;
+    long long expected = std::accumulate(s.lower_bound(first), s.upper_bound(second), 0ll);
+    ASSERT_EQ(t.range_aggregate(first, second), expected);
+  }
+
+  EXPECT_EQ(t.range_aggregate(10, 5), 0);
+  EXPECT_EQ(t.range_aggregate(-100, 100000), std::accumulate(s.begin(), s.end(), 0ll));
+}
+
+TEST(splay_order_test, test_13) {
+  throttle::splay_order_set<int, std::less<int>, throttle::min_monoid<int>> t{1, 5, 10, 12, 14, 18, 21, 276};
+
+  EXPECT_EQ(t.range_aggregate(2, 13), 5);
+  EXPECT_EQ(t.range_aggregate(13, 300), 14);
+  EXPECT_EQ(t.range_aggregate(277, 300), std::numeric_limits<int>::max());
+
+  throttle::splay_order_set<int> c{1, 5, 10, 12, 14, 18, 21, 276};
+  EXPECT_EQ(c.range_aggregate(2, 13), 3);
+  EXPECT_EQ(c.range_aggregate(0, 1000), 8);
+  EXPECT_EQ(validate_size_helper(c.m_tree_impl.m_root), true);
+}
+
+TEST(splay_order_test, test_14) {
+  throttle::splay_order_set<int> t{};
+  std::set<int> s{};
+
+  for (int i = 0; i < 65536; i++) {
+    int temp = rand() % 131072;
+    if (!t.contains(temp)) {
+      t.insert(temp);
+      s.insert(temp);
+    }
+  }
+
+  for (int i = 0; i < 16384; i++) {
+    int temp = rand() % 131072;
+    if (s.count(temp)) {
+      auto rank = t.peek_get_rank_of(temp);
+      ASSERT_EQ(t.get_rank_of(temp), rank);
+      if (i % 256 == 0) {
+        ASSERT_EQ(rank, std::distance(s.begin(), s.find(temp)) + 1);
+      }
+      t.erase(temp);
+      s.erase(temp);
+    } else {
+      ASSERT_THROW(t.get_rank_of(temp), std::out_of_range);
+      ASSERT_THROW(t.erase(temp), std::out_of_range);
+    }
+  }
+
+  EXPECT_EQ(validate_size_helper(t.m_tree_impl.m_root), true);
+  EXPECT_TRUE(std::equal(t.begin(), t.end(), s.begin(), s.end()));
+  EXPECT_TRUE(std::equal(std::make_reverse_iterator(t.end()), std::make_reverse_iterator(t.begin()), s.rbegin(),
+                         s.rend()));
+}
+
+TEST(splay_order_test, test_15) {
+  throttle::splay_order_set<int> t{};
+  for (int i = 0; i < 4096; i += 2) {
+    t.insert(i);
+  }
+
+  auto root = t.m_tree_impl.m_root;
+  for (int i = -1; i < 4097; ++i) {
+    EXPECT_EQ(t.peek_contains(i), i % 2 == 0 && i >= 0 && i < 4096);
+    auto lower = t.peek_lower_bound(i), upper = t.peek_upper_bound(i);
+    int expected_lower = (i + 1) / 2 * 2, expected_upper = (i + 2) / 2 * 2;
+    if (expected_lower < 4096) {
+      EXPECT_EQ(*lower, expected_lower);
+    } else {
+      EXPECT_EQ(lower, t.end());
+    }
+    if (expected_upper < 4096) {
+      EXPECT_EQ(*upper, expected_upper);
+    } else {
+      EXPECT_EQ(upper, t.end());
+    }
+  }
+
+  for (int i = 1; i <= 2048; ++i) {
+    auto it = t.peek_select_rank(i);
+    ASSERT_EQ(*it, 2 * (i - 1));
+    ASSERT_EQ(t.peek_get_rank_of(*it), i);
+    ASSERT_EQ(t.peek_get_rank_of(it), i);
+  }
+
+  EXPECT_EQ(t.peek_find(3), t.end());
+  EXPECT_EQ(t.peek_select_rank(0), t.end());
+  EXPECT_THROW(t.peek_get_rank_of(3), std::out_of_range);
+  EXPECT_EQ(t.m_tree_impl.m_root, root);
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
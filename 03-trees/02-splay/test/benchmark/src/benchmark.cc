@@ -44,6 +44,35 @@ template <typename T> int my_set_range_query(throttle::splay_order_set<T> &p_set
 }
 #endif
 
+using sum_set = throttle::splay_order_set<int, std::less<int>, throttle::sum_monoid<int, long long>>;
+
+template <typename T> long long set_range_sum(const std::set<T> &p_set, T p_first, T p_second) {
+  if (p_first > p_second) return 0;
+  return std::accumulate(p_set.lower_bound(p_first), p_set.upper_bound(p_second), 0ll);
+}
+
+long long my_set_range_sum(const sum_set &p_set, int p_first, int p_second) {
+  return p_set.range_aggregate(p_first, p_second);
+}
+
+template <typename t_set, typename t_query>
+std::vector<long long> run_queries(const std::vector<int> &p_ivec, const std::vector<std::pair<int, int>> &p_qvec,
+                                   t_query p_query) {
+  std::vector<long long> ans{};
+  ans.reserve(p_qvec.size());
+
+  t_set t{};
+  for (const auto &v : p_ivec) {
+    t.insert(v);
+  }
+
+  for (const auto &q : p_qvec) {
+    ans.push_back(p_query(t, q.first, q.second));
+  }
+
+  return ans;
+}
+
 std::pair<std::vector<int>, std::vector<std::pair<int, int>>> read_input() {
   int n = 0;
   if (!(std::cin >> n)) {
@@ -82,7 +111,8 @@ int main(int argc, char *argv[]) {
 #ifdef BOOST_FOUND__
   po::options_description desc("Available options");
   desc.add_options()("help,h", "Print this help message")("compare,c", "Compare with std::set")(
-      "measure,m", "Print perfomance metrics")("hide", "Hide output");
+      "measure,m", "Print perfomance metrics")("hide", "Hide output")(
+      "sum,s", "Answer range-sum queries instead of range counts");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -96,23 +126,21 @@ int main(int argc, char *argv[]) {
   bool compare = vm.count("compare");
   bool measure = vm.count("measure");
   bool hide = vm.count("hide");
+  bool sum = vm.count("sum");
+#else
+  bool sum = false;
 #endif
 
   auto [i_vec, q_vec] = read_input();
 
-  std::vector<int> my_set_ans{}, set_ans{};
-  my_set_ans.reserve(q_vec.size());
-  set_ans.reserve(q_vec.size());
+  std::vector<long long> my_set_ans{}, set_ans{};
 
   auto my_set_start = std::chrono::high_resolution_clock::now();
 
-  throttle::splay_order_set<int> t{};
-  for (const auto &v : i_vec) {
-    t.insert(v);
-  }
-
-  for (const auto &q : q_vec) {
-    my_set_ans.push_back(my_set_range_query(t, q.first, q.second));
+  if (sum) {
+    my_set_ans = run_queries<sum_set>(i_vec, q_vec, my_set_range_sum);
+  } else {
+    my_set_ans = run_queries<throttle::splay_order_set<int>>(i_vec, q_vec, my_set_range_query<int>);
   }
 
   auto my_set_finish = std::chrono::high_resolution_clock::now();
@@ -121,13 +149,10 @@ int main(int argc, char *argv[]) {
 #ifdef BOOST_FOUND__
   auto set_start = std::chrono::high_resolution_clock::now();
   if (compare) {
-    std::set<int> s{};
-    for (const auto &v : i_vec) {
-      s.insert(v);
-    }
-
-    for (const auto &q : q_vec) {
-      set_ans.push_back(set_range_query(s, q.first, q.second));
+    if (sum) {
+      set_ans = run_queries<std::set<int>>(i_vec, q_vec, set_range_sum<int>);
+    } else {
+      set_ans = run_queries<std::set<int>>(i_vec, q_vec, set_range_query<int>);
     }
   }
 
@@ -66,12 +66,18 @@ template <typename T> int my_set_range_query(throttle::splay_order_set<T> &p_set
   return rank_right - rank_left;
 }
 
-int main(int argc, char *argv[]) {
-  auto [i_vec, q_vec] = read_input();
+template <typename F> double measure(const std::vector<std::pair<int, int>> &p_qvec, F p_query) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (const auto &q : p_qvec) {
+    auto &&r = p_query(q.first, q.second);
+    asm("" ::"r"(r));
+  }
+  auto finish = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(finish - start).count();
+}
 
-  std::vector<int> my_set_ans{}, set_ans{};
-  my_set_ans.reserve(q_vec.size());
-  set_ans.reserve(q_vec.size());
+int main() {
+  auto [i_vec, q_vec] = read_input();
 
   throttle::splay_order_set<int> t{};
   for (const auto &v : i_vec)
@@ -81,22 +87,29 @@ int main(int argc, char *argv[]) {
   for (const auto &v : i_vec)
     s.insert(v);
 
-  auto my_set_start = std::chrono::high_resolution_clock::now();
-  for (const auto &q : q_vec) {
-    auto &&r = my_set_range_query(t, q.first, q.second);
-    asm("" ::"r"(r));
-  }
-  auto my_set_finish = std::chrono::high_resolution_clock::now();
-  auto my_set_elapsed = std::chrono::duration<double, std::milli>(my_set_finish - my_set_start);
-
-  auto set_start = std::chrono::high_resolution_clock::now();
-  for (const auto &q : q_vec) {
-    auto &&r = set_range_query(s, q.first, q.second);
-    asm("" ::"r"(r));
-  }
-  auto set_finish = std::chrono::high_resolution_clock::now();
-  auto set_elapsed = std::chrono::duration<double, std::milli>(set_finish - set_start);
-
-  std::cout << "throttle::splay_set took " << my_set_elapsed.count() << "ms to run\n";
-  std::cout << "std::set took " << set_elapsed.count() << "ms to run\n";
-}
\ No newline at end of file
+  auto my_set_elapsed = measure(q_vec, [&t](int p_first, int p_second) {
+    return my_set_range_query(t, p_first, p_second);
+  });
+  auto set_elapsed = measure(q_vec, [&s](int p_first, int p_second) {
+    return set_range_query(s, p_first, p_second);
+  });
+
+  std::cout << "throttle::splay_set took " << my_set_elapsed << "ms to run\n";
+  std::cout << "std::set took " << set_elapsed << "ms to run\n";
+
+  // Point lookups of both query bounds. Splaying find restructures the tree top-down on every access, peek_contains
+  // leaves it as is.
+  auto my_set_find_elapsed = measure(q_vec, [&t](int p_first, int p_second) {
+    return (t.find(p_first) != t.end()) + (t.find(p_second) != t.end());
+  });
+  auto my_set_peek_elapsed = measure(q_vec, [&t](int p_first, int p_second) {
+    return t.peek_contains(p_first) + t.peek_contains(p_second);
+  });
+  auto set_find_elapsed = measure(q_vec, [&s](int p_first, int p_second) {
+    return (s.find(p_first) != s.end()) + (s.find(p_second) != s.end());
+  });
+
+  std::cout << "throttle::splay_set::find took " << my_set_find_elapsed << "ms to run\n";
+  std::cout << "throttle::splay_set::peek_contains took " << my_set_peek_elapsed << "ms to run\n";
+  std::cout << "std::set::find took " << set_find_elapsed << "ms to run\n";
+}
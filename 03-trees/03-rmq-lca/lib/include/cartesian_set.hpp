@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <functional>
+#include <iterator>
 #include <utility>
 
 #include "cartesian_tree.hpp"
@@ -42,6 +43,12 @@ public:
     }
   }
 
+  // Construct the tree from a whole range using up to p_threads threads.
+  template <std::random_access_iterator t_rand_iter>
+  cartesian_set(t_rand_iter start, t_rand_iter finish, unsigned p_threads) {
+    base::build_parallel_impl(start, finish, p_threads);
+  }
+
   void append(const key_type& p_key) {
     base::append_impl(p_key);
   }
@@ -15,14 +15,22 @@
  * construct the tree is a stack for the rightmost branch (path that is taken from rightmost element to the root). When
  * an element is appended, this branch is traversed upwards while popping the keys from the stack until an element less
  * than inserted key is found. Then the branches are "rotated" to preserve Cartesian tree property.
+ *
+ * build_parallel_impl constructs the same tree from a whole range using all nearest smaller values. The parent of an
+ * element is the greater of its nearest smaller neighbours on the left and on the right. The range is split into chunks,
+ * neighbours inside a chunk are found with a stack in parallel, and the remaining ones are looked up in the spines of
+ * other chunks with binary search.
  * 
  */
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <iterator>
 #include <stack>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -124,6 +132,112 @@ protected:
     rightmost_node.m_parent = curr;
   }
 
+  template <typename F> static void run_chunks(size_type p_chunks, F p_func) {
+    std::vector<std::thread> threads{};
+    for (size_type c = 1; c < p_chunks; ++c) {
+      threads.emplace_back(p_func, c);
+    }
+    p_func(0);
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+
+  // Should only be called on an empty tree. Indices here are 0-based positions in the range.
+  template <std::random_access_iterator t_rand_iter>
+  void build_parallel_impl(t_rand_iter p_start, t_rand_iter p_finish, unsigned p_threads) {
+    constexpr size_type min_chunk_size = 1 << 16, npos = ~size_type{0};
+    const size_type n = std::distance(p_start, p_finish);
+    const size_type chunks = std::clamp<size_type>(n / min_chunk_size, 1, std::max(p_threads, 1u));
+
+    if (chunks == 1) {
+      for (; p_start != p_finish; ++p_start) {
+        append_impl(*p_start);
+      }
+      return;
+    }
+
+    auto key = [p_start](size_type p_index) -> decltype(auto) { return p_start[p_index]; };
+    auto chunk_begin = [n, chunks](size_type p_chunk) {
+      return static_cast<size_type>(std::size_t{n} * p_chunk / chunks);
+    };
+
+    // Nearest element to the left that is not greater and nearest element to the right that is less. Ties are broken
+    // like in append_impl, where an equal key to the left is never popped from the stack.
+    std::vector<size_type> left_near(n, npos), right_near(n, npos);
+    // Elements without a left neighbour in the chunk (strictly decreasing) and without a right one (non-decreasing).
+    std::vector<std::vector<size_type>> left_spines(chunks), right_spines(chunks);
+
+    run_chunks(chunks, [&](size_type p_chunk) {
+      auto &stack = right_spines[p_chunk];
+      for (size_type i = chunk_begin(p_chunk), end = chunk_begin(p_chunk + 1); i < end; ++i) {
+        while (!stack.empty() && m_comp(key(i), key(stack.back()))) {
+          right_near[stack.back()] = i;
+          stack.pop_back();
+        }
+        if (stack.empty()) {
+          left_spines[p_chunk].push_back(i);
+        } else {
+          left_near[i] = stack.back();
+        }
+        stack.push_back(i);
+      }
+    });
+
+    // The last element of the left spine is the leftmost minimum of the chunk.
+    auto chunk_min = [&](size_type p_chunk) -> decltype(auto) { return key(left_spines[p_chunk].back()); };
+
+    run_chunks(chunks, [&](size_type p_chunk) {
+      for (auto i : left_spines[p_chunk]) {
+        for (size_type c = p_chunk; c-- > 0;) {
+          if (m_comp(key(i), chunk_min(c))) continue;
+          const auto &spine = right_spines[c];
+          auto found = std::partition_point(spine.begin(), spine.end(),
+                                            [&](size_type p_other) { return !m_comp(key(i), key(p_other)); });
+          left_near[i] = *std::prev(found);
+          break;
+        }
+      }
+
+      for (auto i : right_spines[p_chunk]) {
+        for (size_type c = p_chunk + 1; c < chunks; ++c) {
+          if (!m_comp(chunk_min(c), key(i))) continue;
+          const auto &spine = left_spines[c];
+          right_near[i] = *std::partition_point(spine.begin(), spine.end(),
+                                                [&](size_type p_other) { return !m_comp(key(p_other), key(i)); });
+          break;
+        }
+      }
+    });
+
+    m_tree_vec.resize(n + 1);
+    run_chunks(chunks, [&](size_type p_chunk) {
+      for (size_type i = chunk_begin(p_chunk), end = chunk_begin(p_chunk + 1); i < end; ++i) {
+        const size_type left = left_near[i], right = right_near[i];
+        if (left == npos && right == npos) continue;
+
+        // The parent is the greater neighbour. On a tie the right one is deeper, because it couldn't pop the left one.
+        if (right != npos && (left == npos || !m_comp(key(right), key(left)))) {
+          m_tree_vec[i + 1].m_parent = right + 1;
+          m_tree_vec[right + 1].m_left = i + 1;
+        } else {
+          m_tree_vec[i + 1].m_parent = left + 1;
+          m_tree_vec[left + 1].m_right = i + 1;
+        }
+      }
+    });
+
+    m_root = left_spines[0].back() + 1;
+    for (size_type c = 1; c < chunks; ++c) {
+      if (m_comp(chunk_min(c), key(m_root - 1))) m_root = left_spines[c].back() + 1;
+    }
+
+    m_rightmost = n;
+    for (size_type curr = m_root; curr; curr = m_tree_vec[curr].m_right) {
+      m_key_stack.push(key(curr - 1));
+    }
+  }
+
 public:
   template <typename t_stream> void dump(t_stream &p_ostream) const {
     p_ostream << "digraph {\n";
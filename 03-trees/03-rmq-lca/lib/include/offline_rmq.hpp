@@ -13,14 +13,22 @@
  * 1. Reduce RMQ to LCA by constructing a Cartesian Tree.
  * 2. Traverse the tree in DFS (more similar to Euler tour). During traversal an additional array of visited flags is maintained.
  * 3. Apply Tarjan's algorithm using a Disjoint Set Union.
+ * If the data is given by random access iterators, the Cartesian tree is constructed in parallel.
+ *
+ * compact_offline_rmq_solver implements the same algorithm with memory-lean data layout for large batches of queries:
+ * queries are counting-sorted into CSR arrays instead of a hash map of vectors, visited flags are a plain bitmap and
+ * the Cartesian tree and the DSU are stored as a structure of arrays without bounds checks.
  *
  */
 
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <list>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -62,9 +70,16 @@ protected:
                           t_query_inp_iter p_finish_q)
       : m_map{}, m_dsu{}, m_queries{}, m_ans{} {
     unsigned i = 0;
-    for (; p_start_dat != p_finish_dat; ++p_start_dat, ++i) {
-      m_map.append(*p_start_dat);
-      m_dsu.append_set(0);
+    if constexpr (std::random_access_iterator<t_data_inp_iter>) {
+      m_map = map_type{p_start_dat, p_finish_dat, std::thread::hardware_concurrency()};
+      for (; i < m_map.size(); ++i) {
+        m_dsu.append_set(0);
+      }
+    } else {
+      for (; p_start_dat != p_finish_dat; ++p_start_dat, ++i) {
+        m_map.append(*p_start_dat);
+        m_dsu.append_set(0);
+      }
     }
     m_visited.resize(i, false);
 
@@ -207,6 +222,175 @@ public:
   }
 };
 
+template <typename T, typename t_comp = std::less<T>> class compact_offline_rmq_solver {
+  using size_type = unsigned;
+  static constexpr size_type npos = ~size_type{0};
+
+  struct query_entry {
+    size_type m_other;
+    size_type m_id;
+  };
+
+  // Cartesian tree.
+  std::vector<size_type> m_parent, m_left, m_right;
+  size_type m_root;
+
+  // Disjoint set union with the current ancestor of every set stored at its representative.
+  std::vector<size_type> m_dsu_parent, m_ancestor;
+  std::vector<std::uint8_t> m_rank;
+
+  // Queries in CSR format. Entries of the element i are m_entries[m_offsets[i] .. m_offsets[i + 1]).
+  std::vector<size_type> m_offsets;
+  std::vector<query_entry> m_entries;
+
+  std::vector<std::uint64_t> m_visited;
+  std::vector<unsigned> m_ans;
+
+  bool visited(size_type p_index) const {
+    return m_visited[p_index / 64] & (std::uint64_t{1} << (p_index % 64));
+  }
+
+  void set_visited(size_type p_index) {
+    m_visited[p_index / 64] |= std::uint64_t{1} << (p_index % 64);
+  }
+
+  size_type find_set(size_type p_index) {
+    while (m_dsu_parent[p_index] != p_index) {
+      m_dsu_parent[p_index] = m_dsu_parent[m_dsu_parent[p_index]]; // Path halving.
+      p_index = m_dsu_parent[p_index];
+    }
+    return p_index;
+  }
+
+  // Merge the set of p_child into the set of p_curr, p_curr stays the ancestor of the union.
+  void union_with_child(size_type p_curr, size_type p_child) {
+    size_type curr = find_set(p_curr), child = find_set(p_child);
+    if (m_rank[curr] < m_rank[child]) std::swap(curr, child);
+    m_dsu_parent[child] = curr;
+    if (m_rank[curr] == m_rank[child]) ++m_rank[curr];
+    m_ancestor[curr] = p_curr;
+  }
+
+  template <typename t_data_inp_iter> void build_tree(t_data_inp_iter p_start, t_data_inp_iter p_finish) {
+    std::vector<size_type> index_stack{};
+    std::vector<T> key_stack{};
+    t_comp comp{};
+
+    for (size_type i = 0; p_start != p_finish; ++p_start, ++i) {
+      m_parent.push_back(npos);
+      m_left.push_back(npos);
+      m_right.push_back(npos);
+
+      size_type last_popped = npos;
+      while (!key_stack.empty() && comp(*p_start, key_stack.back())) {
+        last_popped = index_stack.back();
+        index_stack.pop_back();
+        key_stack.pop_back();
+      }
+
+      if (last_popped != npos) {
+        m_left[i] = last_popped;
+        m_parent[last_popped] = i;
+      }
+
+      if (!index_stack.empty()) {
+        m_right[index_stack.back()] = i;
+        m_parent[i] = index_stack.back();
+      }
+
+      index_stack.push_back(i);
+      key_stack.push_back(*p_start);
+    }
+
+    m_root = (index_stack.empty() ? npos : index_stack.front());
+  }
+
+  // Queries are traversed twice, first to count entries of every element and then to fill the buckets.
+  template <typename t_query_fwd_iter> void bucket_queries(t_query_fwd_iter p_start, t_query_fwd_iter p_finish) {
+    const size_type n = m_parent.size();
+
+    size_type count = 0;
+    m_offsets.assign(n + 1, 0);
+    for (auto it = p_start; it != p_finish; ++it, ++count) {
+      ++m_offsets[it->first + 1];
+      ++m_offsets[it->second + 1];
+    }
+
+    for (size_type i = 0; i < n; ++i) {
+      m_offsets[i + 1] += m_offsets[i];
+    }
+
+    std::vector<size_type> fill{m_offsets.begin(), m_offsets.end() - 1};
+    m_entries.resize(std::size_t{2} * count);
+    for (size_type id = 0; p_start != p_finish; ++p_start, ++id) {
+      m_entries[fill[p_start->first]++] = {p_start->second, id};
+      m_entries[fill[p_start->second]++] = {p_start->first, id};
+    }
+
+    m_ans.resize(count);
+  }
+
+  void write_ans_after_subtree_complete(size_type p_curr) {
+    for (size_type i = m_offsets[p_curr], end = m_offsets[p_curr + 1]; i < end; ++i) {
+      const auto &entry = m_entries[i];
+      if (visited(entry.m_other)) m_ans[entry.m_id] = m_ancestor[find_set(entry.m_other)];
+    }
+  }
+
+public:
+  template <typename t_data_inp_iter, typename t_query_fwd_iter>
+  compact_offline_rmq_solver(t_data_inp_iter p_start_dat, t_data_inp_iter p_finish_dat, t_query_fwd_iter p_start_q,
+                             t_query_fwd_iter p_finish_q) {
+    build_tree(p_start_dat, p_finish_dat);
+    const size_type n = m_parent.size();
+
+    m_dsu_parent.resize(n);
+    for (size_type i = 0; i < n; ++i) {
+      m_dsu_parent[i] = i;
+    }
+    m_ancestor = m_dsu_parent;
+    m_rank.assign(n, 0);
+    m_visited.assign((n + 63) / 64, 0);
+
+    bucket_queries(p_start_q, p_finish_q);
+  }
+
+  // Same traversal as in iterative_offline_rmq_solver, but the direction is determined by the node we came from.
+  void fill_ans() {
+    size_type curr = m_root, prev = npos;
+
+    while (curr != npos) {
+      const size_type parent = m_parent[curr], left = m_left[curr], right = m_right[curr];
+
+      if (prev == parent) {
+        set_visited(curr);
+        if (left != npos || right != npos) {
+          prev = curr;
+          curr = (left != npos ? left : right);
+          continue;
+        }
+      } else if (prev == left) {
+        union_with_child(curr, left);
+        if (right != npos) {
+          prev = curr;
+          curr = right;
+          continue;
+        }
+      } else {
+        union_with_child(curr, right);
+      }
+
+      write_ans_after_subtree_complete(curr);
+      prev = curr;
+      curr = parent;
+    }
+  }
+
+  std::vector<unsigned> get_ans() && {
+    return std::move(m_ans);
+  }
+};
+
 } // namespace detail
 
 template <typename T, typename t_comp, typename t_data_inp_iter, typename t_query_inp_iter>
@@ -225,4 +409,12 @@ std::vector<unsigned> iterative_offline_rmq(t_data_inp_iter p_start_dat, t_data_
   return std::move(solver).get_ans();
 }
 
+template <typename T, typename t_comp, typename t_data_inp_iter, typename t_query_fwd_iter>
+std::vector<unsigned> compact_offline_rmq(t_data_inp_iter p_start_dat, t_data_inp_iter p_finish_dat,
+                                          t_query_fwd_iter p_start_q, t_query_fwd_iter p_finish_q) {
+  detail::compact_offline_rmq_solver<T, t_comp> solver{p_start_dat, p_finish_dat, p_start_q, p_finish_q};
+  solver.fill_ans();
+  return std::move(solver).get_ans();
+}
+
 } // namespace throttle
\ No newline at end of file
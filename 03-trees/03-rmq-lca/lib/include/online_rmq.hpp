@@ -0,0 +1,183 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* This file contains two structures for answering RMQ online, i.e. a query is answered as soon as it's asked, as
+ * opposed to offline_rmq.hpp where all queries have to be known beforehand. Both structures are built once over a
+ * static array and answer query(l, r) with the index of the minimum on the closed range [l, r] in O(1). If there are
+ * several minimal elements the leftmost one is returned, same as the offline solvers do.
+ * 1. sparse_table_rmq stores the answer for every range of length 2^k, which takes O(n log n) memory. It's the
+ *    fastest option for small arrays.
+ * 2. block_rmq splits the array into blocks of 64 elements. Inside a block the minimum is found with a bitmask of the
+ *    monotonic stack, and a sparse table is built over block minima only. Memory is O(n) with a small constant, so it
+ *    can handle arrays of 10^9 elements.
+ *
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace throttle {
+
+template <typename T, typename t_comp = std::less<T>> class sparse_table_rmq {
+public:
+  using size_type = unsigned;
+  using value_type = T;
+  using comp = t_comp;
+
+private:
+  std::vector<T> m_data;
+  // Level k is stored at offset k * size() and holds the index of the minimum on [i, i + 2^k) for every valid i.
+  std::vector<size_type> m_table;
+  t_comp m_comp;
+
+  size_type better(size_type p_lhs, size_type p_rhs) const {
+    return (m_comp(m_data[p_rhs], m_data[p_lhs]) ? p_rhs : p_lhs);
+  }
+
+  void build() {
+    const size_type n = size();
+    if (!n) return;
+
+    const size_type levels = std::bit_width(n);
+    m_table.resize(std::size_t{levels} * n);
+    for (size_type i = 0; i < n; ++i) {
+      m_table[i] = i;
+    }
+
+    for (size_type k = 1; k < levels; ++k) {
+      const size_type *prev = m_table.data() + std::size_t{k - 1} * n;
+      size_type *curr = m_table.data() + std::size_t{k} * n;
+      const size_type half = size_type{1} << (k - 1);
+      for (size_type i = 0; i + 2 * half <= n; ++i) {
+        curr[i] = better(prev[i], prev[i + half]);
+      }
+    }
+  }
+
+public:
+  sparse_table_rmq() = default;
+
+  template <typename t_inp_iter> sparse_table_rmq(t_inp_iter p_start, t_inp_iter p_finish) : m_data{p_start, p_finish} {
+    build();
+  }
+
+  size_type size() const {
+    return m_data.size();
+  }
+
+  bool empty() const {
+    return m_data.empty();
+  }
+
+  const T &operator[](size_type p_index) const {
+    return m_data[p_index];
+  }
+
+  // Index of the minimum on [p_left, p_right]. Requires p_left <= p_right < size().
+  size_type query(size_type p_left, size_type p_right) const {
+    const size_type k = std::bit_width(p_right - p_left + 1) - 1;
+    const size_type *level = m_table.data() + std::size_t{k} * size();
+    return better(level[p_left], level[p_right + 1 - (size_type{1} << k)]);
+  }
+};
+
+template <typename T, typename t_comp = std::less<T>> class block_rmq {
+public:
+  using size_type = unsigned;
+  using value_type = T;
+  using comp = t_comp;
+
+private:
+  using mask_type = std::uint64_t;
+  static constexpr size_type block_size = 64;
+
+  std::vector<T> m_data;
+  // Bit j of m_masks[i] is set if the element at offset j of the block is on the monotonic stack after pushing element
+  // i. Stack elements are not greater than anything to the right of them, so the lowest set bit not below offset l is
+  // the minimum on [l, i].
+  std::vector<mask_type> m_masks;
+  std::vector<size_type> m_block_min; // Index of the minimum of each block.
+  sparse_table_rmq<T, t_comp> m_blocks;
+  t_comp m_comp;
+
+  size_type better(size_type p_lhs, size_type p_rhs) const {
+    return (m_comp(m_data[p_rhs], m_data[p_lhs]) ? p_rhs : p_lhs);
+  }
+
+  // Both indices have to be in the same block.
+  size_type in_block_query(size_type p_left, size_type p_right) const {
+    const mask_type mask = m_masks[p_right] & (~mask_type{0} << (p_left % block_size));
+    return p_right - p_right % block_size + std::countr_zero(mask);
+  }
+
+  void build() {
+    const size_type n = size();
+    m_masks.resize(n);
+
+    for (size_type start = 0; start < n; start += block_size) {
+      const size_type finish = (n - start > block_size ? start + block_size : n);
+      mask_type stack = 0;
+      for (size_type i = start; i < finish; ++i) {
+        // Pop strictly greater elements only, so that equal ones to the left stay and the leftmost minimum wins.
+        while (stack && m_comp(m_data[i], m_data[start + std::bit_width(stack) - 1])) {
+          stack &= ~(mask_type{1} << (std::bit_width(stack) - 1));
+        }
+        stack |= mask_type{1} << (i - start);
+        m_masks[i] = stack;
+      }
+      m_block_min.push_back(in_block_query(start, finish - 1));
+    }
+
+    std::vector<T> minima{};
+    minima.reserve(m_block_min.size());
+    for (auto i : m_block_min) {
+      minima.push_back(m_data[i]);
+    }
+    m_blocks = sparse_table_rmq<T, t_comp>{minima.begin(), minima.end()};
+  }
+
+public:
+  block_rmq() = default;
+
+  template <typename t_inp_iter> block_rmq(t_inp_iter p_start, t_inp_iter p_finish) : m_data{p_start, p_finish} {
+    build();
+  }
+
+  size_type size() const {
+    return m_data.size();
+  }
+
+  bool empty() const {
+    return m_data.empty();
+  }
+
+  const T &operator[](size_type p_index) const {
+    return m_data[p_index];
+  }
+
+  // Index of the minimum on [p_left, p_right]. Requires p_left <= p_right < size().
+  size_type query(size_type p_left, size_type p_right) const {
+    const size_type left_block = p_left / block_size, right_block = p_right / block_size;
+    if (left_block == right_block) return in_block_query(p_left, p_right);
+
+    size_type ans = in_block_query(p_left, left_block * block_size + block_size - 1);
+    if (left_block + 1 < right_block) {
+      ans = better(ans, m_block_min[m_blocks.query(left_block + 1, right_block - 1)]);
+    }
+    return better(ans, in_block_query(right_block * block_size, p_right));
+  }
+};
+
+} // namespace throttle
@@ -0,0 +1,286 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* This file contains LCA solvers for arbitrary rooted forests, as opposed to offline_rmq.hpp which only works with
+ * Cartesian trees of arrays.
+ * 1. rooted_forest stores the forest as a parent array and children in CSR format. It can be constructed from a parent
+ *    array or from an undirected edge list. Traversal is iterative, so paths of 10^7 vertices don't overflow the stack.
+ * 2. offline_lca answers a batch of queries with Tarjan's algorithm using indexed_disjoint_map.
+ * 3. euler_tour_lca answers queries online in O(1) by reducing LCA to RMQ over depths of the Euler tour with block_rmq.
+ * Vertices from different trees of the forest don't have a common ancestor, npos is returned for them.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "indexed_disjoint_map.hpp"
+#include "online_rmq.hpp"
+
+namespace throttle {
+
+class rooted_forest {
+public:
+  using size_type = unsigned;
+  static constexpr size_type npos = ~size_type{0};
+
+private:
+  std::vector<size_type> m_parent;
+  std::vector<size_type> m_roots;
+  // Children of the vertex i are m_children[m_child_offsets[i] .. m_child_offsets[i + 1]).
+  std::vector<size_type> m_child_offsets;
+  std::vector<size_type> m_children;
+
+  void build_children() {
+    const size_type n = size();
+    m_child_offsets.assign(n + 1, 0);
+    for (size_type i = 0; i < n; ++i) {
+      if (m_parent[i] == npos) {
+        m_roots.push_back(i);
+      } else {
+        ++m_child_offsets[m_parent[i] + 1];
+      }
+    }
+
+    for (size_type i = 0; i < n; ++i) {
+      m_child_offsets[i + 1] += m_child_offsets[i];
+    }
+
+    std::vector<size_type> fill{m_child_offsets.begin(), m_child_offsets.end() - 1};
+    m_children.resize(n - m_roots.size());
+    for (size_type i = 0; i < n; ++i) {
+      if (m_parent[i] != npos) m_children[fill[m_parent[i]]++] = i;
+    }
+
+    size_type reached = 0;
+    traverse([&reached](size_type) { ++reached; }, [](size_type) {});
+    if (reached != n) throw std::invalid_argument("Parent array contains a cycle");
+  }
+
+public:
+  rooted_forest() = default;
+
+  // A vertex is a root if its parent is itself or npos.
+  template <typename t_inp_iter> static rooted_forest from_parents(t_inp_iter p_start, t_inp_iter p_finish) {
+    rooted_forest forest{};
+    forest.m_parent.assign(p_start, p_finish);
+
+    const size_type n = forest.size();
+    for (size_type i = 0; i < n; ++i) {
+      size_type &parent = forest.m_parent[i];
+      if (parent == i) parent = npos;
+      if (parent != npos && parent >= n) throw std::out_of_range("Parent index is out of range");
+    }
+
+    forest.build_children();
+    return forest;
+  }
+
+  // Edges are undirected. Every connected component is rooted at its vertex with the smallest index.
+  template <typename t_inp_iter>
+  static rooted_forest from_edges(size_type p_size, t_inp_iter p_start, t_inp_iter p_finish) {
+    std::vector<std::pair<size_type, size_type>> edges{p_start, p_finish};
+
+    std::vector<size_type> offsets(p_size + 1, 0);
+    for (const auto &e : edges) {
+      if (e.first >= p_size || e.second >= p_size) throw std::out_of_range("Edge vertex is out of range");
+      ++offsets[e.first + 1];
+      ++offsets[e.second + 1];
+    }
+
+    for (size_type i = 0; i < p_size; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<size_type> fill{offsets.begin(), offsets.end() - 1}, adjacent(2 * edges.size());
+    for (const auto &e : edges) {
+      adjacent[fill[e.first]++] = e.second;
+      adjacent[fill[e.second]++] = e.first;
+    }
+
+    rooted_forest forest{};
+    forest.m_parent.assign(p_size, npos);
+    std::vector<bool> visited(p_size, false);
+    std::vector<size_type> stack{};
+
+    for (size_type root = 0; root < p_size; ++root) {
+      if (visited[root]) continue;
+      visited[root] = true;
+      stack.push_back(root);
+
+      while (!stack.empty()) {
+        size_type curr = stack.back();
+        stack.pop_back();
+        for (size_type i = offsets[curr]; i < offsets[curr + 1]; ++i) {
+          size_type next = adjacent[i];
+          if (next == forest.m_parent[curr]) continue;
+          if (visited[next]) throw std::invalid_argument("Edge list contains a cycle");
+          visited[next] = true;
+          forest.m_parent[next] = curr;
+          stack.push_back(next);
+        }
+      }
+    }
+
+    forest.build_children();
+    return forest;
+  }
+
+  size_type size() const {
+    return m_parent.size();
+  }
+
+  bool empty() const {
+    return m_parent.empty();
+  }
+
+  size_type parent(size_type p_vertex) const {
+    return m_parent.at(p_vertex);
+  }
+
+  const std::vector<size_type> &roots() const {
+    return m_roots;
+  }
+
+  // Iterative depth-first traversal of every tree in the forest. p_enter is called when a vertex is discovered and
+  // p_exit when its whole subtree has been traversed.
+  template <typename t_enter, typename t_exit> void traverse(t_enter p_enter, t_exit p_exit) const {
+    std::vector<std::pair<size_type, size_type>> stack{}; // Vertex and position of the next child to visit.
+
+    for (auto root : m_roots) {
+      p_enter(root);
+      stack.push_back({root, m_child_offsets[root]});
+
+      while (!stack.empty()) {
+        auto &[curr, next] = stack.back();
+        if (next == m_child_offsets[curr + 1]) {
+          size_type finished = curr;
+          stack.pop_back();
+          p_exit(finished);
+          continue;
+        }
+
+        size_type child = m_children[next++];
+        p_enter(child);
+        stack.push_back({child, m_child_offsets[child]});
+      }
+    }
+  }
+};
+
+// Queries are traversed twice to bucket them in CSR format, so forward iterators are required.
+template <typename t_query_fwd_iter>
+std::vector<unsigned> offline_lca(const rooted_forest &p_forest, t_query_fwd_iter p_start_q,
+                                  t_query_fwd_iter p_finish_q) {
+  using size_type = rooted_forest::size_type;
+  const size_type n = p_forest.size();
+
+  size_type count = 0;
+  std::vector<size_type> offsets(n + 1, 0);
+  for (auto it = p_start_q; it != p_finish_q; ++it, ++count) {
+    if (it->first >= n || it->second >= n) throw std::out_of_range("Query vertex is out of range");
+    ++offsets[it->first + 1];
+    ++offsets[it->second + 1];
+  }
+
+  for (size_type i = 0; i < n; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  std::vector<size_type> fill{offsets.begin(), offsets.end() - 1};
+  std::vector<std::pair<size_type, size_type>> queries(std::size_t{2} * count); // Other vertex and query id.
+  for (size_type id = 0; p_start_q != p_finish_q; ++p_start_q, ++id) {
+    queries[fill[p_start_q->first]++] = {p_start_q->second, id};
+    queries[fill[p_start_q->second]++] = {p_start_q->first, id};
+  }
+
+  std::vector<unsigned> ans(count, rooted_forest::npos);
+  indexed_disjoint_map<size_type> dsu{};
+  for (size_type i = 0; i < n; ++i) {
+    dsu.append_set(i);
+  }
+
+  // Vertices of different trees never share a set, but a visited vertex of an earlier tree still has an ancestor, so
+  // the tree of every vertex is remembered to tell them apart.
+  std::vector<size_type> tree_of(n, rooted_forest::npos);
+  std::vector<bool> visited(n, false);
+
+  p_forest.traverse(
+      [&](size_type p_vertex) {
+        const size_type parent = p_forest.parent(p_vertex);
+        tree_of[p_vertex] = (parent == rooted_forest::npos ? p_vertex : tree_of[parent]);
+        visited[p_vertex] = true;
+      },
+      [&](size_type p_vertex) {
+        for (size_type i = offsets[p_vertex]; i < offsets[p_vertex + 1]; ++i) {
+          const auto [other, id] = queries[i];
+          if (visited[other] && tree_of[other] == tree_of[p_vertex]) ans[id] = *dsu.find_set(other);
+        }
+
+        const size_type parent = p_forest.parent(p_vertex);
+        if (parent == rooted_forest::npos) return;
+        dsu.union_set(parent, p_vertex);
+        *dsu.find_set(parent) = parent;
+      });
+
+  return ans;
+}
+
+class euler_tour_lca {
+public:
+  using size_type = rooted_forest::size_type;
+  static constexpr size_type npos = rooted_forest::npos;
+
+private:
+  std::vector<size_type> m_tour;  // Vertices in the order of the Euler tour.
+  std::vector<size_type> m_first; // Position of the first occurrence of every vertex in the tour.
+  std::vector<size_type> m_tree_of;
+  block_rmq<size_type> m_depths;
+
+public:
+  euler_tour_lca() = default;
+
+  euler_tour_lca(const rooted_forest &p_forest) : m_first(p_forest.size()), m_tree_of(p_forest.size()) {
+    std::vector<size_type> depth(p_forest.size()), tour_depths{};
+    m_tour.reserve(2 * p_forest.size());
+    tour_depths.reserve(2 * p_forest.size());
+
+    p_forest.traverse(
+        [&](size_type p_vertex) {
+          const size_type parent = p_forest.parent(p_vertex);
+          depth[p_vertex] = (parent == npos ? 0 : depth[parent] + 1);
+          m_tree_of[p_vertex] = (parent == npos ? p_vertex : m_tree_of[parent]);
+          m_first[p_vertex] = m_tour.size();
+          m_tour.push_back(p_vertex);
+          tour_depths.push_back(depth[p_vertex]);
+        },
+        [&](size_type p_vertex) {
+          const size_type parent = p_forest.parent(p_vertex);
+          if (parent == npos) return;
+          m_tour.push_back(parent);
+          tour_depths.push_back(depth[parent]);
+        });
+
+    m_depths = block_rmq<size_type>{tour_depths.begin(), tour_depths.end()};
+  }
+
+  size_type query(size_type p_first, size_type p_second) const {
+    if (m_tree_of.at(p_first) != m_tree_of.at(p_second)) return npos;
+    size_type left = m_first[p_first], right = m_first[p_second];
+    if (left > right) std::swap(left, right);
+    return m_tour[m_depths.query(left, right)];
+  }
+};
+
+} // namespace throttle
@@ -6,7 +6,247 @@
 #include <iterator>
 #include <numeric>
 #include <set>
+#include <random>
 #include <string>
+#include <vector>
+
+#include "cartesian_set.hpp"
+#include "offline_rmq.hpp"
+#include "online_rmq.hpp"
+#include "tree_lca.hpp"
+
+namespace {
+unsigned brute_force_rmq(const std::vector<int> &p_vec, unsigned p_left, unsigned p_right) {
+  return std::min_element(p_vec.begin() + p_left, p_vec.begin() + p_right + 1) - p_vec.begin();
+}
+
+template <typename t_rmq> void check_all_ranges(const std::vector<int> &p_vec) {
+  t_rmq rmq{p_vec.begin(), p_vec.end()};
+  ASSERT_EQ(rmq.size(), p_vec.size());
+  for (unsigned l = 0; l < p_vec.size(); ++l) {
+    for (unsigned r = l; r < p_vec.size(); ++r) {
+      ASSERT_EQ(rmq.query(l, r), brute_force_rmq(p_vec, l, r)) << "range [" << l << ", " << r << "]";
+    }
+  }
+}
+} // namespace
+
+TEST(test_online_rmq, test_1) {
+  std::vector<int> vec{5, 10, 12, 3, 14};
+  throttle::sparse_table_rmq<int> sparse{vec.begin(), vec.end()};
+  throttle::block_rmq<int> block{vec.begin(), vec.end()};
+
+  EXPECT_EQ(sparse.query(0, 3), 3);
+  EXPECT_EQ(sparse.query(0, 1), 0);
+  EXPECT_EQ(sparse.query(2, 4), 3);
+  EXPECT_EQ(block.query(0, 3), 3);
+  EXPECT_EQ(block.query(0, 1), 0);
+  EXPECT_EQ(block.query(2, 4), 3);
+}
+
+TEST(test_online_rmq, test_2) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> dist{-50, 50};
+  std::vector<int> vec(300);
+  std::generate(vec.begin(), vec.end(), [&]() { return dist(gen); });
+
+  check_all_ranges<throttle::sparse_table_rmq<int>>(vec);
+  check_all_ranges<throttle::block_rmq<int>>(vec);
+}
+
+TEST(test_online_rmq, test_3) {
+  std::vector<int> vec(200, 7); // All minima are ties, the leftmost one is expected.
+  check_all_ranges<throttle::sparse_table_rmq<int>>(vec);
+  check_all_ranges<throttle::block_rmq<int>>(vec);
+
+  std::vector<int> decreasing(200);
+  std::iota(decreasing.rbegin(), decreasing.rend(), 0);
+  check_all_ranges<throttle::block_rmq<int>>(decreasing);
+}
+
+TEST(test_online_rmq, test_4) {
+  std::mt19937 gen{1337};
+  std::uniform_int_distribution<int> dist{0, 1000};
+  std::vector<int> vec(10000);
+  std::generate(vec.begin(), vec.end(), [&]() { return dist(gen); });
+
+  std::vector<std::pair<unsigned, unsigned>> q_vec{};
+  std::uniform_int_distribution<unsigned> index_dist{0, static_cast<unsigned>(vec.size() - 1)};
+  for (unsigned i = 0; i < 10000; ++i) {
+    auto a = index_dist(gen), b = index_dist(gen);
+    if (a == b) continue;
+    q_vec.push_back({std::min(a, b), std::max(a, b)});
+  }
+
+  auto offline =
+      throttle::iterative_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  throttle::block_rmq<int> block{vec.begin(), vec.end()};
+  throttle::sparse_table_rmq<int> sparse{vec.begin(), vec.end()};
+
+  for (unsigned i = 0; i < q_vec.size(); ++i) {
+    EXPECT_EQ(block.query(q_vec[i].first, q_vec[i].second), offline[i]);
+    EXPECT_EQ(sparse.query(q_vec[i].first, q_vec[i].second), offline[i]);
+  }
+}
+
+TEST(test_offline_rmq, test_1) {
+  std::vector<int> vec{5, 10, 12, 3, 14};
+  std::vector<std::pair<unsigned, unsigned>> q_vec{{0, 3}, {0, 1}, {2, 4}};
+  auto ans = throttle::compact_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  EXPECT_EQ(ans, (std::vector<unsigned>{3, 0, 3}));
+}
+
+TEST(test_offline_rmq, test_2) {
+  std::mt19937 gen{7};
+  std::uniform_int_distribution<int> dist{0, 100};
+  std::vector<int> vec(5000);
+  std::generate(vec.begin(), vec.end(), [&]() { return dist(gen); });
+  std::sort(vec.begin(), vec.begin() + 2500); // Degenerate Cartesian tree on the first half.
+
+  std::vector<std::pair<unsigned, unsigned>> q_vec{};
+  std::uniform_int_distribution<unsigned> index_dist{0, static_cast<unsigned>(vec.size() - 1)};
+  for (unsigned i = 0; i < 20000; ++i) {
+    auto a = index_dist(gen), b = index_dist(gen);
+    q_vec.push_back({std::min(a, b), std::max(a, b)});
+  }
+
+  auto ans = throttle::compact_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  for (unsigned i = 0; i < q_vec.size(); ++i) {
+    EXPECT_EQ(ans[i], brute_force_rmq(vec, q_vec[i].first, q_vec[i].second));
+  }
+}
+
+namespace {
+unsigned brute_force_lca(const throttle::rooted_forest &p_forest, unsigned p_first, unsigned p_second) {
+  std::set<unsigned> ancestors{};
+  for (unsigned v = p_first; v != throttle::rooted_forest::npos; v = p_forest.parent(v)) {
+    ancestors.insert(v);
+  }
+  for (unsigned v = p_second; v != throttle::rooted_forest::npos; v = p_forest.parent(v)) {
+    if (ancestors.count(v)) return v;
+  }
+  return throttle::rooted_forest::npos;
+}
+} // namespace
+
+TEST(test_tree_lca, test_1) {
+  /*        0
+   *      / | \
+   *     1  2  3
+   *    / \     \
+   *   4   5     6
+   */
+  std::vector<unsigned> parents{0, 0, 0, 0, 1, 1, 3};
+  auto forest = throttle::rooted_forest::from_parents(parents.begin(), parents.end());
+  std::vector<std::pair<unsigned, unsigned>> q_vec{{4, 5}, {4, 6}, {1, 4}, {2, 2}, {5, 2}};
+  std::vector<unsigned> expected{1, 0, 1, 2, 0};
+
+  EXPECT_EQ(throttle::offline_lca(forest, q_vec.begin(), q_vec.end()), expected);
+
+  throttle::euler_tour_lca online{forest};
+  for (unsigned i = 0; i < q_vec.size(); ++i) {
+    EXPECT_EQ(online.query(q_vec[i].first, q_vec[i].second), expected[i]);
+  }
+}
+
+TEST(test_tree_lca, test_2) {
+  std::mt19937 gen{42};
+  const unsigned n = 3000;
+  std::vector<unsigned> parents(n);
+  for (unsigned i = 0; i < n; ++i) {
+    // Every 500th vertex starts a new tree, so that some queries don't have an answer.
+    parents[i] = (i % 500 == 0 ? throttle::rooted_forest::npos : i - 1 - gen() % std::min(i % 500, 20u));
+  }
+
+  auto forest = throttle::rooted_forest::from_parents(parents.begin(), parents.end());
+  EXPECT_EQ(forest.roots().size(), 6);
+
+  std::vector<std::pair<unsigned, unsigned>> q_vec{};
+  for (unsigned i = 0; i < 5000; ++i) {
+    q_vec.push_back({static_cast<unsigned>(gen() % n), static_cast<unsigned>(gen() % n)});
+  }
+
+  auto offline = throttle::offline_lca(forest, q_vec.begin(), q_vec.end());
+  throttle::euler_tour_lca online{forest};
+  for (unsigned i = 0; i < q_vec.size(); ++i) {
+    auto expected = brute_force_lca(forest, q_vec[i].first, q_vec[i].second);
+    EXPECT_EQ(offline[i], expected);
+    EXPECT_EQ(online.query(q_vec[i].first, q_vec[i].second), expected);
+  }
+}
+
+TEST(test_tree_lca, test_3) {
+  // A path this long would overflow the stack with recursive traversal.
+  const unsigned n = 1000000;
+  std::vector<std::pair<unsigned, unsigned>> edges{};
+  for (unsigned i = 1; i < n; ++i) {
+    edges.push_back({i, i - 1});
+  }
+
+  auto forest = throttle::rooted_forest::from_edges(n, edges.begin(), edges.end());
+  std::vector<std::pair<unsigned, unsigned>> q_vec{{n - 1, n - 2}, {n - 1, 0}, {12345, 54321}};
+  std::vector<unsigned> expected{n - 2, 0, 12345};
+
+  EXPECT_EQ(throttle::offline_lca(forest, q_vec.begin(), q_vec.end()), expected);
+  throttle::euler_tour_lca online{forest};
+  for (unsigned i = 0; i < q_vec.size(); ++i) {
+    EXPECT_EQ(online.query(q_vec[i].first, q_vec[i].second), expected[i]);
+  }
+}
+
+TEST(test_tree_lca, test_4) {
+  std::vector<unsigned> parents{1, 2, 0, 3};
+  EXPECT_THROW(throttle::rooted_forest::from_parents(parents.begin(), parents.end()), std::invalid_argument);
+
+  std::vector<std::pair<unsigned, unsigned>> edges{{0, 1}, {1, 2}, {2, 0}};
+  EXPECT_THROW(throttle::rooted_forest::from_edges(3, edges.begin(), edges.end()), std::invalid_argument);
+  EXPECT_THROW(throttle::rooted_forest::from_edges(2, edges.begin(), edges.end()), std::out_of_range);
+}
+
+namespace {
+template <typename T> void expect_same_tree(const T &p_lhs, const T &p_rhs) {
+  ASSERT_EQ(p_lhs.size(), p_rhs.size());
+  EXPECT_EQ(p_lhs.root().index(), p_rhs.root().index());
+  for (unsigned i = 0; i < p_lhs.size(); ++i) {
+    auto lhs = p_lhs.at(i), rhs = p_rhs.at(i);
+    auto index_of = [](const auto &p_node) { return (p_node ? p_node.index() : ~0u); };
+    ASSERT_EQ(index_of(lhs.parent()), index_of(rhs.parent())) << "node " << i;
+    ASSERT_EQ(index_of(lhs.left()), index_of(rhs.left())) << "node " << i;
+    ASSERT_EQ(index_of(lhs.right()), index_of(rhs.right())) << "node " << i;
+  }
+}
+} // namespace
+
+TEST(test_cartesian_set, test_1) {
+  std::mt19937 gen{42};
+  // Few distinct values, so that there are a lot of ties.
+  for (int range : {3, 1000, 1000000}) {
+    std::uniform_int_distribution<int> dist{0, range};
+    std::vector<int> vec(1 << 19);
+    std::generate(vec.begin(), vec.end(), [&]() { return dist(gen); });
+
+    throttle::cartesian_set<int> sequential{vec.begin(), vec.end()}, parallel{vec.begin(), vec.end(), 8};
+    expect_same_tree(sequential, parallel);
+
+    // Appending to a tree built in parallel has to work just as well.
+    for (int v : {range / 2, -1, range + 1}) {
+      sequential.append(v);
+      parallel.append(v);
+    }
+    expect_same_tree(sequential, parallel);
+  }
+}
+
+TEST(test_cartesian_set, test_2) {
+  std::vector<int> increasing(1 << 19), decreasing(1 << 19);
+  std::iota(increasing.begin(), increasing.end(), 0);
+  std::iota(decreasing.rbegin(), decreasing.rend(), 0);
+
+  for (const auto &vec : {increasing, decreasing}) {
+    throttle::cartesian_set<int> sequential{vec.begin(), vec.end()}, parallel{vec.begin(), vec.end(), 7};
+    expect_same_tree(sequential, parallel);
+  }
+}
 
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,10 +1,77 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <iostream>
+#include <new>
+#include <string>
+#include <thread>
 
+#include "cartesian_set.hpp"
 #include "offline_rmq.hpp"
+#include "online_rmq.hpp"
 
 #include <cstdlib>
 
+// Global allocation functions are replaced to track peak heap usage of every solver. Each block is prefixed with its
+// size, so that the counter can be decremented on deallocation. Solvers allocate from several threads, so the counters
+// are atomic and the peak is raised with compare-and-swap.
+namespace {
+std::atomic<std::size_t> g_heap_current = 0, g_heap_peak = 0;
+constexpr std::size_t heap_header_size = alignof(std::max_align_t);
+} // namespace
+
+[[gnu::noinline]] void *operator new(std::size_t p_size) {
+  auto *ptr = static_cast<char *>(std::malloc(p_size + heap_header_size));
+  if (!ptr) throw std::bad_alloc{};
+  *reinterpret_cast<std::size_t *>(ptr) = p_size;
+  const auto current = g_heap_current.fetch_add(p_size, std::memory_order_relaxed) + p_size;
+  auto       peak = g_heap_peak.load(std::memory_order_relaxed);
+  while (current > peak && !g_heap_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+  }
+  return ptr + heap_header_size;
+}
+
+[[gnu::noinline]] void operator delete(void *p_ptr) noexcept {
+  if (!p_ptr) return;
+  auto *ptr = static_cast<char *>(p_ptr) - heap_header_size;
+  g_heap_current.fetch_sub(*reinterpret_cast<std::size_t *>(ptr), std::memory_order_relaxed);
+  std::free(ptr);
+}
+
+void operator delete(void *p_ptr, std::size_t) noexcept {
+  operator delete(p_ptr);
+}
+
+// Run p_solve, print its run time and heap usage on top of what was allocated before the call, and return its answers.
+template <typename F> std::vector<unsigned> measure(const std::string &p_name, F p_solve) {
+  const std::size_t heap_before = g_heap_current.load();
+  g_heap_peak.store(heap_before);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  auto ans = p_solve();
+  auto finish = std::chrono::high_resolution_clock::now();
+  auto elapsed = std::chrono::duration<double, std::milli>(finish - start);
+
+  std::cout << p_name << " took " << elapsed.count() << "ms to run, peak memory "
+            << static_cast<double>(g_heap_peak.load() - heap_before) / (1 << 20) << "MiB\n";
+  return ans;
+}
+
+// Online structures are measured together with their construction, so that the numbers are comparable to the offline
+// solvers, which build a Cartesian tree for every batch of queries.
+template <typename t_rmq>
+std::vector<unsigned> online_rmq(const std::vector<int> &p_vec,
+                                 const std::vector<std::pair<unsigned, unsigned>> &p_q_vec) {
+  t_rmq rmq{p_vec.begin(), p_vec.end()};
+  std::vector<unsigned> ans{};
+  ans.reserve(p_q_vec.size());
+  for (const auto &q : p_q_vec) {
+    ans.push_back(rmq.query(q.first, q.second));
+  }
+  return ans;
+}
+
 int main() {
   unsigned n, m;
   if (!(std::cin >> n)) {
@@ -42,23 +109,45 @@ int main() {
     q_vec.push_back({left, right});
   }
 
-  auto recursive_start = std::chrono::high_resolution_clock::now();
-  auto &&ans_rec =
-      throttle::recursive_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
-  auto recursive_finish = std::chrono::high_resolution_clock::now();
-  auto recursive_elapsed = std::chrono::duration<double, std::milli>(recursive_finish - recursive_start);
+  // Scaling of Cartesian tree construction, which is the first stage of offline solvers.
+  const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  double sequential_ms = 0;
+  for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    auto start = std::chrono::high_resolution_clock::now();
+    throttle::cartesian_set<int> tree{vec.begin(), vec.end(), threads};
+    auto finish = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration<double, std::milli>(finish - start).count();
+    if (threads == 1) sequential_ms = elapsed;
+
+    std::cout << "throttle::cartesian_set construction with " << threads << " threads took " << elapsed
+              << "ms to run, speedup " << sequential_ms / elapsed << "\n";
+    if (threads == max_threads) break;
+  }
+
+  using ans_type = std::vector<unsigned>;
+  auto ans_rec = measure("throttle::recursive_offline_rmq", [&]() -> ans_type {
+    return throttle::recursive_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  });
 
-  auto iterative_start = std::chrono::high_resolution_clock::now();
-  auto &&ans_iter =
-      throttle::iterative_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
-  auto iterative_finish = std::chrono::high_resolution_clock::now();
-  auto iterative_elapsed = std::chrono::duration<double, std::milli>(iterative_finish - iterative_start);
+  auto ans_iter = measure("throttle::iterative_offline_rmq", [&]() -> ans_type {
+    return throttle::iterative_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  });
+
+  auto ans_compact = measure("throttle::compact_offline_rmq", [&]() -> ans_type {
+    return throttle::compact_offline_rmq<int, std::less<int>>(vec.begin(), vec.end(), q_vec.begin(), q_vec.end());
+  });
+
+  auto ans_sparse = measure("throttle::sparse_table_rmq",
+                            [&]() -> ans_type { return online_rmq<throttle::sparse_table_rmq<int>>(vec, q_vec); });
+
+  auto ans_block =
+      measure("throttle::block_rmq", [&]() -> ans_type { return online_rmq<throttle::block_rmq<int>>(vec, q_vec); });
 
 #if COMPARE_OUTPUTS
   std::cout << "Outputs of throttle::recursive_offline_rmq and throttle::iterative_offline_rmq "
             << (ans_rec == ans_iter ? "match\n" : "differ\n");
+  std::cout << "Outputs of throttle::compact_offline_rmq " << (ans_compact == ans_iter ? "match\n" : "differ\n");
+  std::cout << "Outputs of throttle::sparse_table_rmq and throttle::block_rmq "
+            << (ans_sparse == ans_iter && ans_block == ans_iter ? "match\n" : "differ\n");
 #endif
-
-  std::cout << "throttle::recursive_offline_rmq took " << recursive_elapsed.count() << "ms to run\n";
-  std::cout << "throttle::iterative_offline_rmq " << iterative_elapsed.count() << "ms to run\n";
-}
\ No newline at end of file
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#ifdef BOOST_FOUND__
+#include <boost/program_options.hpp>
+#include <boost/program_options/option.hpp>
+namespace po = boost::program_options;
+#endif
+
+#include "tree_lca.hpp"
+
+// Random tree generator. The parent of the vertex i is chosen uniformly among the p_width previous vertices, or among
+// all previous vertices if p_width is 0. Width of 1 produces a single path, which is the deepest possible tree.
+std::vector<unsigned> random_parents(unsigned p_size, unsigned p_width, std::mt19937 &p_gen) {
+  std::vector<unsigned> parents(p_size);
+  parents[0] = throttle::rooted_forest::npos;
+  for (unsigned i = 1; i < p_size; ++i) {
+    unsigned width = (p_width && p_width < i ? p_width : i);
+    parents[i] = i - 1 - p_gen() % width;
+  }
+  return parents;
+}
+
+template <typename F> auto measure(const char *p_name, F p_func) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto res = p_func();
+  auto finish = std::chrono::high_resolution_clock::now();
+  auto elapsed = std::chrono::duration<double, std::milli>(finish - start);
+  std::cout << p_name << " took " << elapsed.count() << "ms to run\n";
+  return res;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned size = 10000000, queries = 10000000, width = 0;
+
+#ifdef BOOST_FOUND__
+  po::options_description desc("Available options");
+  desc.add_options()("help,h", "Print this help message")(
+      "size,n", po::value<unsigned>(&size)->default_value(size), "Number of vertices")(
+      "queries,q", po::value<unsigned>(&queries)->default_value(queries), "Number of queries")(
+      "width,w", po::value<unsigned>(&width)->default_value(width),
+      "Parent is chosen among this number of previous vertices, 0 means all of them");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 1;
+  }
+#endif
+
+  if (!size) {
+    std::cout << "Tree has to contain at least one vertex\n";
+    return 1;
+  }
+
+  std::mt19937 gen{42};
+  auto parents = random_parents(size, width, gen);
+
+  std::vector<std::pair<unsigned, unsigned>> q_vec{};
+  q_vec.reserve(queries);
+  for (unsigned i = 0; i < queries; ++i) {
+    q_vec.push_back({static_cast<unsigned>(gen() % size), static_cast<unsigned>(gen() % size)});
+  }
+
+  auto forest = measure("throttle::rooted_forest::from_parents",
+                        [&]() { return throttle::rooted_forest::from_parents(parents.begin(), parents.end()); });
+
+  auto ans_offline =
+      measure("throttle::offline_lca", [&]() { return throttle::offline_lca(forest, q_vec.begin(), q_vec.end()); });
+
+  auto online = measure("throttle::euler_tour_lca construction", [&]() { return throttle::euler_tour_lca{forest}; });
+  auto ans_online = measure("throttle::euler_tour_lca queries", [&]() {
+    std::vector<unsigned> ans{};
+    ans.reserve(q_vec.size());
+    for (const auto &q : q_vec) {
+      ans.push_back(online.query(q.first, q.second));
+    }
+    return ans;
+  });
+
+  std::cout << "Outputs of throttle::offline_lca and throttle::euler_tour_lca "
+            << (ans_offline == ans_online ? "match\n" : "differ\n");
+}
@@ -0,0 +1,148 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* kd_tree rebuilds itself from every stored point on the first query after an insertion, so interleaved inserts and
+ * queries cost O(n log n) each. dynamic_kd_tree keeps a forest of static kd_trees instead (Bentley-Saxe logarithmic
+ * method):
+ * 1. Level i is either empty or holds at most 2^i points. An inserted point is carried like a bit in a binary counter:
+ *    it's merged with the points of all occupied levels below the first empty one, and that level is built from them.
+ *    Every point takes part in O(log n) rebuilds, so an insertion costs O(log^2 n) amortized.
+ * 2. Erased points stay in their trees as tombstones and are skipped by queries. They are dropped when their level is
+ *    merged, and the whole forest is compacted into a single tree when tombstones outnumber live points.
+ * 3. A query searches every level and passes the closest point found so far to the next one, so that subtrees that
+ *    can't improve it are pruned across the whole forest.
+ *
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "kd_tree.hpp"
+
+namespace throttle {
+
+template <typename t_point>
+requires can_fit_in_kd_tree<t_point>
+class dynamic_kd_tree {
+public:
+  using size_type = std::size_t;
+  using value_type = typename t_point::value_type;
+  using point_type = t_point;
+
+  static constexpr size_type dimension = t_point::dimension;
+
+private:
+  // Stored points remember the handle returned by insert to check whether they have been erased.
+  struct entry : public point_type {
+    size_type m_id;
+  };
+
+  std::vector<kd_tree<entry>> m_levels;
+  std::vector<bool>           m_alive; // Indexed by handles, which are never reused.
+  size_type                   m_size = 0, m_tombstones = 0;
+
+  bool alive(const entry &point) const { return m_alive[point.m_id]; }
+
+  // Moves live points of a level to the back of carry and forgets its tombstones.
+  void drain_level(kd_tree<entry> &level, std::vector<entry> &carry) {
+    for (auto &point : level.extract()) {
+      if (alive(point)) {
+        carry.push_back(std::move(point));
+      } else {
+        --m_tombstones;
+      }
+    }
+  }
+
+  void build_level(size_type index, std::vector<entry> &carry) {
+    if (index >= m_levels.size()) m_levels.resize(index + 1);
+    m_levels[index].insert(carry.begin(), carry.end());
+    m_levels[index].reconstruct();
+  }
+
+  // All live points are moved to the lowest level that can hold them.
+  void compact() {
+    std::vector<entry> carry;
+    carry.reserve(m_size);
+    for (auto &level : m_levels) {
+      drain_level(level, carry);
+    }
+
+    m_levels.clear();
+    if (carry.empty()) return;
+    build_level(carry.size() == 1 ? 0 : std::bit_width(carry.size() - 1), carry);
+  }
+
+public:
+  dynamic_kd_tree() = default;
+
+  // Returns a handle that identifies the point for erase.
+  size_type insert(const point_type &point) {
+    const size_type id = m_alive.size();
+    m_alive.push_back(true);
+
+    std::vector<entry> carry{entry{point, id}};
+    size_type          index = 0;
+    for (; index < m_levels.size() && !m_levels[index].empty(); ++index) {
+      drain_level(m_levels[index], carry);
+    }
+
+    build_level(index, carry);
+    ++m_size;
+    return id;
+  }
+
+  // Returns false if there is no point with this handle.
+  bool erase(size_type id) {
+    if (!contains(id)) return false;
+
+    m_alive[id] = false;
+    --m_size;
+    ++m_tombstones;
+    if (m_tombstones > m_size) compact();
+    return true;
+  }
+
+  bool contains(size_type id) const { return (id < m_alive.size() && m_alive[id]); }
+
+  size_type size() const { return m_size; }
+  bool      empty() const { return (size() == 0); }
+
+  // Number of non-empty static trees in the forest.
+  size_type trees() const {
+    size_type count = 0;
+    for (const auto &level : m_levels) {
+      count += !level.empty();
+    }
+    return count;
+  }
+
+  point_type nearest_neighbour(const point_type &point) const {
+    if (empty()) throw std::logic_error{"Calling nearest neighbour on an empty kd-tree"};
+
+    const entry *best = nullptr;
+    value_type   best_dist{};
+    auto         accept = [this](const entry &candidate) { return alive(candidate); };
+
+    // Larger trees go first, they are more likely to contain a close point that bounds the search in the rest.
+    for (auto it = m_levels.rbegin(); it != m_levels.rend(); ++it) {
+      it->nearest_neighbour_if(point, accept, best, best_dist);
+    }
+
+    return *best;
+  }
+};
+
+} // namespace throttle
@@ -10,9 +10,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
 
 #include <range/v3/action.hpp>
@@ -21,11 +32,11 @@
 #include <range/v3/numeric.hpp>
 #include <range/v3/view.hpp>
 
-#include <optional>
 #include <type_traits>
-#include <variant>
 #include <vector>
 
+#include "leaf_kernel.hpp"
+#include "mapped_file.hpp"
 #include "point_n.hpp"
 
 namespace throttle {
@@ -56,9 +67,6 @@ concept can_fit_in_kd_tree = requires {
   requires T::dimension > 0;
 };
 
-template <class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-template <class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
-
 template <typename t_point>
 requires can_fit_in_kd_tree<t_point>
 class kd_tree {
@@ -67,23 +75,83 @@ class kd_tree {
 
   using point_type = t_point;
 
+public:
+  static constexpr size_type dimension = t_point::dimension;
+  static constexpr size_type max_leaf_capacity = 64;
+  // Subtrees with at least this many points are built as separate tasks.
+  static constexpr size_type parallel_build_threshold = 1 << 14;
+
 private:
-  using kd_tree_node = std::variant<std::monostate, point_type, std::vector<point_type>>;
+  static constexpr size_type leaf_axis = dimension;
+
+  // Nodes are stored in implicit heap order. Every node covers a range of the point buffer. An internal node splits its
+  // range in halves, points in the left half are not greater than m_split along m_axis and points in the right half are
+  // not less than it. Leaves have m_axis equal to leaf_axis.
+  struct kd_tree_node {
+    value_type m_split = value_type{};
+    size_type  m_axis = leaf_axis;
+    size_type  m_begin = 0, m_end = 0;
+
+    bool is_leaf() const { return m_axis == leaf_axis; }
+  };
 
   std::vector<point_type>   m_pending_insertion;
+  std::vector<point_type>   m_points; // Points that are in the tree, partitioned in place during construction.
   std::vector<kd_tree_node> m_tree_structure;
-  size_type                 m_stored_count = 0;
+  // Copy of the point buffer where every leaf [m_begin, m_end) is stored dimension-major at offset m_begin * dimension,
+  // so that leaves are scanned with vectorized kernels from leaf_kernel.hpp. This costs dimension * sizeof(value_type)
+  // bytes per point, which doubles the memory for plain point_n and is less for points that carry more than their
+  // coordinates. m_points can't be replaced by it: point_type is arbitrary, queries return whole points, and vector
+  // loads from the interleaved point buffer would need gathers. The snapshot format stores both as well.
+  std::vector<value_type> m_leaf_coords;
+
+  // A tree opened with open_mapped reads nodes, leaf coordinates and points straight from the mapping, and the vectors
+  // above stay empty until the next reconstruction copies the points out of it. Copies of the tree share the mapping.
+  std::shared_ptr<const mapped_file> m_mapping;
+  const kd_tree_node                *m_mapped_nodes = nullptr;
+  const value_type                  *m_mapped_coords = nullptr;
+  const point_type                  *m_mapped_points = nullptr;
+  size_type                          m_mapped_size = 0, m_mapped_node_count = 0;
+
+  // Snapshot file layout: the header followed by the nodes in heap order, the leaf coordinates and the points. Every
+  // block starts at an offset from the beginning of the file aligned to snapshot_alignment.
+  struct snapshot_header {
+    std::uint64_t m_magic;
+    std::uint64_t m_dimension, m_point_size, m_value_size, m_node_size;
+    std::uint64_t m_size, m_node_count;
+    std::uint64_t m_nodes_offset, m_coords_offset, m_points_offset;
+  };
+
+  static constexpr std::uint64_t snapshot_magic = 0x313045455254444b; // "KDTREE01"
+  static constexpr std::uint64_t snapshot_alignment = 64;
+  static_assert(alignof(kd_tree_node) <= snapshot_alignment && alignof(point_type) <= snapshot_alignment);
+
+  using query_type = std::array<value_type, dimension>;
 
 public:
-  static constexpr size_type dimension = t_point::dimension;
-  static constexpr size_type max_leaf_capacity = 64;
-
   kd_tree() = default;
 
   void insert(const point_type &point) { m_pending_insertion.push_back(point); }
-  void insert(point_type &&point) { m_pending_insertion.push_back(point); }
+  void insert(point_type &&point) { m_pending_insertion.push_back(std::move(point)); }
+
+  template <typename t_iter> void insert(t_iter first, t_iter last) {
+    m_pending_insertion.insert(m_pending_insertion.end(), first, last);
+  }
+
+  // Removes every point from the tree and returns them in no particular order.
+  std::vector<point_type> extract() {
+    unmap();
+    std::vector<point_type> result = std::move(m_points);
+    result.insert(result.end(), std::make_move_iterator(m_pending_insertion.begin()),
+                  std::make_move_iterator(m_pending_insertion.end()));
+    m_points.clear();
+    m_pending_insertion.clear();
+    m_tree_structure.clear();
+    m_leaf_coords.clear();
+    return result;
+  }
 
-  size_type size() const { return m_pending_insertion.size() + m_stored_count; }
+  size_type size() const { return m_pending_insertion.size() + stored_size(); }
   bool      empty() const { return (size() == 0); }
 
 private:
@@ -92,104 +160,491 @@ private:
   static size_type right_child(size_type index) { return 2 * index + 1; }
   static size_type parent(size_type index) { return index / 2; }
 
-  kd_tree_node &get_or_create_node(size_type index) {
-    if (index >= m_tree_structure.size()) m_tree_structure.resize(index);
-    return m_tree_structure.at(index - 1);
+  kd_tree_node       &get_node(size_type index) { return m_tree_structure[index - 1]; }
+  const kd_tree_node &get_node(size_type index) const {
+    return (m_mapping ? m_mapped_nodes : m_tree_structure.data())[index - 1];
+  }
+
+  const value_type *leaf_coords(const kd_tree_node &node) const {
+    return (m_mapping ? m_mapped_coords : m_leaf_coords.data()) + node.m_begin * dimension;
+  }
+
+  size_type         stored_size() const { return (m_mapping ? m_mapped_size : m_points.size()); }
+  size_type         node_count() const { return (m_mapping ? m_mapped_node_count : m_tree_structure.size()); }
+  const point_type &stored_point(size_type index) const {
+    return (m_mapping ? m_mapped_points[index] : m_points[index]);
+  }
+
+  // Points of a mapped tree are copied to the point buffer. The tree structure has to be rebuilt afterwards.
+  void unmap() {
+    if (!m_mapping) return;
+    m_points.assign(m_mapped_points, m_mapped_points + m_mapped_size);
+    m_mapping.reset();
+    m_mapped_nodes = nullptr;
+    m_mapped_coords = nullptr;
+    m_mapped_points = nullptr;
+    m_mapped_size = m_mapped_node_count = 0;
+  }
+
+  static query_type to_query(const auto &point) {
+    query_type query;
+    for (size_type axis = 0; axis < dimension; ++axis) {
+      query[axis] = point[axis];
+    }
+    return query;
+  }
+
+  void fill_leaf_coords(const kd_tree_node &node) {
+    const auto count = node.m_end - node.m_begin;
+    auto      *coords = m_leaf_coords.data() + node.m_begin * dimension;
+    for (size_type axis = 0; axis < dimension; ++axis) {
+      for (size_type i = 0; i < count; ++i) {
+        coords[axis * count + i] = m_points[node.m_begin + i][axis];
+      }
+    }
+  }
+
+  // Halves are never larger than the ceiling of the half, so leaves are at most this deep.
+  static size_type max_depth(size_type count) {
+    size_type depth = 0;
+    for (; count > max_leaf_capacity; count = (count + 1) / 2) {
+      ++depth;
+    }
+    return depth;
   }
 
-  const kd_tree_node &get_node(size_type index) const { return m_tree_structure.at(index - 1); }
+  size_type widest_axis(size_type begin, size_type end) const {
+    std::array<value_type, dimension> min, max;
+    for (size_type axis = 0; axis < dimension; ++axis) {
+      min[axis] = max[axis] = m_points[begin][axis];
+    }
+
+    for (size_type i = begin + 1; i < end; ++i) {
+      for (size_type axis = 0; axis < dimension; ++axis) {
+        min[axis] = std::min(min[axis], m_points[i][axis]);
+        max[axis] = std::max(max[axis], m_points[i][axis]);
+      }
+    }
 
-  void construct(auto &&node_range, size_type depth = 0, size_type curr_index = 1) {
-    auto size = ranges::size(node_range);
+    size_type widest = 0;
+    for (size_type axis = 1; axis < dimension; ++axis) {
+      if (max[axis] - min[axis] > max[widest] - min[widest]) widest = axis;
+    }
+    return widest;
+  }
 
-    if (size <= max_leaf_capacity) {
-      get_or_create_node(curr_index) = ranges::to_vector(node_range);
+  void construct(size_type begin, size_type end, size_type curr_index, size_type spawn_depth) {
+    auto &node = get_node(curr_index);
+    node.m_begin = begin;
+    node.m_end = end;
+    if (end - begin <= max_leaf_capacity) {
+      fill_leaf_coords(node);
       return;
     }
 
-    size_type axis = depth % dimension;
-    auto      median_index = size / 2;
+    const auto axis = widest_axis(begin, end);
+    const auto median = begin + (end - begin) / 2;
+    std::nth_element(m_points.begin() + begin, m_points.begin() + median, m_points.begin() + end,
+                     [axis](const point_type &lhs, const point_type &rhs) { return lhs[axis] < rhs[axis]; });
+
+    node.m_axis = axis;
+    node.m_split = m_points[median][axis];
 
-    auto sorted_range = node_range;
-    sorted_range |= ranges::actions::sort([axis](auto &&i, auto &&j) { return i[axis] < j[axis]; });
-    auto left_range = sorted_range | ranges::views::slice(size_type{0}, median_index);
-    auto right_range = sorted_range | ranges::views::slice(median_index + 1, ranges::end);
+    if (spawn_depth && end - begin >= parallel_build_threshold) {
+      auto left = std::async(std::launch::async,
+                             [&]() { construct(begin, median, left_child(curr_index), spawn_depth - 1); });
+      construct(median, end, right_child(curr_index), spawn_depth - 1);
+      left.get();
+      return;
+    }
 
-    get_or_create_node(curr_index) = sorted_range[median_index];
-    construct(left_range, depth + 1, left_child(curr_index));
-    construct(right_range, depth + 1, right_child(curr_index));
+    construct(begin, median, left_child(curr_index), 0);
+    construct(median, end, right_child(curr_index), 0);
   }
 
-private:
-  std::pair<point_type, value_type> nearest_neighbour_impl(const point_type          current_best,
-                                                           std::optional<value_type> current_dist,
-                                                           const point_type &query_point, size_type depth = 0,
-                                                           size_type curr_index = 1) const {
+  struct accept_all {
+    bool operator()(const point_type &) const { return true; }
+  };
+
+  // best is nullptr until some point has been found. Only points for which accept returns true are considered.
+  template <typename t_accept>
+  void nearest_neighbour_impl(const query_type &query_point, const point_type *&best, value_type &best_dist,
+                              t_accept &accept, size_type curr_index = 1) const {
     const auto &current_node = get_node(curr_index);
 
-    if (std::holds_alternative<std::vector<point_type>>(current_node)) {
-      auto [best_distance, best_point] = compute_closest(std::get<std::vector<point_type>>(current_node), query_point);
+    if (current_node.is_leaf()) {
+      const auto count = current_node.m_end - current_node.m_begin;
+      const auto coords = leaf_coords(current_node);
+
+      if constexpr (std::is_same_v<t_accept, accept_all>) {
+        auto [dist, offset] = detail::leaf_closest<value_type, dimension>(coords, count, query_point.data());
+        if (!best || dist < best_dist) {
+          best_dist = dist;
+          best = &stored_point(current_node.m_begin + offset);
+        }
+      } else {
+        std::array<value_type, max_leaf_capacity> dists;
+        detail::leaf_distances_sq<value_type, dimension>(coords, count, query_point.data(), dists.data());
+        for (size_type offset = 0; offset < count; ++offset) {
+          const auto &point = stored_point(current_node.m_begin + offset);
+          if ((!best || dists[offset] < best_dist) && accept(point)) {
+            best_dist = dists[offset];
+            best = &point;
+          }
+        }
+      }
+      return;
+    }
+
+    const auto axis = current_node.m_axis;
+    const auto diff = query_point[axis] - current_node.m_split;
+    const auto first_node = (diff < value_type{} ? left_child(curr_index) : right_child(curr_index));
+    const auto second_node = (diff < value_type{} ? right_child(curr_index) : left_child(curr_index));
 
-      if (!current_dist || best_distance < current_dist.value()) return std::make_pair(best_point, best_distance);
-      return std::make_pair(current_best, current_dist.value());
+    nearest_neighbour_impl(query_point, best, best_dist, accept, first_node);
+    if (!best || diff * diff <= best_dist) nearest_neighbour_impl(query_point, best, best_dist, accept, second_node);
+  }
+
+  using distance_index_pair = std::pair<value_type, size_type>;
+
+  // Max-heap of at most k closest points found so far, the farthest of them is on top.
+  void k_nearest_impl(const query_type &query_point, size_type k, std::vector<distance_index_pair> &heap,
+                      size_type curr_index = 1) const {
+    const auto &current_node = get_node(curr_index);
+
+    if (current_node.is_leaf()) {
+      const auto                                count = current_node.m_end - current_node.m_begin;
+      std::array<value_type, max_leaf_capacity> dists;
+      detail::leaf_distances_sq<value_type, dimension>(leaf_coords(current_node), count, query_point.data(),
+                                                       dists.data());
+
+      for (size_type offset = 0; offset < count; ++offset) {
+        const auto dist = dists[offset];
+        const auto i = current_node.m_begin + offset;
+        if (heap.size() < k) {
+          heap.push_back({dist, i});
+          std::push_heap(heap.begin(), heap.end());
+        } else if (dist < heap.front().first) {
+          std::pop_heap(heap.begin(), heap.end());
+          heap.back() = {dist, i};
+          std::push_heap(heap.begin(), heap.end());
+        }
+      }
+      return;
     }
 
-    size_type axis = depth % dimension;
+    const auto diff = query_point[current_node.m_axis] - current_node.m_split;
+    const auto first_node = (diff < value_type{} ? left_child(curr_index) : right_child(curr_index));
+    const auto second_node = (diff < value_type{} ? right_child(curr_index) : left_child(curr_index));
 
-    auto split_node = std::get<point_type>(current_node);
-    auto split_val = split_node[axis];
-    auto dist_sq = (split_val - query_point[axis]) * (split_val - query_point[axis]);
+    k_nearest_impl(query_point, k, heap, first_node);
+    if (heap.size() < k || diff * diff <= heap.front().first) k_nearest_impl(query_point, k, heap, second_node);
+  }
 
-    auto first_node = (query_point[axis] < split_val ? left_child(curr_index) : right_child(curr_index));
-    auto second_node = (query_point[axis] < split_val ? right_child(curr_index) : left_child(curr_index));
+  void within_radius_impl(const query_type &query_point, value_type radius_sq, std::vector<point_type> &result,
+                          size_type curr_index = 1) const {
+    const auto &current_node = get_node(curr_index);
 
-    auto [subtree_best_point, subtree_best_dist] =
-        nearest_neighbour_impl(current_best, current_dist, query_point, depth + 1, first_node);
+    if (current_node.is_leaf()) {
+      const auto                                count = current_node.m_end - current_node.m_begin;
+      std::array<value_type, max_leaf_capacity> dists;
+      detail::leaf_distances_sq<value_type, dimension>(leaf_coords(current_node), count, query_point.data(),
+                                                       dists.data());
 
-    if (subtree_best_dist >= dist_sq) {
-      if (subtree_best_dist > distance_sq(split_node, query_point)) {
-        subtree_best_dist = distance_sq(split_node, query_point);
-        subtree_best_point = split_node;
+      for (size_type offset = 0; offset < count; ++offset) {
+        if (dists[offset] <= radius_sq) result.push_back(stored_point(current_node.m_begin + offset));
       }
-      return nearest_neighbour_impl(subtree_best_point, subtree_best_dist, query_point, depth + 1, second_node);
+      return;
     }
 
-    return std::make_pair(subtree_best_point, subtree_best_dist);
+    const auto diff = query_point[current_node.m_axis] - current_node.m_split;
+    if (diff <= value_type{} || diff * diff <= radius_sq) {
+      within_radius_impl(query_point, radius_sq, result, left_child(curr_index));
+    }
+    if (diff >= value_type{} || diff * diff <= radius_sq) {
+      within_radius_impl(query_point, radius_sq, result, right_child(curr_index));
+    }
+  }
+
+  // Best-bin-first search. Subtrees are visited in the order of the lower bound of distance to them, which is the
+  // largest squared distance to a splitting plane on the way from the root. The search stops when the closest
+  // unvisited subtree can't improve the answer by more than (1 + eps) times or after max_leaves leaves.
+  size_type approximate_nearest_impl(const query_type &query_point, value_type eps, size_type max_leaves) const {
+    std::vector<distance_index_pair> queue{{value_type{}, 1}};
+    auto                             further = [](const auto &lhs, const auto &rhs) { return lhs.first > rhs.first; };
+
+    const auto scale = (1 + eps) * (1 + eps);
+    size_type  best_index = stored_size(), leaves = 0;
+    value_type best_dist{};
+
+    while (!queue.empty() && leaves < max_leaves) {
+      std::pop_heap(queue.begin(), queue.end(), further);
+      auto [bound, curr_index] = queue.back();
+      queue.pop_back();
+      if (best_index != stored_size() && bound * scale >= best_dist) break;
+
+      // Descend to the closest leaf, the other child of every node on the way goes to the queue.
+      const kd_tree_node *node = &get_node(curr_index);
+      while (!node->is_leaf()) {
+        const auto diff = query_point[node->m_axis] - node->m_split;
+        const auto near = (diff < value_type{} ? left_child(curr_index) : right_child(curr_index));
+        const auto far = (diff < value_type{} ? right_child(curr_index) : left_child(curr_index));
+
+        queue.push_back({std::max(bound, diff * diff), far});
+        std::push_heap(queue.begin(), queue.end(), further);
+        curr_index = near;
+        node = &get_node(curr_index);
+      }
+
+      ++leaves;
+      const auto count = node->m_end - node->m_begin;
+      auto [dist, offset] = detail::leaf_closest<value_type, dimension>(leaf_coords(*node), count, query_point.data());
+      if (best_index == stored_size() || dist < best_dist) {
+        best_dist = dist;
+        best_index = node->m_begin + offset;
+      }
+    }
+
+    return best_index;
+  }
+
+  // Answer queries from [first, last) in parallel. Each thread writes only its own part of the result.
+  template <typename t_result, typename t_iter, typename F>
+  std::vector<t_result> batch(t_iter first, t_iter last, F query) {
+    reconstruct();
+
+    std::vector<point_type> queries{first, last};
+    std::vector<t_result>   result(queries.size());
+
+    const size_type count = queries.size();
+    const size_type threads = std::clamp<size_type>(count / 64, 1, std::max(1u, std::thread::hardware_concurrency()));
+
+    auto worker = [&](size_type p_index) {
+      for (size_type i = count * p_index / threads, end = count * (p_index + 1) / threads; i < end; ++i) {
+        result[i] = query(queries[i]);
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_type i = 1; i < threads; ++i) {
+      pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto &t : pool) {
+      t.join();
+    }
+
+    return result;
+  }
+
+  point_type nearest_neighbour_const(const point_type &point) const {
+    const point_type *best = nullptr;
+    value_type        best_dist{};
+    accept_all        accept;
+    nearest_neighbour_impl(to_query(point), best, best_dist, accept);
+    return *best;
+  }
+
+  std::vector<point_type> k_nearest_const(const point_type &point, size_type k) const {
+    std::vector<distance_index_pair> heap;
+    heap.reserve(k);
+    if (k) k_nearest_impl(to_query(point), k, heap);
+
+    std::sort_heap(heap.begin(), heap.end());
+    std::vector<point_type> result;
+    result.reserve(heap.size());
+    for (const auto &v : heap) {
+      result.push_back(stored_point(v.second));
+    }
+    return result;
+  }
+
+  std::vector<point_type> within_radius_const(const point_type &point, value_type radius) const {
+    std::vector<point_type> result;
+    if (radius >= value_type{}) within_radius_impl(to_query(point), radius * radius, result);
+    return result;
   }
 
 public:
   point_type nearest_neighbour(const point_type &point) {
     if (empty()) throw std::logic_error{"Calling nearest neighbour on an empty kd-tree"};
     reconstruct();
-    return nearest_neighbour_impl(point_type{}, std::nullopt, point).first;
+    return nearest_neighbour_const(point);
   }
 
-  void copy_all_to_pending() {
-    // clang-format off
-    for (const auto &v : m_tree_structure) {
-      std::visit(overloaded {
-        [&](const std::vector<point_type> &vec) -> void { ranges::copy(vec, ranges::back_inserter(m_pending_insertion)); },
-        [](auto) -> void {}
-      }, v);
-    }
-    // clang-format on
-    m_tree_structure.clear();
+  // Closest k points ordered by distance. If there are less than k points in the tree, all of them are returned.
+  std::vector<point_type> k_nearest(const point_type &point, size_type k) {
+    reconstruct();
+    return (empty() ? std::vector<point_type>{} : k_nearest_const(point, k));
   }
 
+  // All points at a distance not greater than radius, in no particular order.
+  std::vector<point_type> within_radius(const point_type &point, value_type radius) {
+    reconstruct();
+    return (empty() ? std::vector<point_type>{} : within_radius_const(point, radius));
+  }
+
+  // A point that is at most (1 + eps) times farther than the nearest one, unless the search is cut short after visiting
+  // max_leaves leaves. Then it's the best point found so far.
+  point_type approximate_nearest(const point_type &point, value_type eps,
+                                 size_type max_leaves = std::numeric_limits<size_type>::max()) {
+    if (empty()) throw std::logic_error{"Calling approximate nearest on an empty kd-tree"};
+    if (!max_leaves) throw std::invalid_argument{"At least one leaf has to be visited"};
+    reconstruct();
+    return stored_point(approximate_nearest_impl(to_query(point), eps, max_leaves));
+  }
+
+  // Nearest point for which accept returns true, if it's closer than best. On return best points to it and best_dist is
+  // the squared distance. best has to be nullptr if nothing has been found yet. This lets a search continue from the
+  // result in another tree, see dynamic_kd_tree.hpp. Pending points are ignored, so the tree should be reconstructed.
+  template <typename t_accept>
+  void nearest_neighbour_if(const auto &point, t_accept accept, const point_type *&best, value_type &best_dist) const {
+    if (!stored_size()) return;
+    nearest_neighbour_impl(to_query(point), best, best_dist, accept);
+  }
+
+  // Batched versions answer every query from [first, last) and distribute them between threads.
+  template <typename t_iter> std::vector<point_type> nearest_neighbour(t_iter first, t_iter last) {
+    if (empty()) throw std::logic_error{"Calling nearest neighbour on an empty kd-tree"};
+    return batch<point_type>(first, last, [this](const point_type &q) { return nearest_neighbour_const(q); });
+  }
+
+  template <typename t_iter> std::vector<std::vector<point_type>> k_nearest(t_iter first, t_iter last, size_type k) {
+    return batch<std::vector<point_type>>(first, last, [this, k](const point_type &q) {
+      return (empty() ? std::vector<point_type>{} : k_nearest_const(q, k));
+    });
+  }
+
+  template <typename t_iter>
+  std::vector<std::vector<point_type>> within_radius(t_iter first, t_iter last, value_type radius) {
+    return batch<std::vector<point_type>>(first, last, [this, radius](const point_type &q) {
+      return (empty() ? std::vector<point_type>{} : within_radius_const(q, radius));
+    });
+  }
+
+  template <typename t_iter>
+  std::vector<point_type> approximate_nearest(t_iter first, t_iter last, value_type eps,
+                                              size_type max_leaves = std::numeric_limits<size_type>::max()) {
+    if (empty()) throw std::logic_error{"Calling approximate nearest on an empty kd-tree"};
+    if (!max_leaves) throw std::invalid_argument{"At least one leaf has to be visited"};
+    return batch<point_type>(first, last, [this, eps, max_leaves](const point_type &q) {
+      return stored_point(approximate_nearest_impl(to_query(q), eps, max_leaves));
+    });
+  }
+
+  // Pending points are appended to the point buffer and the whole buffer is partitioned again in place.
   void reconstruct() {
     if (m_pending_insertion.empty()) return;
+    unmap();
+
+    m_points.insert(m_points.end(), std::make_move_iterator(m_pending_insertion.begin()),
+                    std::make_move_iterator(m_pending_insertion.end()));
+    m_pending_insertion.clear();
 
-    copy_all_to_pending();
     try {
-      m_tree_structure.reserve(m_pending_insertion.size() / max_leaf_capacity);
-      construct(m_pending_insertion);
+      m_tree_structure.assign(size_type{2} << max_depth(m_points.size()), kd_tree_node{});
+      m_leaf_coords.resize(m_points.size() * dimension);
+      construct(0, m_points.size(), 1, std::bit_width(std::thread::hardware_concurrency()));
     } catch (...) {
+      // Everything goes back to pending, so that the next query tries to build the tree from scratch.
+      m_pending_insertion = std::move(m_points);
+      m_points.clear();
       m_tree_structure.clear();
+      m_leaf_coords.clear();
       throw;
     }
+  }
+
+  // Writes the built tree in a flat layout that open_mapped queries in place. All positions are indices, so the file
+  // doesn't depend on the address it's mapped at, but it can only be opened with the same point type on a machine with
+  // the same byte order.
+  void save(const std::string &path)
+  requires std::is_trivially_copyable_v<point_type>
+  {
+    reconstruct();
+
+    auto align = [](std::uint64_t offset) {
+      return (offset + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+    };
+
+    snapshot_header header{snapshot_magic, dimension, sizeof(point_type), sizeof(value_type), sizeof(kd_tree_node),
+                           stored_size(), node_count(), 0, 0, 0};
+    header.m_nodes_offset = align(sizeof(snapshot_header));
+    header.m_coords_offset = align(header.m_nodes_offset + header.m_node_count * sizeof(kd_tree_node));
+    header.m_points_offset = align(header.m_coords_offset + header.m_size * dimension * sizeof(value_type));
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if (!file) throw std::runtime_error{"Can't open " + path + " for writing"};
+
+    auto write_block = [&file](std::uint64_t offset, const void *data, std::uint64_t size) {
+      for (auto pos = static_cast<std::uint64_t>(file.tellp()); pos < offset; ++pos) {
+        file.put(0);
+      }
+      file.write(static_cast<const char *>(data), size);
+    };
+
+    const value_type *coords = (m_mapping ? m_mapped_coords : m_leaf_coords.data());
+    const point_type *points = (m_mapping ? m_mapped_points : m_points.data());
+    write_block(0, &header, sizeof(header));
+    const kd_tree_node *nodes = (node_count() ? &get_node(1) : nullptr);
+    write_block(header.m_nodes_offset, nodes, header.m_node_count * sizeof(kd_tree_node));
+    write_block(header.m_coords_offset, coords, header.m_size * dimension * sizeof(value_type));
+    write_block(header.m_points_offset, points, header.m_size * sizeof(point_type));
+
+    if (!file.flush()) throw std::runtime_error{"Can't write " + path};
+  }
+
+  // Maps a file written by save. Nothing is deserialized, queries read the mapping directly, so opening is instant and
+  // processes that open the same file share its pages. Inserting into the tree copies the points out of the mapping.
+  static kd_tree open_mapped(const std::string &path)
+  requires std::is_trivially_copyable_v<point_type>
+  {
+    auto mapping = std::make_shared<const mapped_file>(path);
+
+    snapshot_header header;
+    if (mapping->size() < sizeof(header)) throw std::runtime_error{path + " is not a kd-tree snapshot"};
+    std::memcpy(&header, mapping->data(), sizeof(header));
+
+    if (header.m_magic != snapshot_magic) throw std::runtime_error{path + " is not a kd-tree snapshot"};
+    if (header.m_dimension != dimension || header.m_point_size != sizeof(point_type) ||
+        header.m_value_size != sizeof(value_type) || header.m_node_size != sizeof(kd_tree_node)) {
+      throw std::runtime_error{path + " was saved for a different point type"};
+    }
 
-    m_stored_count = m_pending_insertion.size();
-    m_pending_insertion.clear();
+    // Blocks have to be aligned and inside the mapping. Counts are divided rather than multiplied, so that a corrupt
+    // header can't overflow the check.
+    const auto file_size = static_cast<std::uint64_t>(mapping->size());
+    auto check_block = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+      if (offset < sizeof(snapshot_header) || offset % snapshot_alignment) {
+        throw std::runtime_error{path + " is corrupt"};
+      }
+      if (offset > file_size || count > (file_size - offset) / element_size) {
+        throw std::runtime_error{path + " is truncated"};
+      }
+    };
+    check_block(header.m_nodes_offset, header.m_node_count, sizeof(kd_tree_node));
+    check_block(header.m_coords_offset, header.m_size, dimension * sizeof(value_type));
+    check_block(header.m_points_offset, header.m_size, sizeof(point_type));
+
+    // Queries follow nodes without further checks, so every child and leaf range has to exist.
+    const auto *nodes = reinterpret_cast<const kd_tree_node *>(mapping->data() + header.m_nodes_offset);
+    if (header.m_size && !header.m_node_count) throw std::runtime_error{path + " is corrupt"};
+    for (size_type index = 1; index <= header.m_node_count; ++index) {
+      const auto &node = nodes[index - 1];
+      const bool  in_range = (node.m_begin <= node.m_end && node.m_end <= header.m_size);
+      const bool  links = (node.is_leaf() ? node.m_end - node.m_begin <= max_leaf_capacity
+                                          : node.m_axis < dimension && right_child(index) <= header.m_node_count);
+      if (!in_range || !links) throw std::runtime_error{path + " is corrupt"};
+    }
+
+    kd_tree tree;
+    tree.m_mapped_nodes = nodes;
+    tree.m_mapped_coords = reinterpret_cast<const value_type *>(mapping->data() + header.m_coords_offset);
+    tree.m_mapped_points = reinterpret_cast<const point_type *>(mapping->data() + header.m_points_offset);
+    tree.m_mapped_size = header.m_size;
+    tree.m_mapped_node_count = header.m_node_count;
+    tree.m_mapping = std::move(mapping);
+    return tree;
   }
 };
 
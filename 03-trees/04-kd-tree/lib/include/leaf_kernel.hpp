@@ -0,0 +1,240 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Distance kernels for scanning kd-tree leaves. Leaf points are stored dimension-major (structure of arrays): coordinate
+ * along axis a of point i is coords[a * count + i]. This way a single vector load brings the same coordinate of several
+ * consecutive points, and squared distances to 16 (AVX-512) or 8 (AVX2) floats are computed at once. float and double
+ * use AVX-512 or AVX2 if the compiler targets them (e.g. with -march=native), every other type and the tail of a leaf
+ * are handled by a scalar loop.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace throttle {
+namespace detail {
+
+template <typename T> struct simd_traits {
+  static constexpr bool        enabled = false;
+  static constexpr std::size_t width = 1;
+};
+
+#if defined(__AVX512F__)
+template <> struct simd_traits<float> {
+  using reg = __m512;
+  using index_reg = __m512i;
+  using mask = __mmask16;
+  using index_type = std::int32_t;
+
+  static constexpr bool        enabled = true;
+  static constexpr std::size_t width = 16;
+
+  static reg  load(const float *ptr) { return _mm512_loadu_ps(ptr); }
+  static void store(float *ptr, reg a) { _mm512_storeu_ps(ptr, a); }
+  static reg  set1(float a) { return _mm512_set1_ps(a); }
+  static reg  sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+  static reg  mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+  static reg  add(reg a, reg b) { return _mm512_add_ps(a, b); }
+  static mask less(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static reg  select(mask m, reg a, reg b) { return _mm512_mask_blend_ps(m, a, b); }
+
+  static index_reg iota() { return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); }
+  static index_reg add_index(index_reg a, index_type b) { return _mm512_add_epi32(a, _mm512_set1_epi32(b)); }
+  static index_reg select(mask m, index_reg a, index_reg b) { return _mm512_mask_blend_epi32(m, a, b); }
+  static void      store_index(index_type *ptr, index_reg a) { _mm512_storeu_si512(ptr, a); }
+};
+
+template <> struct simd_traits<double> {
+  using reg = __m512d;
+  using index_reg = __m512i;
+  using mask = __mmask8;
+  using index_type = std::int64_t;
+
+  static constexpr bool        enabled = true;
+  static constexpr std::size_t width = 8;
+
+  static reg  load(const double *ptr) { return _mm512_loadu_pd(ptr); }
+  static void store(double *ptr, reg a) { _mm512_storeu_pd(ptr, a); }
+  static reg  set1(double a) { return _mm512_set1_pd(a); }
+  static reg  sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+  static reg  mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+  static reg  add(reg a, reg b) { return _mm512_add_pd(a, b); }
+  static mask less(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+  static reg  select(mask m, reg a, reg b) { return _mm512_mask_blend_pd(m, a, b); }
+
+  static index_reg iota() { return _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7); }
+  static index_reg add_index(index_reg a, index_type b) { return _mm512_add_epi64(a, _mm512_set1_epi64(b)); }
+  static index_reg select(mask m, index_reg a, index_reg b) { return _mm512_mask_blend_epi64(m, a, b); }
+  static void      store_index(index_type *ptr, index_reg a) { _mm512_storeu_si512(ptr, a); }
+};
+
+#elif defined(__AVX2__)
+template <> struct simd_traits<float> {
+  using reg = __m256;
+  using index_reg = __m256i;
+  using mask = __m256;
+  using index_type = std::int32_t;
+
+  static constexpr bool        enabled = true;
+  static constexpr std::size_t width = 8;
+
+  static reg  load(const float *ptr) { return _mm256_loadu_ps(ptr); }
+  static void store(float *ptr, reg a) { _mm256_storeu_ps(ptr, a); }
+  static reg  set1(float a) { return _mm256_set1_ps(a); }
+  static reg  sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static reg  mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  static reg  add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static mask less(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static reg  select(mask m, reg a, reg b) { return _mm256_blendv_ps(a, b, m); }
+
+  static index_reg iota() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+  static index_reg add_index(index_reg a, index_type b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+  static index_reg select(mask m, index_reg a, index_reg b) {
+    return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), m));
+  }
+  static void store_index(index_type *ptr, index_reg a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), a); }
+};
+
+template <> struct simd_traits<double> {
+  using reg = __m256d;
+  using index_reg = __m256i;
+  using mask = __m256d;
+  using index_type = std::int64_t;
+
+  static constexpr bool        enabled = true;
+  static constexpr std::size_t width = 4;
+
+  static reg  load(const double *ptr) { return _mm256_loadu_pd(ptr); }
+  static void store(double *ptr, reg a) { _mm256_storeu_pd(ptr, a); }
+  static reg  set1(double a) { return _mm256_set1_pd(a); }
+  static reg  sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg  mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg  add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static mask less(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static reg  select(mask m, reg a, reg b) { return _mm256_blendv_pd(a, b, m); }
+
+  static index_reg iota() { return _mm256_setr_epi64x(0, 1, 2, 3); }
+  static index_reg add_index(index_reg a, index_type b) { return _mm256_add_epi64(a, _mm256_set1_epi64x(b)); }
+  static index_reg select(mask m, index_reg a, index_reg b) {
+    return _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), m));
+  }
+  static void store_index(index_type *ptr, index_reg a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), a); }
+};
+#endif
+
+template <typename T, std::size_t N>
+T leaf_distance_sq(const T *coords, std::size_t count, std::size_t index, const T *query) {
+  T result{};
+  for (std::size_t axis = 0; axis < N; ++axis) {
+    T diff = coords[axis * count + index] - query[axis];
+    result = result + diff * diff;
+  }
+  return result;
+}
+
+template <typename t_simd, std::size_t N>
+typename t_simd::reg simd_distance_sq(const auto *coords, std::size_t count, std::size_t index,
+                                      const typename t_simd::reg *query) {
+  auto result = t_simd::set1(0);
+  for (std::size_t axis = 0; axis < N; ++axis) {
+    auto diff = t_simd::sub(t_simd::load(coords + axis * count + index), query[axis]);
+    result = t_simd::add(result, t_simd::mul(diff, diff));
+  }
+  return result;
+}
+
+// Squared distances from the query to every point of a leaf.
+template <typename T, std::size_t N> void leaf_distances_sq(const T *coords, std::size_t count, const T *query, T *out) {
+  std::size_t i = 0;
+
+  if constexpr (simd_traits<T>::enabled) {
+    using simd = simd_traits<T>;
+    typename simd::reg query_reg[N]; // Not std::array, which would drop alignment attributes of the vector type.
+    for (std::size_t axis = 0; axis < N; ++axis) {
+      query_reg[axis] = simd::set1(query[axis]);
+    }
+
+    for (; i + simd::width <= count; i += simd::width) {
+      simd::store(out + i, simd_distance_sq<simd, N>(coords, count, i, query_reg));
+    }
+  }
+
+  for (; i < count; ++i) {
+    out[i] = leaf_distance_sq<T, N>(coords, count, i, query);
+  }
+}
+
+// Squared distance to the closest point of a non-empty leaf and its index. If there are several, the first one wins.
+template <typename T, std::size_t N>
+std::pair<T, std::size_t> leaf_closest(const T *coords, std::size_t count, const T *query) {
+  std::size_t i = 0, best_index = 0;
+  T           best_dist = leaf_distance_sq<T, N>(coords, count, 0, query);
+
+  if constexpr (simd_traits<T>::enabled) {
+    using simd = simd_traits<T>;
+    constexpr auto width = simd::width;
+
+    if (count >= width) {
+      typename simd::reg query_reg[N];
+      for (std::size_t axis = 0; axis < N; ++axis) {
+        query_reg[axis] = simd::set1(query[axis]);
+      }
+
+      // Every lane keeps the minimum and its index among the points that fall into it.
+      auto lane_dist = simd::set1(std::numeric_limits<T>::infinity());
+      auto lane_index = simd::iota(), curr_index = simd::iota();
+      for (; i + width <= count; i += width) {
+        auto dist = simd_distance_sq<simd, N>(coords, count, i, query_reg);
+        auto less = simd::less(dist, lane_dist);
+        lane_dist = simd::select(less, lane_dist, dist);
+        lane_index = simd::select(less, lane_index, curr_index);
+        curr_index = simd::add_index(curr_index, static_cast<typename simd::index_type>(width));
+      }
+
+      std::array<T, width>                         dists;
+      std::array<typename simd::index_type, width> indices;
+      simd::store(dists.data(), lane_dist);
+      simd::store_index(indices.data(), lane_index);
+
+      best_dist = dists[0];
+      best_index = indices[0];
+      for (std::size_t lane = 1; lane < width; ++lane) {
+        std::size_t index = indices[lane];
+        if (dists[lane] < best_dist || (dists[lane] == best_dist && index < best_index)) {
+          best_dist = dists[lane];
+          best_index = index;
+        }
+      }
+    }
+  }
+
+  for (; i < count; ++i) {
+    T dist = leaf_distance_sq<T, N>(coords, count, i, query);
+    if (dist < best_dist) {
+      best_dist = dist;
+      best_index = i;
+    }
+  }
+
+  return {best_dist, best_index};
+}
+
+} // namespace detail
+} // namespace throttle
@@ -0,0 +1,58 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace throttle {
+
+// Read-only shared mapping of a whole file. Pages come from the page cache, so processes that map the same file share
+// the memory.
+class mapped_file {
+  const std::byte *m_data = nullptr;
+  std::size_t      m_size = 0;
+
+public:
+  explicit mapped_file(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error{"Can't open " + path};
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+      ::close(fd);
+      throw std::runtime_error{"Can't map empty or unreadable file " + path};
+    }
+
+    void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping stays valid after the descriptor is closed.
+    if (data == MAP_FAILED) throw std::runtime_error{"Can't map " + path};
+
+    m_data = static_cast<const std::byte *>(data);
+    m_size = st.st_size;
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() { ::munmap(const_cast<std::byte *>(m_data), m_size); }
+
+  const std::byte *data() const { return m_data; }
+  std::size_t      size() const { return m_size; }
+};
+
+} // namespace throttle
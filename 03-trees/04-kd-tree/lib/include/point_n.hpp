@@ -47,8 +47,12 @@ public:
 };
 
 template <typename T, std::size_t N> T distance_sq(const point_n<T, N> &lhs, const point_n<T, N> &rhs) {
-  auto dist_range = ranges::views::transform(lhs, rhs, std::minus<T>{});
-  return ranges::inner_product(dist_range, dist_range, T{0});
+  T result{0};
+  for (std::size_t i = 0; i < N; ++i) {
+    T diff = lhs[i] - rhs[i];
+    result = result + diff * diff;
+  }
+  return result;
 }
 
 template <typename T, std::size_t N, typename t_stream> t_stream &operator>>(t_stream &istream, point_n<T, N> &rhs) {
@@ -1,12 +1,284 @@
 #include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <functional>
 #include <gtest/gtest.h>
 #include <iterator>
 #include <numeric>
+#include <random>
 #include <set>
 #include <string>
+#include <vector>
+
+#include "dynamic_kd_tree.hpp"
+#include "kd_tree.hpp"
+#include "point_n.hpp"
+
+namespace {
+using point3 = throttle::point_n<float, 3>;
+using point3d = throttle::point_n<double, 3>;
+
+std::vector<point3> random_points(std::size_t count, unsigned seed) {
+  std::mt19937                          gen{seed};
+  std::uniform_real_distribution<float> dist{-100, 100};
+  std::vector<point3>                   points(count);
+  for (auto &p : points) {
+    for (auto &c : p) {
+      c = dist(gen);
+    }
+  }
+  return points;
+}
+
+std::vector<float> sorted_distances(const std::vector<point3> &points, const point3 &query) {
+  std::vector<float> result;
+  for (const auto &p : points) {
+    result.push_back(throttle::distance_sq(p, query));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+throttle::kd_tree<point3> make_tree(const std::vector<point3> &points) {
+  throttle::kd_tree<point3> tree;
+  for (const auto &p : points) {
+    tree.insert(p);
+  }
+  return tree;
+}
+} // namespace
+
+TEST(test_kd_tree, test_1) {
+  auto points = random_points(20000, 1);
+  auto queries = random_points(200, 2);
+  auto tree = make_tree(points);
+
+  for (const auto &q : queries) {
+    auto expected = sorted_distances(points, q);
+    EXPECT_EQ(throttle::distance_sq(tree.nearest_neighbour(q), q), expected.front());
+
+    auto k_nearest = tree.k_nearest(q, 10);
+    ASSERT_EQ(k_nearest.size(), 10);
+    for (std::size_t i = 0; i < k_nearest.size(); ++i) {
+      EXPECT_EQ(throttle::distance_sq(k_nearest[i], q), expected[i]);
+    }
+
+    auto in_radius = tree.within_radius(q, 15);
+    auto count = std::upper_bound(expected.begin(), expected.end(), 15.0f * 15.0f) - expected.begin();
+    EXPECT_EQ(in_radius.size(), count);
+    for (const auto &p : in_radius) {
+      EXPECT_LE(throttle::distance_sq(p, q), 15.0f * 15.0f);
+    }
+  }
+}
+
+TEST(test_kd_tree, test_2) {
+  auto points = random_points(20000, 3);
+  auto queries = random_points(200, 4);
+  auto tree = make_tree(points);
+
+  for (const auto &q : queries) {
+    auto best = sorted_distances(points, q).front();
+    EXPECT_EQ(throttle::distance_sq(tree.approximate_nearest(q, 0), q), best);
+    // Squared distances are compared, so the factor is squared too.
+    EXPECT_LE(throttle::distance_sq(tree.approximate_nearest(q, 0.5), q), best * 1.5f * 1.5f);
+    tree.approximate_nearest(q, 0, 1); // Only the first leaf is visited, any point will do.
+  }
+
+  EXPECT_EQ(tree.k_nearest(queries[0], 30000).size(), points.size());
+  EXPECT_THROW(tree.approximate_nearest(queries[0], 0, 0), std::invalid_argument);
+}
+
+TEST(test_kd_tree, test_3) {
+  auto points = random_points(50000, 5);
+  auto queries = random_points(1000, 6);
+  auto tree = make_tree(points);
+
+  auto nearest = tree.nearest_neighbour(queries.begin(), queries.end());
+  auto k_nearest = tree.k_nearest(queries.begin(), queries.end(), 5);
+  auto in_radius = tree.within_radius(queries.begin(), queries.end(), 10);
+  auto approximate = tree.approximate_nearest(queries.begin(), queries.end(), 0);
+
+  ASSERT_EQ(nearest.size(), queries.size());
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    EXPECT_EQ(nearest[i], tree.nearest_neighbour(queries[i]));
+    EXPECT_EQ(approximate[i], nearest[i]);
+    EXPECT_EQ(k_nearest[i], tree.k_nearest(queries[i], 5));
+    EXPECT_EQ(in_radius[i].size(), tree.within_radius(queries[i], 10).size());
+  }
+}
+
+TEST(test_kd_tree, test_4) {
+  auto points = random_points(30000, 12);
+  auto queries = random_points(300, 13);
+  auto tree = make_tree(points);
+
+  const auto path = (std::filesystem::temp_directory_path() / "test_kd_tree_snapshot.bin").string();
+  tree.save(path);
+  auto mapped = throttle::kd_tree<point3>::open_mapped(path);
+  EXPECT_EQ(mapped.size(), tree.size());
+
+  for (const auto &q : queries) {
+    EXPECT_EQ(mapped.nearest_neighbour(q), tree.nearest_neighbour(q));
+    EXPECT_EQ(mapped.k_nearest(q, 7), tree.k_nearest(q, 7));
+    EXPECT_EQ(mapped.within_radius(q, 10).size(), tree.within_radius(q, 10).size());
+  }
+
+  // A copy shares the mapping, and inserting copies the points out of it.
+  auto copy = mapped;
+  copy.insert(queries[0]);
+  EXPECT_EQ(copy.nearest_neighbour(queries[0]), queries[0]);
+  EXPECT_EQ(mapped.nearest_neighbour(queries[0]), tree.nearest_neighbour(queries[0]));
+
+  EXPECT_THROW(throttle::kd_tree<point3d>::open_mapped(path), std::runtime_error);
+
+  // Truncated files and headers or nodes that point outside of the file are rejected before anything is read.
+  const auto corrupt = [&path](std::size_t position, std::uint64_t value) {
+    std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+    file.seekp(position);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+  const auto read_word = [&path](std::size_t position) {
+    std::ifstream file{path, std::ios::binary};
+    std::uint64_t value = 0;
+    file.seekg(position);
+    file.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+  };
+
+  // Header words from m_size to m_points_offset: huge counts and offsets, and misaligned offsets.
+  const auto file_size = std::filesystem::file_size(path);
+  for (std::size_t field = 5; field < 10; ++field) {
+    const auto saved = read_word(field * sizeof(std::uint64_t));
+    for (std::uint64_t value : {std::uint64_t{1} << 62, ~std::uint64_t{0} / 8, (field > 6 ? saved + 1 : ~saved)}) {
+      corrupt(field * sizeof(std::uint64_t), value);
+      EXPECT_THROW(throttle::kd_tree<point3>::open_mapped(path), std::runtime_error);
+    }
+    corrupt(field * sizeof(std::uint64_t), saved);
+  }
+
+  // The root is the first node, and its range of points ends far past the last point.
+  const auto nodes_offset = read_word(7 * sizeof(std::uint64_t));
+  corrupt(nodes_offset + 3 * sizeof(std::uint64_t), std::uint64_t{1} << 40);
+  EXPECT_THROW(throttle::kd_tree<point3>::open_mapped(path), std::runtime_error);
+
+  std::filesystem::resize_file(path, file_size / 2);
+  EXPECT_THROW(throttle::kd_tree<point3>::open_mapped(path), std::runtime_error);
+  std::filesystem::remove(path);
+  EXPECT_THROW(throttle::kd_tree<point3>::open_mapped(path), std::runtime_error);
+}
+
+TEST(test_kd_tree, test_build) {
+  using tree_type = throttle::kd_tree<point3>;
+
+  // Random points, points on an integer grid with many duplicates, points on a line and a single repeated point.
+  const auto make_points = [](std::size_t count, unsigned kind) {
+    auto                               points = random_points(count, 20 + kind);
+    std::mt19937                       gen{30 + kind};
+    std::uniform_int_distribution<int> grid{-2, 2};
+    for (auto &p : points) {
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (kind == 1) p[axis] = grid(gen);
+        if (kind == 2 && axis) p[axis] = 0;
+        if (kind == 3) p[axis] = axis + 1;
+      }
+    }
+    return points;
+  };
+
+  // Sizes below parallel_build_threshold are built serially, the largest one is split between threads.
+  for (std::size_t size : {std::size_t{1}, std::size_t{64}, std::size_t{65}, std::size_t{1000},
+                           tree_type::parallel_build_threshold - 1, 4 * tree_type::parallel_build_threshold}) {
+    for (unsigned kind = 0; kind < 4; ++kind) {
+      const auto points = make_points(size, kind);
+      auto       tree = make_tree(points);
+      ASSERT_EQ(tree.size(), size);
+
+      for (const auto &q : random_points(20, 40 + kind)) {
+        const auto expected = sorted_distances(points, q);
+        EXPECT_EQ(throttle::distance_sq(tree.nearest_neighbour(q), q), expected.front());
+
+        const float        radius = 50;
+        std::vector<float> in_radius;
+        for (const auto &p : tree.within_radius(q, radius)) {
+          in_radius.push_back(throttle::distance_sq(p, q));
+        }
+        std::sort(in_radius.begin(), in_radius.end());
+        auto last = std::upper_bound(expected.begin(), expected.end(), radius * radius);
+        EXPECT_TRUE(std::equal(in_radius.begin(), in_radius.end(), expected.begin(), last));
+      }
+    }
+  }
+}
+
+TEST(test_dynamic_kd_tree, test_1) {
+  auto points = random_points(5000, 7);
+  auto queries = random_points(5000, 8);
+
+  throttle::dynamic_kd_tree<point3> tree;
+  EXPECT_THROW(tree.nearest_neighbour(queries[0]), std::logic_error);
+
+  std::vector<point3> inserted;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(tree.insert(points[i]), i);
+    inserted.push_back(points[i]);
+    // Sizes of the trees are the binary representation of the number of points.
+    EXPECT_EQ(tree.trees(), std::popcount(inserted.size()));
+
+    if (i % 10 == 0) {
+      auto best = sorted_distances(inserted, queries[i]).front();
+      EXPECT_EQ(throttle::distance_sq(tree.nearest_neighbour(queries[i]), queries[i]), best);
+    }
+  }
+}
+
+TEST(test_dynamic_kd_tree, test_2) {
+  auto points = random_points(4000, 9);
+  auto queries = random_points(200, 10);
+
+  throttle::dynamic_kd_tree<point3> tree;
+  for (const auto &p : points) {
+    tree.insert(p);
+  }
+
+  std::vector<std::size_t> order(points.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937{11});
+
+  // Erase all points but the last 100 in random order. Compaction happens several times on the way.
+  std::set<std::size_t> erased;
+  for (std::size_t i = 0; i + 100 < order.size(); ++i) {
+    EXPECT_TRUE(tree.erase(order[i]));
+    EXPECT_FALSE(tree.erase(order[i]));
+    erased.insert(order[i]);
+    EXPECT_EQ(tree.size(), points.size() - erased.size());
+
+    if (i % 100 == 0) {
+      std::vector<point3> alive;
+      for (std::size_t j = 0; j < points.size(); ++j) {
+        if (!erased.count(j)) alive.push_back(points[j]);
+      }
+      for (const auto &q : queries) {
+        EXPECT_EQ(throttle::distance_sq(tree.nearest_neighbour(q), q), sorted_distances(alive, q).front());
+      }
+    }
+  }
+
+  EXPECT_FALSE(tree.contains(order.front()));
+  EXPECT_TRUE(tree.contains(order.back()));
+  EXPECT_FALSE(tree.erase(points.size()));
+
+  for (std::size_t i = order.size() - 100; i < order.size(); ++i) {
+    EXPECT_TRUE(tree.erase(order[i]));
+  }
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(tree.trees(), 0);
+  EXPECT_THROW(tree.nearest_neighbour(queries[0]), std::logic_error);
+}
 
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
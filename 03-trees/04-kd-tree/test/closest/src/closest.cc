@@ -1,6 +1,8 @@
 #include <chrono>
+#include <filesystem>
 #include <iostream>
 
+#include "dynamic_kd_tree.hpp"
 #include "kd_tree.hpp"
 #include "point_n.hpp"
 
@@ -16,8 +18,42 @@ template <typename T, std::size_t N> struct indexed_point_n : public throttle::p
 
 using point4 = indexed_point_n<float, 4>;
 
+// Half of the points are inserted beforehand. Then every round inserts one of the remaining points and answers one
+// query, until both run out or p_rounds rounds are done. A static kd_tree is rebuilt from scratch in every round, so
+// it's only given a few of them.
+template <typename t_tree>
+void measure_interleaved(const std::string &name, const std::vector<point4> &points, const std::vector<point4> &reqs,
+                         std::size_t p_rounds) {
+  t_tree      tree;
+  std::size_t inserted = points.size() / 2;
+  for (std::size_t i = 0; i < inserted; ++i) {
+    tree.insert(points[i]);
+  }
+
+  const std::size_t rounds = std::min(p_rounds, std::max(points.size() - inserted, reqs.size()));
+  std::size_t       ops = 0;
+  unsigned          checksum = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t i = 0; i < rounds; ++i) {
+    if (inserted < points.size()) {
+      tree.insert(points[inserted++]);
+      ++ops;
+    }
+    if (i < reqs.size()) {
+      checksum += tree.nearest_neighbour(reqs[i]).index;
+      ++ops;
+    }
+  }
+  auto finish = std::chrono::high_resolution_clock::now();
+
+  auto elapsed = std::chrono::duration<double>(finish - start).count();
+  std::cout << name << ": " << rounds << " rounds took " << elapsed * 1000 << "ms to run, "
+            << static_cast<long long>(ops / elapsed) << " operations per second (checksum " << checksum << ")\n";
 }
 
+} // namespace
+
 
 int main(int argc, char *argv[]) {
   std::vector<point4> points;
@@ -45,6 +81,7 @@ int main(int argc, char *argv[]) {
 
     point.index = i;
     kdtree.insert(point);
+    points.push_back(point);
   }
 
   int m;
@@ -71,6 +108,56 @@ int main(int argc, char *argv[]) {
     reqs.push_back(point);
   }
 
+  // With --interleaved inserts are mixed with queries, which is what dynamic_kd_tree is for.
+  if (argc > 1 && std::string{argv[1]} == "--interleaved") {
+    constexpr std::size_t static_rounds = 16;
+    measure_interleaved<throttle::dynamic_kd_tree<point4>>("Dynamic kd-tree", points, reqs, reqs.size() + n);
+    measure_interleaved<throttle::kd_tree<point4>>("Static kd-tree", points, reqs, static_rounds);
+    return 0;
+  }
+
+  // With --measure answers are not printed. Instead, sequential and batched queries are timed.
+  if (argc > 1 && std::string{argv[1]} == "--measure") {
+    auto build_start = std::chrono::high_resolution_clock::now();
+    kdtree.reconstruct();
+    auto build_finish = std::chrono::high_resolution_clock::now();
+    std::cout << "Construction took " << std::chrono::duration<double, std::milli>(build_finish - build_start).count()
+              << "ms to run\n";
+
+    const auto snapshot = (std::filesystem::temp_directory_path() / "closest_snapshot.bin").string();
+    kdtree.save(snapshot);
+    auto open_start = std::chrono::high_resolution_clock::now();
+    auto mapped = throttle::kd_tree<point4>::open_mapped(snapshot);
+    mapped.nearest_neighbour(reqs.empty() ? points.front() : reqs.front());
+    auto open_finish = std::chrono::high_resolution_clock::now();
+    std::filesystem::remove(snapshot);
+    std::cout << "Opening a mapped snapshot and answering the first query took "
+              << std::chrono::duration<double, std::milli>(open_finish - open_start).count() << "ms to run\n";
+
+    auto report = [m](const std::string &name, auto start, auto finish, unsigned checksum) {
+      auto elapsed = std::chrono::duration<double>(finish - start).count();
+      std::cout << name << " took " << elapsed * 1000 << "ms to run, " << static_cast<long long>(m / elapsed)
+                << " queries per second (checksum " << checksum << ")\n";
+    };
+
+    unsigned checksum = 0;
+    auto     start = std::chrono::high_resolution_clock::now();
+    for (const auto &q : reqs) {
+      checksum += kdtree.nearest_neighbour(q).index;
+    }
+    auto finish = std::chrono::high_resolution_clock::now();
+    report("Sequential queries", start, finish, checksum);
+
+    checksum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto &p : kdtree.nearest_neighbour(reqs.begin(), reqs.end())) {
+      checksum += p.index;
+    }
+    finish = std::chrono::high_resolution_clock::now();
+    report("Batched queries", start, finish, checksum);
+    return 0;
+  }
+
   for (const auto &q: reqs) {
     auto closest = kdtree.nearest_neighbour(q).index;
     std::cout << closest << "\n";
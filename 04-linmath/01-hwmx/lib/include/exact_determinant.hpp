@@ -0,0 +1,226 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Exact determinant of an integer matrix with multi-modular arithmetic:
+ * 1. By Hadamard's inequality |det A| <= prod ||a_i||, where a_i are rows of A. Primes are taken below 2^62 until their
+ *    product M exceeds twice the bound, so det A is the only value in (-M / 2, M / 2) with the right residues.
+ * 2. det A mod p is computed by Gaussian elimination over Z/p for every prime. Primes are independent, so they are
+ *    distributed between threads of the pool.
+ * 3. The residues are combined with the Chinese remainder theorem into an arbitrary precision integer.
+ *
+ * Numbers never grow during elimination, unlike fraction-free elimination in matrix::determinant(), which overflows
+ * the element type long before the determinant itself does.
+ */
+
+#pragma once
+
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace throttle::linmath {
+
+using big_integer = boost::multiprecision::cpp_int;
+
+namespace detail {
+
+// Arithmetic modulo an odd p < 2^62 in Montgomery form, where x is kept as x * 2^64 mod p. A product is reduced with
+// two multiplications and a shift instead of a 128-bit division.
+class montgomery_field {
+  using uint128 = unsigned __int128;
+
+  std::uint64_t m_mod, m_neg_inv, m_r2; // -p^-1 mod 2^64 and 2^128 mod p.
+
+  // val * 2^-64 mod p for val < p * 2^64.
+  std::uint64_t reduce(uint128 val) const {
+    const std::uint64_t coef = static_cast<std::uint64_t>(val) * m_neg_inv;
+    const auto          res = static_cast<std::uint64_t>((val + static_cast<uint128>(coef) * m_mod) >> 64);
+    return (res >= m_mod ? res - m_mod : res);
+  }
+
+public:
+  explicit montgomery_field(std::uint64_t mod) : m_mod{mod} {
+    // An odd p is its own inverse modulo 8, and every Newton step doubles the number of correct bits.
+    std::uint64_t inv = mod;
+    for (unsigned i = 0; i < 5; ++i) {
+      inv *= 2 - mod * inv;
+    }
+    m_neg_inv = -inv;
+    m_r2 = static_cast<std::uint64_t>(-static_cast<uint128>(mod) % mod);
+  }
+
+  std::uint64_t modulus() const { return m_mod; }
+
+  std::uint64_t to(std::uint64_t val) const { return reduce(static_cast<uint128>(val % m_mod) * m_r2); }
+  std::uint64_t from(std::uint64_t val) const { return reduce(val); }
+
+  std::uint64_t mul(std::uint64_t lhs, std::uint64_t rhs) const { return reduce(static_cast<uint128>(lhs) * rhs); }
+  std::uint64_t sub(std::uint64_t lhs, std::uint64_t rhs) const { return (lhs >= rhs ? lhs - rhs : lhs + m_mod - rhs); }
+
+  std::uint64_t pow(std::uint64_t base, std::uint64_t exp) const {
+    auto res = to(1);
+    for (; exp; exp >>= 1) {
+      if (exp & 1) res = mul(res, base);
+      base = mul(base, base);
+    }
+    return res;
+  }
+
+  std::uint64_t inverse(std::uint64_t val) const { return pow(val, m_mod - 2); }
+};
+
+// Miller-Rabin test with a set of bases that is deterministic for all 64-bit numbers. n has to be odd.
+inline bool is_prime(std::uint64_t n) {
+  const montgomery_field field{n};
+  const auto             one = field.to(1), minus_one = field.to(n - 1);
+  const auto             shift = std::countr_zero(n - 1);
+
+  for (std::uint64_t base : {2ull, 325ull, 9375ull, 28178ull, 450775ull, 9780504ull, 1795265022ull}) {
+    if (base % n == 0) continue;
+    auto val = field.pow(field.to(base), (n - 1) >> shift);
+    if (val == one || val == minus_one) continue;
+
+    bool composite = true;
+    for (int i = 1; i < shift && composite; ++i) {
+      val = field.mul(val, val);
+      composite = (val != minus_one);
+    }
+    if (composite) return false;
+  }
+
+  return true;
+}
+
+// The largest primes below 2^62, every one of them is greater than 2^61.
+inline std::vector<std::uint64_t> modular_primes(std::size_t count) {
+  std::vector<std::uint64_t> primes;
+  for (auto candidate = (std::uint64_t{1} << 62) - 1; primes.size() < count; candidate -= 2) {
+    if (is_prime(candidate)) primes.push_back(candidate);
+  }
+  return primes;
+}
+
+template <std::integral T> std::uint64_t residue(T val, std::uint64_t mod) {
+  if constexpr (std::is_signed_v<T>) {
+    // -(val + 1) doesn't overflow for the smallest value of T.
+    if (val < 0) return mod - 1 - static_cast<std::uint64_t>(-(val + 1)) % mod;
+  }
+  return static_cast<std::uint64_t>(val) % mod;
+}
+
+template <std::integral T> std::uint64_t determinant_modulo(const matrix<T> &mat, std::uint64_t mod) {
+  using size_type = std::size_t;
+
+  const montgomery_field     field{mod};
+  const auto                 size = mat.rows();
+  std::vector<std::uint64_t> work(size * size);
+  for (size_type i = 0; i < size; ++i) {
+    for (size_type j = 0; j < size; ++j) {
+      work[i * size + j] = field.to(residue(mat[i][j], mod));
+    }
+  }
+
+  auto det = field.to(1);
+  for (size_type k = 0; k < size; ++k) {
+    auto *pivot_row = work.data() + k * size;
+
+    size_type pivot = k;
+    while (pivot < size && work[pivot * size + k] == 0) {
+      ++pivot;
+    }
+    if (pivot == size) return 0;
+
+    if (pivot != k) {
+      std::swap_ranges(pivot_row + k, pivot_row + size, work.data() + pivot * size + k);
+      det = field.sub(0, det);
+    }
+
+    det = field.mul(det, pivot_row[k]);
+    const auto inv = field.inverse(pivot_row[k]);
+
+    for (size_type i = k + 1; i < size; ++i) {
+      auto *row = work.data() + i * size;
+      if (row[k] == 0) continue;
+      const auto coef = field.mul(row[k], inv);
+      for (size_type j = k + 1; j < size; ++j) {
+        row[j] = field.sub(row[j], field.mul(coef, pivot_row[j]));
+      }
+    }
+  }
+
+  return field.from(det);
+}
+
+} // namespace detail
+
+// Exact determinant of a matrix with integral elements.
+template <std::integral T> big_integer exact_determinant(const matrix<T> &mat) {
+  if (!mat.square()) throw std::runtime_error("Mismatched matrix size for determinant");
+
+  // log2 of Hadamard's bound. A zero row makes the determinant zero.
+  long double log_bound = 0;
+  for (std::size_t i = 0; i < mat.rows(); ++i) {
+    long double sum = 0;
+    for (auto val : mat[i]) {
+      sum += static_cast<long double>(val) * static_cast<long double>(val);
+    }
+    if (sum == 0) return 0;
+    log_bound += std::log2(sum) / 2;
+  }
+
+  // Every prime adds more than 61 bits to M, which has to be over 2 * bound. One more bit covers rounding of log2.
+  const auto count = static_cast<std::size_t>(std::ceil((log_bound + 2) / 61));
+  const auto primes = detail::modular_primes(count);
+
+  std::vector<std::uint64_t>      residues(count);
+  std::vector<std::exception_ptr> errors(count);
+  utility::default_thread_pool().parallel_for(count, [&](std::size_t i) {
+    try {
+      residues[i] = detail::determinant_modulo(mat, primes[i]);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+
+  // Incremental CRT: res is the determinant modulo the product of the primes so far.
+  big_integer res = residues[0], product = primes[0];
+  for (std::size_t i = 1; i < count; ++i) {
+    const detail::montgomery_field field{primes[i]};
+
+    const auto res_mod = static_cast<std::uint64_t>(res % primes[i]);
+    const auto product_mod = static_cast<std::uint64_t>(product % primes[i]);
+    const auto diff = field.sub(field.to(residues[i]), field.to(res_mod));
+    const auto coef = field.from(field.mul(diff, field.inverse(field.to(product_mod))));
+
+    res += product * coef;
+    product *= primes[i];
+  }
+
+  if (res > product / 2) res -= product;
+  return res;
+}
+
+} // namespace throttle::linmath
@@ -12,6 +12,8 @@
 
 #include "contiguous_matrix.hpp"
 #include "equal.hpp"
+#include "gemm.hpp"
+#include "matrix_expression.hpp"
 #include "utility.hpp"
 
 #include <algorithm>
@@ -39,9 +41,25 @@ concept models_ordered_ring = requires(T a, T b) {
   requires std::totally_ordered<T>;
 };
 
+template <typename T>
+requires models_ordered_ring<T>
+class matrix;
+
+namespace detail {
+
+template <typename T> struct is_matrix : std::false_type {};
+template <typename T> struct is_matrix<matrix<T>> : std::true_type {};
+
+} // namespace detail
+
+// Matrices and lazy expressions of them.
+template <typename T>
+concept matrix_operand = detail::is_matrix<std::remove_cvref_t<T>>::value || matrix_expression<std::remove_cvref_t<T>>;
+
 template <typename T>
 requires models_ordered_ring<T>
 class matrix {
+public:
   using value_type = T;
   using reference = T &;
   using const_reference = const T &;
@@ -49,9 +67,20 @@ class matrix {
   using const_pointer = const T *;
   using size_type = typename std::size_t;
 
+private:
   contiguous_matrix<T> m_contiguous_matrix;
   containers::vector<pointer> m_rows_vec;
 
+  template <matrix_expression E> void assign(const E &expr) {
+    for (size_type i = 0; i < rows(); ++i) {
+      const auto row = expr.row(i);
+      const auto dest = m_rows_vec[i];
+      for (size_type j = 0; j < cols(); ++j) {
+        dest[j] = row(j);
+      }
+    }
+  }
+
   void update_rows_vec() {
     m_rows_vec.reserve(rows());
 
@@ -84,6 +113,25 @@ public:
     update_rows_vec();
   }
 
+  // Evaluates an expression like A + B * c - D in one pass, see matrix_expression.hpp.
+  template <matrix_expression E>
+  requires std::same_as<typename E::value_type, value_type>
+  matrix(const E &expr) : matrix{expr.rows(), expr.cols()} {
+    assign(expr);
+  }
+
+  // Elements are only computed from the elements at the same place, so the expression may refer to this matrix.
+  template <matrix_expression E>
+  requires std::same_as<typename E::value_type, value_type>
+  matrix &operator=(const E &expr) {
+    if (rows() != expr.rows() || cols() != expr.cols()) {
+      *this = matrix{expr};
+      return *this;
+    }
+    assign(expr);
+    return *this;
+  }
+
   static matrix zero(size_type rows, size_type cols) {
     return matrix<T>{rows, cols};
   }
@@ -330,61 +378,142 @@ public:
     return *this;
   }
 
-  matrix &operator+=(const matrix &other) {
-    if (rows() != other.rows() || cols() != other.cols()) throw std::runtime_error("Mismatched matrix sizes");
-    for (size_type i = 0; i < rows(); ++i) {
-      auto row_first = (*this)[i];
-      auto row_second = other[i];
-      ranges::transform(row_first, row_second, row_first.begin(), std::plus<value_type>{});
-    }
-    return *this;
-  }
+  template <matrix_operand E> matrix &operator+=(const E &other) { return (*this = *this + other); }
+  template <matrix_operand E> matrix &operator-=(const E &other) { return (*this = *this - other); }
 
-  matrix &operator-=(const matrix &other) {
-    if (rows() != other.rows() || cols() != other.cols()) throw std::runtime_error("Mismatched matrix sizes");
-    for (size_type i = 0; i < rows(); ++i) {
-      auto row_first = (*this)[i];
-      auto row_second = other[i];
-      ranges::transform(row_first, row_second, row_first.begin(), std::minus<value_type>{});
-    }
+  matrix &operator*=(const matrix &rhs) {
+    *this = product(*this, rhs);
     return *this;
   }
 
-  matrix &operator*=(const matrix &rhs) {
-    if (cols() != rhs.rows()) throw std::runtime_error("Mismatched matrix sizes");
+  // float and double go to the blocked multithreaded kernel, other rings use plain dot products.
+  static matrix product(const matrix &lhs, const matrix &rhs) {
+    if (lhs.cols() != rhs.rows()) throw std::runtime_error("Mismatched matrix sizes");
 
-    matrix res{rows(), rhs.cols()}, t_rhs = rhs;
-    t_rhs.transpose();
+    matrix res{lhs.rows(), rhs.cols()};
+    if constexpr (detail::gemm_element<value_type>) {
+      gemm(lhs.rows(), rhs.cols(), lhs.cols(), lhs.m_rows_vec.data(), rhs.m_rows_vec.data(), res.m_rows_vec.data());
+      return res;
+    }
 
-    for (size_type i = 0; i < rows(); i++) {
+    const auto t_rhs = transposed(rhs);
+    for (size_type i = 0; i < lhs.rows(); i++) {
       for (size_type j = 0; j < t_rhs.rows(); j++) {
-        const auto range_first = (*this)[i], range_second = t_rhs[j];
+        const auto range_first = lhs[i], range_second = t_rhs[j];
         res[i][j] = ranges::accumulate(
             ranges::views::zip_with(std::multiplies<value_type>{}, range_first, range_second), value_type{});
       }
     }
 
-    std::swap(*this, res);
-    return *this;
+    return res;
   }
-};
 
-// clang-format off
-template <typename T> matrix<T> operator*(const matrix<T> &lhs, T rhs) { auto res = lhs; res *= rhs; return res; }
-template <typename T> matrix<T> operator*(T lhs, const matrix<T> &rhs) { auto res = rhs; res *= lhs; return res; }
-
-template <typename T> matrix<T> operator+(const matrix<T> &lhs, const matrix<T> &rhs) { auto res = lhs; res += rhs; return res; }
-template <typename T> matrix<T> operator-(const matrix<T> &lhs, const matrix<T> &rhs) { auto res = lhs; res -= rhs; return res; }
-
-template <typename T> matrix<T> operator*(const matrix<T> &lhs, const matrix<T> &rhs) { auto res = lhs; res *= rhs; return res; }
-template <typename T> matrix<T> operator/(const matrix<T> &lhs, T rhs) { auto res = lhs; res /= rhs; return res; }
+private:
+  static matrix transposed(const matrix &mat) {
+    matrix res{mat.cols(), mat.rows()};
+    for (size_type i = 0; i < mat.rows(); i++) {
+      for (size_type j = 0; j < mat.cols(); j++) {
+        res[j][i] = mat[i][j];
+      }
+    }
+    return res;
+  }
+};
 
-template <typename T> bool operator==(const matrix<T> &lhs, const matrix<T> &rhs) { return lhs.equal(rhs); }
-template <typename T> bool operator!=(const matrix<T> &lhs, const matrix<T> &rhs) { return !(lhs.equal(rhs)); }
+template <matrix_operand T> using operand_value_t = typename std::remove_cvref_t<T>::value_type;
 
-template <typename T> matrix<T> transpose(const matrix<T> &mat) { auto res = mat; res.transpose(); return res; }
+namespace detail {
 
-// clang-format on
+// Named matrices are referred to, temporaries are moved into the expression.
+template <matrix_operand T> auto as_expression(T &&operand) {
+  if constexpr (is_matrix<std::remove_cvref_t<T>>::value) {
+    if constexpr (std::is_lvalue_reference_v<T>) {
+      return matrix_terminal<const std::remove_cvref_t<T> &>{operand};
+    } else {
+      return matrix_terminal<std::remove_cvref_t<T>>{std::move(operand)};
+    }
+  } else {
+    return std::remove_cvref_t<T>{std::forward<T>(operand)};
+  }
+}
+
+// Expressions are evaluated into a matrix, matrices are passed as they are.
+template <matrix_operand T> decltype(auto) evaluate(const T &operand) {
+  if constexpr (is_matrix<T>::value) {
+    return (operand);
+  } else {
+    return matrix<operand_value_t<T>>{operand};
+  }
+}
+
+template <typename L, typename R>
+concept same_value_operands = matrix_operand<L> && matrix_operand<R> &&
+                              std::same_as<operand_value_t<L>, operand_value_t<R>>;
+
+} // namespace detail
+
+// Element-wise operators return lazy expressions, not matrices. A result stored with auto refers to the named matrices
+// it was built from: it sees their later changes and must not outlive them, and it has no member functions of matrix.
+// Declare the result as a matrix to get an independent copy:
+//   matrix<double> c = a + b; // evaluated now
+//   auto           e = a + b; // evaluated when assigned to a matrix, reads a and b at that point
+template <typename L, typename R>
+requires detail::same_value_operands<L, R>
+auto operator+(L &&lhs, R &&rhs) {
+  using expression = detail::binary_expression<decltype(detail::as_expression(std::forward<L>(lhs))),
+                                               decltype(detail::as_expression(std::forward<R>(rhs))),
+                                               std::plus<operand_value_t<L>>>;
+  return expression{detail::as_expression(std::forward<L>(lhs)), detail::as_expression(std::forward<R>(rhs))};
+}
+
+template <typename L, typename R>
+requires detail::same_value_operands<L, R>
+auto operator-(L &&lhs, R &&rhs) {
+  using expression = detail::binary_expression<decltype(detail::as_expression(std::forward<L>(lhs))),
+                                               decltype(detail::as_expression(std::forward<R>(rhs))),
+                                               std::minus<operand_value_t<L>>>;
+  return expression{detail::as_expression(std::forward<L>(lhs)), detail::as_expression(std::forward<R>(rhs))};
+}
+
+template <matrix_operand E> auto operator*(E &&lhs, operand_value_t<E> rhs) {
+  using expression = detail::scalar_expression<decltype(detail::as_expression(std::forward<E>(lhs))),
+                                               std::multiplies<operand_value_t<E>>>;
+  return expression{detail::as_expression(std::forward<E>(lhs)), std::move(rhs)};
+}
+
+template <matrix_operand E> auto operator*(operand_value_t<E> lhs, E &&rhs) { return std::forward<E>(rhs) * lhs; }
+
+template <matrix_operand E> auto operator/(E &&lhs, operand_value_t<E> rhs) {
+  using expression = detail::scalar_expression<decltype(detail::as_expression(std::forward<E>(lhs))),
+                                               std::divides<operand_value_t<E>>>;
+  return expression{detail::as_expression(std::forward<E>(lhs)), std::move(rhs)};
+}
+
+// Products aren't element-wise, so they are computed right away by the multiplication kernel. Expressions among the
+// factors are evaluated first.
+template <typename L, typename R>
+requires detail::same_value_operands<L, R>
+matrix<operand_value_t<L>> operator*(const L &lhs, const R &rhs) {
+  return matrix<operand_value_t<L>>::product(detail::evaluate(lhs), detail::evaluate(rhs));
+}
+
+template <typename L, typename R>
+requires detail::same_value_operands<L, R>
+bool operator==(const L &lhs, const R &rhs) {
+  return detail::evaluate(lhs).equal(detail::evaluate(rhs));
+}
+
+template <typename L, typename R>
+requires detail::same_value_operands<L, R>
+bool operator!=(const L &lhs, const R &rhs) {
+  return !(lhs == rhs);
+}
+
+template <matrix_operand E> matrix<operand_value_t<E>> transpose(const E &mat) {
+  matrix<operand_value_t<E>> res = mat;
+  res.transpose();
+  return res;
+}
 
 } // namespace linmath
-} // namespace throttle
\ No newline at end of file
+} // namespace throttle
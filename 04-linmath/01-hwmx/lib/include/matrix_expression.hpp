@@ -0,0 +1,105 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Lazy element-wise arithmetic on matrices. Operators on matrices build a tree of the nodes below instead of computing
+ * anything, and the tree is evaluated when it's assigned to a matrix: one loop over the destination computes every
+ * element of A + B * c - D at once, so there are no temporaries and every operand is read once. Inner loops only index
+ * rows of the operands, which lets the compiler vectorize them.
+ *
+ * A node has rows(), cols() and row(i), which returns a function of the column index that gives the element. Matrices
+ * enter the tree as matrix_terminal, which refers to a named matrix and owns a temporary one, so an expression never
+ * refers to a temporary that is already destroyed. Named matrices are not copied, so an expression kept in an auto
+ * variable is a view of them: it follows their changes and dangles once they are destroyed. Only assignment to a
+ * matrix makes a result that is independent of the operands.
+ */
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace throttle {
+namespace linmath {
+
+template <typename E>
+concept matrix_expression = requires(const E &expr, std::size_t index) {
+  typename E::value_type;
+  { expr.rows() } -> std::convertible_to<std::size_t>;
+  { expr.cols() } -> std::convertible_to<std::size_t>;
+  { expr.row(index)(index) } -> std::convertible_to<typename E::value_type>;
+};
+
+namespace detail {
+
+// M is a const reference for named matrices and a value for temporaries.
+template <typename M> class matrix_terminal {
+  M m_mat;
+
+public:
+  using value_type = typename std::remove_cvref_t<M>::value_type;
+
+  explicit matrix_terminal(M mat) : m_mat{std::forward<M>(mat)} {}
+
+  std::size_t rows() const { return m_mat.rows(); }
+  std::size_t cols() const { return m_mat.cols(); }
+
+  auto row(std::size_t index) const {
+    return [row = m_mat[index]](std::size_t col) { return row[col]; };
+  }
+};
+
+template <matrix_expression L, matrix_expression R, typename Op> class binary_expression {
+  L m_lhs;
+  R m_rhs;
+
+public:
+  using value_type = typename L::value_type;
+
+  binary_expression(L lhs, R rhs) : m_lhs{std::move(lhs)}, m_rhs{std::move(rhs)} {
+    if (m_lhs.rows() != m_rhs.rows() || m_lhs.cols() != m_rhs.cols()) {
+      throw std::runtime_error("Mismatched matrix sizes");
+    }
+  }
+
+  std::size_t rows() const { return m_lhs.rows(); }
+  std::size_t cols() const { return m_lhs.cols(); }
+
+  auto row(std::size_t index) const {
+    return [lhs = m_lhs.row(index), rhs = m_rhs.row(index)](std::size_t col) { return Op{}(lhs(col), rhs(col)); };
+  }
+};
+
+// Op is applied to every element and the scalar, in this order.
+template <matrix_expression E, typename Op> class scalar_expression {
+public:
+  using value_type = typename E::value_type;
+
+private:
+  E          m_expr;
+  value_type m_scalar;
+
+public:
+  scalar_expression(E expr, value_type scalar) : m_expr{std::move(expr)}, m_scalar{std::move(scalar)} {}
+
+  std::size_t rows() const { return m_expr.rows(); }
+  std::size_t cols() const { return m_expr.cols(); }
+
+  auto row(std::size_t index) const {
+    return [row = m_expr.row(index), scalar = m_scalar](std::size_t col) { return Op{}(row(col), scalar); };
+  }
+};
+
+} // namespace detail
+
+} // namespace linmath
+} // namespace throttle
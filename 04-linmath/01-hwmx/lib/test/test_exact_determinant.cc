@@ -0,0 +1,102 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "exact_determinant.hpp"
+#include "matrix.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace linmath = throttle::linmath;
+
+namespace {
+
+// L * U, where L is unit lower triangular and U is upper triangular with the given diagonal, so the determinant is the
+// product of the diagonal. Rows are then shuffled by swapping the first two.
+linmath::matrix<long long> make_lu_product(const std::vector<long long> &diag, unsigned seed) {
+  const auto                                size = diag.size();
+  std::mt19937                              gen{seed};
+  std::uniform_int_distribution<long long> dist{-3, 3};
+
+  linmath::matrix<long long> lower{size, size}, upper{size, size}, res{size, size};
+  for (std::size_t i = 0; i < size; ++i) {
+    lower[i][i] = 1;
+    upper[i][i] = diag[i];
+    for (std::size_t j = 0; j < i; ++j) {
+      lower[i][j] = dist(gen);
+      upper[j][i] = dist(gen);
+    }
+  }
+
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      for (std::size_t k = 0; k < size; ++k) {
+        res[i][j] += lower[i][k] * upper[k][j];
+      }
+    }
+  }
+
+  for (std::size_t j = 0; j < size; ++j) {
+    std::swap(res[0][j], res[1][j]);
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(test_exact_determinant, test_primes) {
+  const auto primes = linmath::detail::modular_primes(3);
+  EXPECT_EQ(primes[0], 4611686018427387847ull); // The largest prime below 2^62.
+  for (auto prime : primes) {
+    EXPECT_GT(prime, std::uint64_t{1} << 61);
+  }
+
+  EXPECT_TRUE(linmath::detail::is_prime(1000000007));
+  EXPECT_FALSE(linmath::detail::is_prime(1000000007ull * 998244353ull));
+  // Strong pseudoprime to bases 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31 and 37.
+  EXPECT_FALSE(linmath::detail::is_prime(3825123056546413051ull));
+}
+
+TEST(test_exact_determinant, test_small) {
+  linmath::matrix<int> mat{3, 3, {-4, -10, 10, 20, 90, -35, 5, 0, 1}};
+  EXPECT_EQ(linmath::exact_determinant(mat), -2910);
+
+  linmath::matrix<int> singular{3, 3, {1, 2, 3, 2, 4, 6, 7, 8, 9}};
+  EXPECT_EQ(linmath::exact_determinant(singular), 0);
+
+  linmath::matrix<int> zero_row{2, 2, {0, 0, 1, 2}};
+  EXPECT_EQ(linmath::exact_determinant(zero_row), 0);
+
+  EXPECT_THROW(linmath::exact_determinant(linmath::matrix<int>{2, 3}), std::runtime_error);
+}
+
+TEST(test_exact_determinant, test_extreme_elements) {
+  constexpr auto             min = std::numeric_limits<long long>::min(), max = std::numeric_limits<long long>::max();
+  linmath::matrix<long long> mat{2, 2, {min, max, max, min}};
+
+  const linmath::big_integer big_min = min, big_max = max;
+  EXPECT_EQ(linmath::exact_determinant(mat), big_min * big_min - big_max * big_max);
+}
+
+TEST(test_exact_determinant, test_large) {
+  // The determinant is far out of the range of long long, so several primes are needed.
+  std::vector<long long> diag;
+  linmath::big_integer   expected = -1;
+  for (long long i = 0; i < 60; ++i) {
+    diag.push_back((i % 2 ? -1 : 1) * (1000 + 37 * i));
+    expected *= diag.back();
+  }
+
+  EXPECT_EQ(linmath::exact_determinant(make_lu_product(diag, 1)), expected);
+}
@@ -0,0 +1,101 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename T> throttle::linmath::matrix<T> random_matrix(std::size_t rows, std::size_t cols, unsigned seed) {
+  std::mt19937                      gen{seed};
+  std::uniform_real_distribution<T> dist{-1, 1};
+  throttle::linmath::matrix<T>      res{rows, cols};
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t j = 0; j < cols; ++j) {
+      res[i][j] = dist(gen);
+    }
+  }
+  return res;
+}
+
+template <typename T>
+throttle::linmath::matrix<T> naive_product(const throttle::linmath::matrix<T> &lhs,
+                                           const throttle::linmath::matrix<T> &rhs) {
+  throttle::linmath::matrix<T> res{lhs.rows(), rhs.cols()};
+  for (std::size_t i = 0; i < lhs.rows(); ++i) {
+    for (std::size_t p = 0; p < lhs.cols(); ++p) {
+      for (std::size_t j = 0; j < rhs.cols(); ++j) {
+        res[i][j] += lhs[i][p] * rhs[p][j];
+      }
+    }
+  }
+  return res;
+}
+
+template <typename T> void check_product(std::size_t m, std::size_t k, std::size_t n, T precision) {
+  auto a = random_matrix<T>(m, k, m * 31 + k), b = random_matrix<T>(k, n, k * 17 + n);
+  auto expected = naive_product(a, b), actual = a * b;
+  ASSERT_EQ(actual.rows(), m);
+  ASSERT_EQ(actual.cols(), n);
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      EXPECT_NEAR(actual[i][j], expected[i][j], precision);
+    }
+  }
+}
+
+} // namespace
+
+TEST(test_gemm, test_small_sizes) {
+  // Sizes around the register tile, including ones that leave partial tiles on every edge.
+  for (std::size_t m : {1, 5, 6, 7, 13})
+    for (std::size_t k : {1, 3, 17})
+      for (std::size_t n : {1, 7, 8, 9, 17, 33}) {
+        check_product<float>(m, k, n, 1e-4f);
+        check_product<double>(m, k, n, 1e-12);
+      }
+}
+
+TEST(test_gemm, test_large_sizes) {
+  // Larger than every cache block in at least one dimension.
+  check_product<float>(200, 600, 130, 1e-3f);
+  check_product<double>(131, 300, 4100, 1e-10);
+}
+
+TEST(test_gemm, test_swapped_rows) {
+  auto a = random_matrix<double>(50, 40, 1), b = random_matrix<double>(40, 30, 2);
+  a.swap_rows(0, 49);
+  b.swap_rows(3, 7);
+  EXPECT_TRUE((a * b).equal(naive_product(a, b), 1e-12));
+}
+
+TEST(test_gemm, test_thread_pool) {
+  throttle::utility::thread_pool pool{3};
+  EXPECT_EQ(pool.concurrency(), 4);
+
+  std::vector<std::atomic<int>> hits(1000);
+  for (int round = 0; round < 10; ++round) {
+    pool.parallel_for(hits.size(), [&](std::size_t i) { hits[i].fetch_add(1); });
+  }
+  for (const auto &h : hits) {
+    EXPECT_EQ(h.load(), 10);
+  }
+
+  pool.parallel_for(0, [](std::size_t) { FAIL(); });
+}
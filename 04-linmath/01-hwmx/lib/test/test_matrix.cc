@@ -13,6 +13,7 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <iostream>
+#include <type_traits>
 
 using matrix = typename throttle::linmath::matrix<float>;
 
@@ -145,4 +146,60 @@ TEST(test_matrix, test_determinant_for_fields_2) {
 TEST(test_matrix, test_determinant_for_fields_3) {
   matrix A{3, 4, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}};
   EXPECT_THROW(A.determinant(), std::runtime_error);
-}
\ No newline at end of file
+}
+TEST(test_matrix, test_expression_1) {
+  matrix A{2, 3, {1, 2, 3, 4, 5, 6}};
+  matrix B{2, 3, {6, 5, 4, 3, 2, 1}};
+  matrix D{2, 3, {1, 1, 1, 1, 1, 1}};
+
+  // Operands are only read.
+  matrix C = A + B * 2.0f - D / 0.5f;
+  EXPECT_EQ(C, matrix(2, 3, {11, 10, 9, 8, 7, 6}));
+  EXPECT_EQ(A, matrix(2, 3, {1, 2, 3, 4, 5, 6}));
+  EXPECT_EQ(B, matrix(2, 3, {6, 5, 4, 3, 2, 1}));
+  EXPECT_THROW(matrix{A + B + matrix(3, 2)}, std::runtime_error);
+}
+
+TEST(test_matrix, test_expression_2) {
+  matrix A{2, 2, {1, 2, 3, 4}};
+  matrix B{2, 2, {4, 3, 2, 1}};
+
+  // The destination may be an operand, and assignment of another shape makes a new matrix.
+  A = 2.0f * A + B;
+  EXPECT_EQ(A, matrix(2, 2, {6, 7, 8, 9}));
+  A += B - A;
+  EXPECT_EQ(A, B);
+  A = matrix{1, 2, {1, 2}} * 3.0f;
+  EXPECT_EQ(A, matrix(1, 2, {3, 6}));
+}
+
+TEST(test_matrix, test_expression_3) {
+  matrix A{2, 2, {1, 2, 3, 4}};
+  matrix B{2, 2, {0, 1, 1, 0}};
+
+  // Factors are evaluated before the product, and the expression owns the temporary product.
+  auto   expr = A * B + A;
+  matrix C = expr;
+  EXPECT_EQ(C, matrix(2, 2, {3, 3, 7, 7}));
+  EXPECT_EQ((A + B) * (A - B), matrix(2, 2, {7, 13, 12, 20}));
+  EXPECT_EQ(transpose(A + B), matrix(2, 2, {1, 4, 3, 4}));
+}
+
+TEST(test_matrix, test_expression_auto) {
+  matrix A{2, 2, {1, 2, 3, 4}};
+  matrix B{2, 2, {1, 1, 1, 1}};
+
+  // A result declared as a matrix is evaluated right away, while auto keeps a view that reads A and B when evaluated.
+  matrix owned = A + B;
+  auto   view = A + B;
+  static_assert(!std::is_same_v<decltype(view), matrix>);
+
+  A[0][0] = 10;
+  EXPECT_EQ(owned, matrix(2, 2, {2, 3, 4, 5}));
+  EXPECT_EQ(view, matrix(2, 2, {11, 3, 4, 5}));
+
+  // Temporaries are owned by the expression and don't change with anything else.
+  auto scaled = matrix{2, 2, {1, 2, 3, 4}} * 2.0f;
+  A[0][0] = 0;
+  EXPECT_EQ(scaled, matrix(2, 2, {2, 4, 6, 8}));
+}
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "contiguous_matrix.hpp"
+#include "exact_determinant.hpp"
 #include "matrix.hpp"
 #include "vector.hpp"
 
@@ -19,7 +20,8 @@
 
 namespace po = boost::program_options;
 
-template <typename T> bool main_loop_determinant(unsigned n, bool measure = false) {
+// With exact, the determinant is computed as an arbitrary precision integer, otherwise in the element type.
+template <typename T, bool exact = false> bool main_loop_determinant(unsigned n, bool measure = false) {
   throttle::linmath::matrix<T> m{n, n};
 
   for (unsigned i = 0; i < n * n; ++i) {
@@ -32,7 +34,13 @@ template <typename T> bool main_loop_determinant(unsigned n, bool measure = fals
   }
 
   auto start = std::chrono::high_resolution_clock::now();
-  auto det = m.determinant();
+  auto det = [&m]() {
+    if constexpr (exact) {
+      return throttle::linmath::exact_determinant(m);
+    } else {
+      return m.determinant();
+    }
+  }();
   auto finish = std::chrono::high_resolution_clock::now();
   auto elapsed = std::chrono::duration<double, std::milli>(finish - start);
 
@@ -56,7 +64,7 @@ int main(int argc, char *argv[]) {
   po::options_description desc("Available options");
   desc.add_options()("help,h", "Print this help message")("measure,m", "Print perfomance metrics")(
       "type,t", po::value<std::string>(&opt)->default_value("double"),
-      "Type for matrix element (int, long, float, double)");
+      "Type for matrix element (int, long, float, double, bigint)");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -97,5 +105,7 @@ int main(int argc, char *argv[]) {
     if (!main_loop_determinant<float>(n, measure)) return 1;
   } else if (opt == "double") {
     if (!main_loop_determinant<double>(n, measure)) return 1;
+  } else if (opt == "bigint") {
+    if (!main_loop_determinant<long long, true>(n, measure)) return 1;
   }
 }
\ No newline at end of file
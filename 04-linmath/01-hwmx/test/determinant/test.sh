@@ -10,11 +10,11 @@ passed=true
 for file in ${current_folder}/${base_folder}/*.dat; do
     echo -n "Testing ${green}${file}${reset} ... "
 
-    # Check if an argument to executable location has been passed to the program
+    # Check if an argument to executable location has been passed to the program, the fourth one is passed to it
     if [ -z "$1" ]; then
         bin/determinant < $file > ${current_folder}/$base_folder/temp.tmp
     else
-        $1 < $file > ${current_folder}/$base_folder/temp.tmp
+        $1 $4 < $file > ${current_folder}/$base_folder/temp.tmp
     fi
 
     # Compare inputs
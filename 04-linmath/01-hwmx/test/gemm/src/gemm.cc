@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/program_options/option.hpp>
+
+namespace po = boost::program_options;
+
+template <typename T> throttle::linmath::matrix<T> random_matrix(std::size_t n, unsigned seed) {
+  std::mt19937                      gen{seed};
+  std::uniform_real_distribution<T> dist{-1, 1};
+  throttle::linmath::matrix<T>      res{n, n};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      res[i][j] = dist(gen);
+    }
+  }
+  return res;
+}
+
+template <typename T>
+void report(const std::string &name, std::size_t n, std::chrono::high_resolution_clock::time_point start,
+            std::chrono::high_resolution_clock::time_point finish) {
+  auto elapsed = std::chrono::duration<double>(finish - start).count();
+  std::cout << name << " took " << elapsed * 1000 << "ms to run, " << 2.0 * n * n * n / elapsed / 1e9 << " GFLOP/s\n";
+}
+
+template <typename T> void benchmark(std::size_t n, bool naive) {
+  auto a = random_matrix<T>(n, 1), b = random_matrix<T>(n, 2);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  auto c = a * b;
+  auto finish = std::chrono::high_resolution_clock::now();
+  report<T>("Blocked multiplication", n, start, finish);
+
+  if (!naive) return;
+
+  // Row by row dot products with a transposed copy of rhs, which is what other element types get.
+  start = std::chrono::high_resolution_clock::now();
+  throttle::linmath::matrix<T> d{n, n}, t_b = transpose(b);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      T sum{};
+      for (std::size_t p = 0; p < n; ++p) {
+        sum += a[i][p] * t_b[j][p];
+      }
+      d[i][j] = sum;
+    }
+  }
+  finish = std::chrono::high_resolution_clock::now();
+  report<T>("Naive multiplication", n, start, finish);
+
+  T max_diff{};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      max_diff = std::max(max_diff, std::abs(c[i][j] - d[i][j]));
+    }
+  }
+  std::cout << "Maximum difference: " << max_diff << "\n";
+}
+
+int main(int argc, char *argv[]) {
+  std::size_t n;
+  std::string type;
+
+  po::options_description desc("Available options");
+  desc.add_options()("help,h", "Print this help message")(
+      "size,n", po::value<std::size_t>(&n)->default_value(1024), "Size of square matrices")(
+      "type,t", po::value<std::string>(&type)->default_value("double"), "Type for matrix element (float, double)")(
+      "naive", "Compare with naive multiplication");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  std::cout << "Using " << throttle::utility::default_thread_pool().concurrency() << " threads\n";
+  if (type == "float") {
+    benchmark<float>(n, vm.count("naive"));
+  } else if (type == "double") {
+    benchmark<double>(n, vm.count("naive"));
+  } else {
+    std::cout << "Unknown type " << type << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "resistor_network.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace circuits {
+
+// Text netlists are records "a -- b, r;" with an optional EMF "e V" and a semicolon after it, separated by any
+// whitespace. Ends are node names, the EMF acts from a to b.
+//
+// Binary netlists start with the 8 bytes "RNETLIST" and the number of edges as a 64-bit integer, followed by the edges
+// as 24-byte resistor_edge records: two 32-bit names, resistance and EMF. Integers and doubles are in the byte order of
+// the machine that wrote them, so they are loaded without any parsing.
+namespace netlist {
+
+constexpr std::string_view binary_magic = "RNETLIST";
+
+// Throws std::runtime_error with the line number if the text is malformed. Texts over parallel_threshold bytes are cut
+// into chunks at line breaks before records, which are parsed concurrently.
+constexpr std::size_t      parallel_threshold = std::size_t{1} << 20;
+std::vector<resistor_edge> parse(std::string_view text);
+
+// Maps the file into memory and parses it, text or binary is told by the magic. The descriptor version is for stdin,
+// which is read into a buffer if it's a pipe.
+std::vector<resistor_edge> load(const std::string &path);
+std::vector<resistor_edge> load(int descriptor);
+
+void save_binary(const std::string &path, std::span<const resistor_edge> edges);
+
+} // namespace netlist
+
+} // namespace circuits
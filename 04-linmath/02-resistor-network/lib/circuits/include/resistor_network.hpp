@@ -1,8 +1,14 @@
 #include "linear_solver.hpp"
 #include "matrix.hpp"
+#include "sparse_ldlt.hpp"
 #include "vector.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <span>
 #include <utility>
 #include <vector>
 
@@ -15,50 +21,194 @@ namespace circuits {
 
 namespace linmath = throttle::linmath;
 
-class connected_resistor_network {
-  using resistance_emf_pair = std::pair<double, double>;
-  std::unordered_map<unsigned, std::unordered_map<unsigned, resistance_emf_pair>> m_map;
+// Systems are factored with sparse LDL^T when its symbolic analysis predicts at most max_factor_size values in the
+// factor (512 MB for the default). Larger ones are solved iteratively: with conjugate gradients when there are no short
+// circuits and the matrix is positive definite, with BiCGSTAB and then GMRES otherwise. If iterations don't converge,
+// they are factored anyway. solved_resistor_network applies up to max_updates changes of resistances to a factorization
+// before computing it again.
+//
+// Before assembling, solve() simplifies every component if reduce is set: dangling subtrees are cut off, and series and
+// parallel edges are joined. With star_mesh, nodes with three resistors are also replaced with a triangle between their
+// neighbours. That's the fill-in eliminating the node would make anyway, so it's off by default.
+struct solver_options {
+  double      tolerance = 1e-10;
+  std::size_t max_iterations = 10000;
+  std::size_t max_factor_size = std::size_t{1} << 26;
+  std::size_t max_updates = 32;
+  bool        reduce = true;
+  bool        star_mesh = false;
+};
+
+// Number of unknowns in the linear systems of all components, before and after the reduction.
+struct reduction_report {
+  std::size_t original_unknowns = 0;
+  std::size_t reduced_unknowns = 0;
+};
+
+// Edge with first < second, the EMF acts in the direction from first to second. Swapping the ends flips the EMF.
+// Networks keep their edges ordered by node names, and the reduction before nodal analysis orders the edges it makes
+// by local node indices. Only records read from a netlist keep the order they were written in.
+struct resistor_edge {
+  unsigned first;
+  unsigned second;
+  double   resistance;
+  double   emf;
+};
 
-  struct short_circuit_edge {
-    unsigned first;
-    unsigned second;
-    double   emf;
-  };
+// Potentials of nodes and currents of edges from first to second, indexed by their ids.
+struct circuit_solution {
+  std::vector<double> potentials;
+  std::vector<double> currents;
+};
+
+// Core representation of a network. Nodes get dense ids in the order they appear, so names are only looked up once on
+// insertion. Edges are kept in a flat list, and adjacency in compressed sparse row (CSR) form is built from it when
+// needed. With names it takes about 70 bytes per edge of a grid, against 200 for nested hash maps that keep every edge
+// twice. Every edge is kept with first < second by names, the EMF is flipped otherwise.
+class circuit_graph {
+public:
+  static constexpr auto npos = std::numeric_limits<std::size_t>::max();
 
-  std::vector<short_circuit_edge> m_short_circuits;
+private:
+  std::vector<unsigned>                  m_names;
+  std::unordered_map<unsigned, unsigned> m_ids;
+  std::vector<resistor_edge>             m_edges;
 
-  void insert_impl(unsigned first, unsigned second, double resistance, double emf, bool to_throw);
+  // Incident edges of node i are m_incident[m_incident_ptr[i]] ... m_incident[m_incident_ptr[i + 1] - 1], sorted by
+  // the other end. It's built lazily by the first lookup after an insertion, which isn't thread safe.
+  mutable std::vector<std::size_t> m_incident_ptr, m_incident;
 
 public:
+  circuit_graph() = default;
+  // Bulk construction from a netlist with the same checks as insertion of every edge in order.
+  explicit circuit_graph(std::span<const resistor_edge> edges);
+
+  // Returns the id of the new edge. Throws std::invalid_argument if the ends are the same. Parallel edges are only
+  // found when adjacency is built, then std::invalid_argument is thrown.
+  std::size_t insert(unsigned first, unsigned second, double resistance = 0, double emf = 0);
+
+  std::size_t nodes() const { return m_names.size(); }
+  std::size_t edges() const { return m_edges.size(); }
+  bool        empty() const { return m_edges.empty(); }
+
+  // Ends of edges are node ids. Lookups return npos if there is no such node or edge, find_edge takes ids of the ends
+  // and find_named_edge takes their names.
+  unsigned                     name(unsigned id) const { return m_names[id]; }
+  std::size_t                  id(unsigned name) const;
+  const resistor_edge         &edge(std::size_t id) const { return m_edges[id]; }
+  std::size_t                  find_edge(unsigned first, unsigned second) const;
+  std::size_t                  find_named_edge(unsigned first, unsigned second) const;
+  std::span<const std::size_t> incident(unsigned node) const;
+
+  // Builds adjacency if there were insertions since the last time. Throws std::invalid_argument on parallel edges.
+  void build_adjacency() const;
+
+  // Changes resistance and EMF of an edge, the EMF acts from its first end to the second one.
+  void update_edge(std::size_t id, double resistance, double emf);
+
+  // Disjoint set labels of connected components, one for every node.
+  std::vector<unsigned> component_labels() const;
+
+  // Components are solved concurrently, largest first. The base node of every component is the one with the smallest
+  // id. Sizes of the systems are added to the report if one is provided.
+  circuit_solution solve(const solver_options &options = {}, reduction_report *report = nullptr) const;
+};
+
+// Adapter over circuit_graph that works with node names and returns hash maps of potentials and currents.
+class connected_resistor_network {
+  circuit_graph m_graph;
+  // Edge ids by the names of their ends, smaller name in the high half. try_insert and update_edge look edges up here,
+  // so that they don't build adjacency of the whole graph after every insertion.
+  std::unordered_map<std::uint64_t, std::size_t> m_edge_ids;
+
+  // Symbolic analysis of the last system solved directly. Changing resistances and EMFs keeps the structure of the
+  // system, so the next solve skips ordering and analysis. That's also why solve() on the same network isn't thread
+  // safe.
+  mutable std::shared_ptr<const linmath::sparse_ldlt_symbolic> m_symbolic;
+
+public:
+  // Throws std::invalid_argument on loops and on edges that are already there.
   void insert(unsigned first, unsigned second, double resistance, double emf);
+  // Does nothing if the edge is already there.
   void try_insert(unsigned first, unsigned second, double resistance, double emf);
+  // Changes resistance and EMF of an existing edge. Throws std::invalid_argument if there is no such edge.
+  void update_edge(unsigned first, unsigned second, double resistance, double emf);
+
+  std::size_t          size() const { return m_graph.nodes(); }
+  const circuit_graph &graph() const { return m_graph; }
+
+  // The first node is the base one, which has zero potential.
+  std::vector<unsigned>      nodes() const;
+  std::vector<resistor_edge> edges() const;
 
   using solution_potentials = std::unordered_map<unsigned, double>;
   using solution_currents = std::unordered_map<unsigned, std::unordered_map<unsigned, double>>;
   using solution = std::pair<solution_potentials, solution_currents>;
 
-  solution solve() const;
+  // Sizes of the system are added to the report if one is provided.
+  solution solve(const solver_options &options = {}, reduction_report *report = nullptr) const;
 };
 
+// Adapter over circuit_graph with the map-based interface.
 class resistor_network {
 public:
   using resistance_emf_pair = std::pair<double, double>;
   using map_type = std::unordered_map<unsigned, std::unordered_map<unsigned, resistance_emf_pair>>;
 
 private:
-  std::unordered_map<unsigned, std::unordered_map<unsigned, resistance_emf_pair>> m_map;
+  circuit_graph m_graph;
+  // Names of the ends of every edge, smaller name in the high half, so that parallel edges are rejected on insertion.
+  std::unordered_set<std::uint64_t> m_edge_names;
 
 public:
   std::vector<connected_resistor_network> connected_components() const;
-  const map_type                         &graph() const { return m_map; }
+  map_type                                graph() const;
+  const circuit_graph                    &core() const { return m_graph; }
 
+  // Throws std::invalid_argument on loops and on edges that are already there.
   void insert(unsigned first, unsigned second, double resistance = 0, double emf = 0);
 
   using solution_potentials = std::unordered_map<unsigned, double>;
   using solution_currents = std::unordered_map<unsigned, std::unordered_map<unsigned, double>>;
   using solution = std::pair<solution_potentials, solution_currents>;
 
-  solution solve() const;
+  // Components are solved concurrently, largest first.
+  solution solve(const solver_options &options = {}, reduction_report *report = nullptr) const;
+};
+
+// Solution of a network that is kept up to date while resistances and EMFs of its edges change, for parameter sweeps.
+// Components are found and their systems are assembled and factored once. Changes of resistances are rank-one
+// updates of the matrix, which are applied to the solution with the Sherman-Morrison-Woodbury formula, so resolving
+// only takes a solve with the factorization that is already there. Components too large to factor are solved
+// iteratively starting from the previous solution.
+class solved_resistor_network {
+public:
+  using solution_potentials = resistor_network::solution_potentials;
+  using solution_currents = resistor_network::solution_currents;
+  using solution = resistor_network::solution;
+
+private:
+  struct component;
+
+  solver_options                                   m_options;
+  circuit_graph                                    m_graph;
+  std::vector<component>                           m_components;
+  std::vector<std::pair<std::size_t, std::size_t>> m_edge_places; // Component and index in it of every edge.
+  solution                                         m_solution;
+
+public:
+  explicit solved_resistor_network(const resistor_network &network, const solver_options &options = {});
+  solved_resistor_network(solved_resistor_network &&) noexcept;
+  solved_resistor_network &operator=(solved_resistor_network &&) noexcept;
+  ~solved_resistor_network();
+
+  // Changes resistance and EMF of an existing edge, the solution is updated by the next resolve(). Throws
+  // std::invalid_argument if there is no such edge.
+  void update_edge(unsigned first, unsigned second, double resistance, double emf);
+
+  // Brings the solution up to date and returns only potentials and currents that have changed.
+  solution        resolve();
+  const solution &current() const { return m_solution; }
 };
 
 } // namespace circuits
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "netlist.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NETLIST_MMAP 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace circuits::netlist {
+
+static_assert(sizeof(resistor_edge) == 24 && std::is_trivially_copyable_v<resistor_edge>,
+              "Binary netlists store resistor_edge as is");
+
+namespace {
+
+bool is_space(char c) { return (c == ' ' || c == '\t' || c == '\n' || c == '\r'); }
+
+#if defined(__AVX2__)
+constexpr std::ptrdiff_t vector_size = 32;
+
+// Bit i is set if pos[i] is whitespace.
+std::uint32_t space_mask(const char *pos) {
+  const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos));
+  const auto blank = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+                                     _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t')));
+  const auto newline = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+                                       _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')));
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(blank, newline)));
+}
+#elif defined(__SSE2__)
+constexpr std::ptrdiff_t vector_size = 16;
+
+std::uint32_t space_mask(const char *pos) {
+  const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+  const auto blank = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+  const auto newline =
+      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')));
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_or_si128(blank, newline))) | 0xffff0000u;
+}
+#endif
+
+// Most gaps between tokens are a single space or a line break, so the first two characters are checked one by one.
+// Longer runs, like indentation and aligned columns, are skipped a vector at a time.
+const char *skip_spaces(const char *pos, const char *end) {
+  if (pos == end || !is_space(*pos)) return pos;
+  if (++pos == end || !is_space(*pos)) return pos;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; end - pos >= vector_size; pos += vector_size) {
+    const auto mask = ~space_mask(pos);
+    if (mask) return pos + std::countr_zero(mask);
+  }
+#endif
+
+  while (pos != end && is_space(*pos)) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Recursive descent over records, numbers are converted with std::from_chars. On failure the position of the error and
+// what was expected there are kept.
+class record_parser {
+  const char *m_pos, *m_end;
+  const char *m_expected = nullptr;
+
+  bool literal(char c) {
+    m_pos = skip_spaces(m_pos, m_end);
+    if (m_pos == m_end || *m_pos != c) return false;
+    ++m_pos;
+    return true;
+  }
+
+  template <typename T> bool number(T &value) {
+    m_pos = skip_spaces(m_pos, m_end);
+    // std::from_chars doesn't take an explicit plus sign.
+    auto start = m_pos;
+    if constexpr (std::is_floating_point_v<T>) {
+      if (start != m_end && *start == '+') ++start;
+    }
+
+    auto [ptr, ec] = std::from_chars(start, m_end, value);
+    if (ec != std::errc{}) return false;
+    m_pos = ptr;
+    return true;
+  }
+
+  bool fail(const char *expected) {
+    m_expected = expected;
+    return false;
+  }
+
+  bool record(resistor_edge &edge) {
+    if (!number(edge.first)) return fail("node");
+    if (!literal('-') || !literal('-')) return fail("'--'");
+    if (!number(edge.second)) return fail("node");
+    if (!literal(',')) return fail("','");
+    if (!number(edge.resistance)) return fail("resistance");
+    if (!literal(';')) return fail("';'");
+
+    // A number after the semicolon is an EMF only if 'V' follows, otherwise it's the next record.
+    const auto before = m_pos;
+    edge.emf = 0;
+    if (!number(edge.emf) || !literal('V')) {
+      edge.emf = 0;
+      m_pos = before;
+      return true;
+    }
+
+    const auto after = m_pos;
+    if (!literal(';')) m_pos = after;
+    return true;
+  }
+
+public:
+  record_parser(const char *begin, const char *end) : m_pos{begin}, m_end{end} {}
+
+  const char *position() const { return m_pos; }
+  const char *expected() const { return m_expected; }
+
+  bool parse(std::vector<resistor_edge> &edges) {
+    while ((m_pos = skip_spaces(m_pos, m_end)) != m_end) {
+      resistor_edge edge;
+      if (!record(edge)) return false;
+      edges.push_back(edge);
+    }
+    return true;
+  }
+};
+
+// Records take at least 10 characters, like "1 -- 2, 3;".
+constexpr std::size_t min_record_size = 10;
+
+std::vector<resistor_edge> parse_chunk(std::string_view text, std::size_t first, std::size_t last) {
+  std::vector<resistor_edge> edges;
+  edges.reserve((last - first) / (2 * min_record_size));
+
+  record_parser parser{text.data() + first, text.data() + last};
+  if (parser.parse(edges)) return edges;
+
+  const auto line = 1 + std::count(text.data(), parser.position(), '\n');
+  throw std::runtime_error{"Netlist parsing error at line " + std::to_string(line) + ": expected " +
+                           parser.expected()};
+}
+
+// Start of the first line after pos that begins with "a --". Nothing else in a record is a number followed by dashes,
+// so chunks are cut between records.
+std::size_t next_record(std::string_view text, std::size_t pos) {
+  while (pos < text.size()) {
+    const auto *newline = static_cast<const char *>(std::memchr(text.data() + pos, '\n', text.size() - pos));
+    if (!newline) return text.size();
+    pos = newline - text.data() + 1;
+
+    const auto *end = text.data() + text.size();
+    const auto *start = skip_spaces(text.data() + pos, end);
+    unsigned    node;
+    auto [ptr, ec] = std::from_chars(start, end, node);
+    if (ec != std::errc{}) continue;
+
+    ptr = skip_spaces(ptr, end);
+    if (ptr == end || *ptr != '-') continue;
+    ptr = skip_spaces(ptr + 1, end);
+    if (ptr != end && *ptr == '-') return start - text.data();
+  }
+  return text.size();
+}
+
+std::vector<resistor_edge> from_binary(std::string_view data) {
+  constexpr auto header_size = binary_magic.size() + sizeof(std::uint64_t);
+
+  std::uint64_t count = 0;
+  if (data.size() >= header_size) std::memcpy(&count, data.data() + binary_magic.size(), sizeof(count));
+  if (data.size() < header_size || (data.size() - header_size) / sizeof(resistor_edge) != count ||
+      (data.size() - header_size) % sizeof(resistor_edge)) {
+    throw std::runtime_error{"Binary netlist is truncated"};
+  }
+
+  std::vector<resistor_edge> edges(count);
+  std::memcpy(edges.data(), data.data() + header_size, count * sizeof(resistor_edge));
+  return edges;
+}
+
+std::vector<resistor_edge> from_contents(std::string_view data) {
+  return (data.starts_with(binary_magic) ? from_binary(data) : parse(data));
+}
+
+#ifdef NETLIST_MMAP
+// Regular files are mapped into memory, anything else (pipes, terminals) is read into a buffer.
+class mapped_file {
+  void       *m_map = MAP_FAILED;
+  std::size_t m_size = 0;
+  std::string m_buffer;
+
+public:
+  explicit mapped_file(int descriptor) {
+    struct stat info;
+    if (::fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+      m_size = info.st_size;
+      m_map = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+      if (m_map != MAP_FAILED) {
+        ::madvise(m_map, m_size, MADV_SEQUENTIAL);
+        return;
+      }
+    }
+
+    char buffer[1 << 16];
+    for (ssize_t count; (count = ::read(descriptor, buffer, sizeof(buffer))) != 0;) {
+      if (count < 0) throw std::runtime_error{"Can't read the netlist"};
+      m_buffer.append(buffer, count);
+    }
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() {
+    if (m_map != MAP_FAILED) ::munmap(m_map, m_size);
+  }
+
+  std::string_view contents() const {
+    if (m_map != MAP_FAILED) return {static_cast<const char *>(m_map), m_size};
+    return m_buffer;
+  }
+};
+
+// Closes the descriptor exactly once, however loading ends.
+class descriptor_guard {
+  int m_descriptor;
+
+public:
+  explicit descriptor_guard(int descriptor) : m_descriptor{descriptor} {}
+
+  descriptor_guard(const descriptor_guard &) = delete;
+  descriptor_guard &operator=(const descriptor_guard &) = delete;
+
+  ~descriptor_guard() { ::close(m_descriptor); }
+};
+#endif
+
+} // namespace
+
+std::vector<resistor_edge> parse(std::string_view text) {
+  auto &pool = throttle::utility::default_thread_pool();
+  if (text.size() <= parallel_threshold) return parse_chunk(text, 0, text.size());
+
+  const std::size_t        chunks = 4 * pool.concurrency();
+  std::vector<std::size_t> bounds{0};
+  for (std::size_t i = 1; i < chunks; ++i) {
+    bounds.push_back(next_record(text, std::max(bounds.back(), i * text.size() / chunks)));
+  }
+  bounds.push_back(text.size());
+
+  std::vector<std::vector<resistor_edge>> parts(chunks);
+  std::vector<std::exception_ptr>         errors(chunks);
+  pool.parallel_for(chunks, [&](std::size_t i) {
+    try {
+      parts[i] = parse_chunk(text, bounds[i], bounds[i + 1]);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < chunks; ++i) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    total += parts[i].size();
+  }
+
+  std::vector<resistor_edge> edges;
+  edges.reserve(total);
+  for (const auto &part : parts) {
+    edges.insert(edges.end(), part.begin(), part.end());
+  }
+  return edges;
+}
+
+#ifdef NETLIST_MMAP
+std::vector<resistor_edge> load(const std::string &path) {
+  const auto descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) throw std::runtime_error{"Can't open " + path};
+
+  const descriptor_guard guard{descriptor};
+  const auto             file = mapped_file{descriptor};
+  return from_contents(file.contents());
+}
+
+std::vector<resistor_edge> load(int descriptor) {
+  const auto file = mapped_file{descriptor};
+  return from_contents(file.contents());
+}
+#else
+std::vector<resistor_edge> load(const std::string &path) {
+  std::ifstream is{path, std::ios::binary};
+  if (!is) throw std::runtime_error{"Can't open " + path};
+  std::string contents{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+  return from_contents(contents);
+}
+
+std::vector<resistor_edge> load(int) { throw std::runtime_error{"Loading from a descriptor needs POSIX"}; }
+#endif
+
+void save_binary(const std::string &path, std::span<const resistor_edge> edges) {
+  std::ofstream os{path, std::ios::binary};
+  const auto    count = static_cast<std::uint64_t>(edges.size());
+  os.write(binary_magic.data(), binary_magic.size());
+  os.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  os.write(reinterpret_cast<const char *>(edges.data()), edges.size_bytes());
+  if (!os) throw std::runtime_error{"Can't write " + path};
+}
+
+} // namespace circuits::netlist
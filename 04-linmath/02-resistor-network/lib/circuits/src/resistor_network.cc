@@ -1,159 +1,553 @@
 #include "resistor_network.hpp"
 
-#include "contiguous_matrix.hpp"
-#include "disjoint_set_forest.hpp"
+#include "concurrent_disjoint_set_forest.hpp"
 #include "equal.hpp"
 #include "linear_solver.hpp"
 #include "matrix.hpp"
+#include "sparse_ldlt.hpp"
+#include "sparse_matrix.hpp"
+#include "thread_pool.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 
 #include <iterator>
-#include <utility>
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/functional/hash.hpp>
 
 namespace circuits {
 
-void connected_resistor_network::insert_impl(unsigned first, unsigned second, double resistance, double emf,
-                                             bool to_throw) {
-  if (first == second) throw std::invalid_argument("Circuit graph can't have loops");
+namespace {
 
-  auto found = m_map.find(first);
-  if (found != m_map.end() && found->second.find(second) != found->second.end()) {
-    if (to_throw) throw std::invalid_argument("Edge is already present in the graph");
-    return;
+using symbolic_ptr = std::shared_ptr<const linmath::sparse_ldlt_symbolic>;
+
+constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+bool is_short_circuit(const resistor_edge &edge) { return throttle::is_roughly_equal(edge.resistance, 0.0); }
+
+// Numbering of the unknowns of a connected component: potentials of all nodes except the base one, then currents
+// through short circuits.
+struct mna_layout {
+  struct edge_unknowns {
+    std::size_t first, second; // Potentials of the ends, npos for the base node.
+    std::size_t current;       // Current through a short circuit, npos for other edges.
+  };
+
+  std::vector<std::size_t>   rows; // Potential of every node, npos for the base one.
+  std::vector<edge_unknowns> edges;
+  std::size_t                size = 0, short_circuits = 0;
+
+  mna_layout() = default;
+  mna_layout(const std::vector<unsigned> &nodes, const std::vector<resistor_edge> &edges) : rows(nodes.size()) {
+    // Nodes are ids within a component, so rows are found by a lookup in a vector.
+    std::vector<std::size_t> row_of(nodes.empty() ? 0 : *std::max_element(nodes.begin(), nodes.end()) + 1);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      rows[i] = (i == 0 ? npos : i - 1);
+      row_of[nodes[i]] = rows[i];
+    }
+
+    size = nodes.size() - 1;
+    this->edges.reserve(edges.size());
+    for (const auto &edge : edges) {
+      const bool short_circuit = is_short_circuit(edge);
+      this->edges.push_back({row_of[edge.first], row_of[edge.second], (short_circuit ? size++ : npos)});
+      short_circuits += short_circuit;
+    }
   }
 
-  if (first > second) {
-    std::swap(first, second);
-    emf = -emf;
+  double potential(std::size_t row, const std::vector<double> &unknowns) const {
+    return (row == npos ? 0.0 : unknowns[row]);
+  }
+
+  // Current from first to second.
+  double current(std::size_t index, const resistor_edge &edge, const std::vector<double> &unknowns) const {
+    const auto &ends = edges[index];
+    if (ends.current != npos) return unknowns[ends.current];
+    return (potential(ends.first, unknowns) - potential(ends.second, unknowns) + edge.emf) / edge.resistance;
   }
+};
+
+// Modified nodal analysis: a Kirchhoff's current law equation for every node except the base one, and a voltage
+// equation with an unknown current for every short circuit. Every row only has elements for adjacent nodes.
+std::pair<linmath::sparse_matrix_d, std::vector<double>> assemble(const mna_layout                &layout,
+                                                                  const std::vector<resistor_edge> &edges) {
+  linmath::sparse_matrix_d::builder builder{layout.size, layout.size};
+  std::vector<double>               rhs(layout.size);
+  builder.reserve(4 * edges.size());
 
-  m_map[first].insert({second, std::make_pair(resistance, emf)});
-  m_map[second].insert({first, std::make_pair(resistance, -emf)});
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    const auto &edge = edges[i];
+    const auto [first, second, current] = layout.edges[i];
 
-  if (throttle::is_roughly_equal(resistance, 0.0)) m_short_circuits.push_back({first, second, emf});
+    if (current != npos) {
+      if (first != npos) {
+        builder.add(first, current, 1.0);
+        builder.add(current, first, 1.0);
+      }
+      if (second != npos) {
+        builder.add(second, current, -1.0);
+        builder.add(current, second, -1.0);
+      }
+      rhs[current] = -edge.emf;
+      continue;
+    }
+
+    const auto conductance = 1.0 / edge.resistance;
+    if (first != npos) {
+      builder.add(first, first, conductance);
+      rhs[first] -= edge.emf * conductance;
+    }
+    if (second != npos) {
+      builder.add(second, second, conductance);
+      rhs[second] += edge.emf * conductance;
+    }
+    if (first != npos && second != npos) {
+      builder.add(first, second, -conductance);
+      builder.add(second, first, -conductance);
+    }
+  }
+
+  return std::make_pair(builder.build(), std::move(rhs));
 }
 
-void connected_resistor_network::insert(unsigned first, unsigned second, double resistance, double emf) {
-  insert_impl(first, second, resistance, emf, true);
+// The solution is in the original numbering, but only if iterations have converged.
+linmath::iterative_result<double> solve_iteratively(const linmath::sparse_matrix_d &system,
+                                                    const std::vector<double> &rhs, bool positive_definite,
+                                                    const solver_options      &options,
+                                                    const std::vector<double> &initial = {}) {
+  // Nodes come in hash map order. Renumbering them with RCM makes the incomplete Cholesky factor better and memory
+  // accesses of matrix-vector products local.
+  const auto order = linmath::reverse_cuthill_mckee(system);
+  const auto permuted = system.permuted(order);
+
+  std::vector<double> permuted_rhs(rhs.size()), permuted_initial(initial.size());
+  for (std::size_t i = 0; i < rhs.size(); ++i) {
+    permuted_rhs[i] = rhs[order[i]];
+    if (!initial.empty()) permuted_initial[i] = initial[order[i]];
+  }
+
+  const auto settings = linmath::iterative_settings<double>{options.tolerance, options.max_iterations};
+  const auto jacobi = linmath::jacobi_preconditioner<double>{permuted};
+
+  linmath::iterative_result<double> result;
+  if (positive_definite) {
+    try {
+      const auto cholesky = linmath::incomplete_cholesky_preconditioner<double>{permuted};
+      result = linmath::conjugate_gradient(permuted, permuted_rhs, cholesky, settings, permuted_initial);
+    } catch (std::runtime_error &) {
+      result = linmath::conjugate_gradient(permuted, permuted_rhs, jacobi, settings, permuted_initial);
+    }
+  } else {
+    result = linmath::bicgstab(permuted, permuted_rhs, jacobi, settings, permuted_initial);
+    if (!result.converged) result = linmath::gmres(permuted, permuted_rhs, jacobi, settings, permuted_initial);
+  }
+
+  if (!result.converged) return result;
+
+  std::vector<double> solution(rhs.size());
+  for (std::size_t i = 0; i < rhs.size(); ++i) {
+    solution[order[i]] = result.solution[i];
+  }
+  result.solution = std::move(solution);
+  return result;
 }
 
-void connected_resistor_network::try_insert(unsigned first, unsigned second, double resistance, double emf) {
-  insert_impl(first, second, resistance, emf, false);
+bool fits_factor(const linmath::sparse_matrix_d &system, const solver_options &options, symbolic_ptr &symbolic) {
+  // The analysis is reused while the structure of the system stays the same, only values are factored again.
+  if (!symbolic || !symbolic->matches(system)) symbolic = std::make_shared<const linmath::sparse_ldlt_symbolic>(system);
+  return (symbolic->factor_size() <= options.max_factor_size);
 }
 
-connected_resistor_network::solution connected_resistor_network::solve() const {
-  if (m_map.empty()) throw std::invalid_argument{"Network can't be empty"};
+std::vector<double> solve_system(const linmath::sparse_matrix_d &system, const std::vector<double> &rhs,
+                                 bool positive_definite, const solver_options &options, symbolic_ptr &symbolic) {
+  if (!fits_factor(system, options, symbolic)) {
+    auto result = solve_iteratively(system, rhs, positive_definite, options);
+    if (result.converged) return std::move(result.solution);
+  }
+
+  return linmath::sparse_ldlt<double>{system, symbolic}.solve(rhs);
+}
+
+// Simplification of a connected component before nodal analysis. Nodes are local indices, node 0 is the base one and
+// is never eliminated. Steps are recorded, and currents and potentials of eliminated elements are found from the
+// solution of the reduced network by undoing them in reverse order:
+// - A dangling node has a single edge, which carries no current. Cutting it off may leave its neighbour dangling.
+// - Edges of a node of degree 2 are joined in series. Both carry the current of the joined edge.
+// - Parallel edges are joined into one. Resistors get their currents from potentials of the ends, a short circuit
+//   gets the rest. Two short circuits are never joined, the system is singular with them anyway.
+// - Star-mesh replaces a node with three resistors by a triangle between its neighbours, with conductances
+//   g_i * g_j / G and EMFs s_i - s_j. Its potential is the mean of phi_i + s_i weighted with g_i.
+// Every step removes a node or an edge, so the whole reduction takes linear time.
+class network_reduction {
+  struct step {
+    enum { dangling, series, parallel, star } kind;
+    std::size_t                node;   // Eliminated node, unused for parallel edges.
+    std::array<std::size_t, 3> edges;  // Replaced edges.
+    std::size_t                result; // Edge that replaces them, unused for dangling nodes and stars.
+  };
+
+  using node_pair = std::pair<unsigned, unsigned>;
 
-  // Maps indexes 0, 1, .... to corrensponding iterators in the unordered map that represents the input.
-  std::unordered_map<unsigned, decltype(m_map)::const_iterator> iterator_map;
-  // Maps indexes from input to 0, 1, ....
-  std::unordered_map<unsigned, unsigned> index_map;
-  // Maps pairs of input indexes to current variable
-  std::unordered_map<std::pair<unsigned, unsigned>, unsigned, boost::hash<std::pair<unsigned, unsigned>>>
-      short_circuit_current_map;
+  std::vector<resistor_edge>                                        m_edges; // Original edges come first.
+  std::vector<bool>                                                 m_edge_alive, m_node_alive;
+  std::vector<std::vector<std::size_t>>                             m_incident; // Dead edges are removed lazily.
+  std::vector<std::size_t>                                          m_degree;
+  std::unordered_map<node_pair, std::size_t, boost::hash<node_pair>> m_between; // Edge that others are joined to.
+  std::vector<step>                                                 m_steps;
+  std::vector<unsigned>                                             m_queue;
 
-  unsigned j = 0;
-  for (auto start = std::next(m_map.begin()), end = m_map.end(); start != end; ++start, ++j) {
-    iterator_map[j] = start;
-    index_map[start->first] = j;
+  static node_pair key_of(const resistor_edge &edge) {
+    return {std::min(edge.first, edge.second), std::max(edge.first, edge.second)};
   }
 
-  const auto size = iterator_map.size();
-  const auto num_short_circuits = m_short_circuits.size();
+  // EMF and current in the direction from the node to the other end.
+  static double emf_from(const resistor_edge &edge, unsigned node) {
+    return (edge.first == node ? edge.emf : -edge.emf);
+  }
 
-  for (j = size; const auto &v : m_short_circuits) {
-    short_circuit_current_map.insert({{v.first, v.second}, j});
-    ++j;
+  static double current_from(const resistor_edge &edge, unsigned node, double current) {
+    return (edge.first == node ? current : -current);
   }
 
-  const auto make_extended_system = [&]() {
-    const auto sz = size + num_short_circuits;
+  static unsigned other_end(const resistor_edge &edge, unsigned node) {
+    return (edge.first == node ? edge.second : edge.first);
+  }
 
-    linmath::contiguous_matrix_d extended_matrix{sz, sz + 1};
+  static double current_of(const resistor_edge &edge, const std::vector<double> &potentials) {
+    return (potentials[edge.first] - potentials[edge.second] + edge.emf) / edge.resistance;
+  }
 
-    for (const auto &v : iterator_map) {
-      const auto &[index, map_iter] = v;
-      auto row = extended_matrix[index];
+  std::size_t push_edge(const resistor_edge &edge) {
+    m_edges.push_back(edge);
+    m_edge_alive.push_back(true);
+    m_incident[edge.first].push_back(m_edges.size() - 1);
+    m_incident[edge.second].push_back(m_edges.size() - 1);
+    ++m_degree[edge.first];
+    ++m_degree[edge.second];
+    return m_edges.size() - 1;
+  }
 
-      for (const auto &a : map_iter->second) {
-        auto [res, emf] = a.second;
+  void kill_edge(std::size_t index) {
+    m_edge_alive[index] = false;
+    --m_degree[m_edges[index].first];
+    --m_degree[m_edges[index].second];
+  }
 
-        if (throttle::is_roughly_equal(res, 0.0)) {
-          const auto initial_index = iterator_map.at(index)->first;
-          const auto current_var =
-              short_circuit_current_map.at((initial_index > a.first) ? std::make_pair(a.first, initial_index)
-                                                                     : std::make_pair(initial_index, a.first));
-          row[current_var] += (initial_index > a.first ? -1.0 : 1.0);
-          continue;
-        }
+  // New edges are kept with first < second like the edges of a network, the EMF is flipped when the ends are swapped.
+  void add_edge(resistor_edge edge) {
+    if (edge.first > edge.second) {
+      std::swap(edge.first, edge.second);
+      edge.emf = -edge.emf;
+    }
 
-        row[index] += 1.0 / res;
-        if (a.first != m_map.begin()->first) {
-          auto corrensponding_index = index_map.at(a.first);
-          row[corrensponding_index] -= 1.0 / res;
-        }
+    const auto id = push_edge(edge);
+    const auto key = key_of(edge);
 
-        row[size + num_short_circuits] -= emf / res;
-      }
+    auto [found, inserted] = m_between.try_emplace(key, id);
+    if (inserted) return;
+
+    const auto other = found->second;
+    if (!m_edge_alive[other]) {
+      found->second = id;
+      return;
     }
 
-    for (unsigned i = size; const auto &v : m_short_circuits) {
-      auto row = extended_matrix[i++];
+    const auto &a = m_edges[other], &b = m_edges[id];
+    if (is_short_circuit(a) && is_short_circuit(b)) return;
 
-      if (v.first != m_map.begin()->first) {
-        auto first = index_map.at(v.first);
-        row[first] = 1.0;
+    // Both are turned into Norton equivalents and summed up, unless one of them is a short circuit.
+    resistor_edge joined;
+    if (is_short_circuit(a) || is_short_circuit(b)) {
+      const auto &short_circuit = (is_short_circuit(a) ? a : b);
+      joined = {key.first, key.second, short_circuit.resistance, emf_from(short_circuit, key.first)};
+    } else {
+      const auto conductance = 1.0 / a.resistance + 1.0 / b.resistance;
+      const auto source = emf_from(a, key.first) / a.resistance + emf_from(b, key.first) / b.resistance;
+      joined = {key.first, key.second, 1.0 / conductance, source / conductance};
+    }
+
+    kill_edge(other);
+    kill_edge(id);
+    found->second = push_edge(joined);
+    m_steps.push_back({step::parallel, npos, {other, id, npos}, found->second});
+    m_queue.push_back(key.first);
+    m_queue.push_back(key.second);
+  }
+
+  void eliminate(unsigned node, bool star_mesh) {
+    // Lists of nodes with high degree are only compacted once they go down to 3, so it's linear in total.
+    if (m_degree[node] > 3) return;
+    std::erase_if(m_incident[node], [this](std::size_t index) { return !m_edge_alive[index]; });
+    const auto edges = m_incident[node];
+
+    if (edges.size() == 1) {
+      m_steps.push_back({step::dangling, node, {edges[0], npos, npos}, npos});
+      kill_edge(edges[0]);
+      m_queue.push_back(other_end(m_edges[edges[0]], node));
+    } else if (edges.size() == 2) {
+      const auto first = m_edges[edges[0]], second = m_edges[edges[1]];
+      const auto a = other_end(first, node), b = other_end(second, node);
+      if (a == b) return;
+
+      const auto resistance =
+          (is_short_circuit(first) && is_short_circuit(second) ? 0.0 : first.resistance + second.resistance);
+      m_steps.push_back({step::series, node, {edges[0], edges[1], npos}, m_edges.size()});
+      kill_edge(edges[0]);
+      kill_edge(edges[1]);
+      add_edge({a, b, resistance, emf_from(first, a) + emf_from(second, node)});
+      m_queue.push_back(a);
+      m_queue.push_back(b);
+    } else if (edges.size() == 3 && star_mesh) {
+      std::array<resistor_edge, 3> star;
+      std::array<unsigned, 3>      ends;
+      for (std::size_t i = 0; i < 3; ++i) {
+        star[i] = m_edges[edges[i]];
+        ends[i] = other_end(star[i], node);
+        if (is_short_circuit(star[i])) return;
       }
+      if (ends[0] == ends[1] || ends[1] == ends[2] || ends[0] == ends[2]) return;
 
-      if (v.second != m_map.begin()->first) {
-        auto second = index_map.at(v.second);
-        row[second] = -1.0;
+      const auto total = 1 / star[0].resistance + 1 / star[1].resistance + 1 / star[2].resistance;
+      m_steps.push_back({step::star, node, {edges[0], edges[1], edges[2]}, npos});
+      for (auto index : edges) {
+        kill_edge(index);
       }
 
-      row[size + num_short_circuits] = -v.emf;
+      for (std::size_t i = 0; i < 3; ++i) {
+        const auto j = (i + 1) % 3;
+        add_edge({ends[i], ends[j], star[i].resistance * star[j].resistance * total,
+                  emf_from(star[i], ends[i]) - emf_from(star[j], ends[j])});
+        m_queue.push_back(ends[i]);
+      }
+    } else {
+      return;
     }
 
-    return extended_matrix;
-  };
+    m_node_alive[node] = false;
+  }
 
-  auto extended_matrix = make_extended_system();
-  // Solve the linear system of equations to find unkown potentials and currents.
-  auto unknowns = linmath::nonsingular_solver(linmath::matrix_d{std::move(extended_matrix)});
+  void reduce(bool star_mesh) {
+    for (unsigned i = 1; i < m_node_alive.size(); ++i) {
+      if (m_node_alive[i]) m_queue.push_back(i);
+    }
 
-  auto result_potentials = solution_potentials{};
-  // Fill base node potential with zero.
-  result_potentials[m_map.begin()->first] = 0.0;
-  for (unsigned i = 0; i < size; ++i) {
-    result_potentials[iterator_map[i]->first] = unknowns[i][0];
+    while (!m_queue.empty()) {
+      const auto node = m_queue.back();
+      m_queue.pop_back();
+      if (node != 0 && m_node_alive[node]) eliminate(node, star_mesh);
+    }
   }
 
-  // Fill unkown currents that were found as a part of linear system of equations.
-  auto result_currents = solution_currents{};
-  for (const auto &v : short_circuit_current_map) {
-    result_currents[v.first.first][v.first.second] = unknowns[v.second][0];
-    result_currents[v.first.second][v.first.first] = -unknowns[v.second][0];
+public:
+  network_reduction(std::size_t nodes, const std::vector<resistor_edge> &edges, const solver_options &options)
+      : m_node_alive(nodes, true), m_incident(nodes), m_degree(nodes) {
+    for (const auto &edge : edges) {
+      m_between.insert({key_of(edge), push_edge(edge)});
+    }
+
+    if (!options.reduce) return;
+    // Stars go after everything else, otherwise their triangles could stop chains from being joined in series.
+    reduce(false);
+    if (options.star_mesh) reduce(true);
   }
 
-  // Compute other currents from potentials, when there are no short-circuits.
-  for (const auto &v : m_map) {
-    for (const auto &c : v.second) {
-      if (throttle::is_roughly_equal(c.second.first, 0.0)) continue;
-      result_currents[v.first][c.first] =
-          (result_potentials[v.first] - result_potentials[c.first] + c.second.second) / c.second.first;
+  std::size_t          edge_count() const { return m_edges.size(); }
+  const resistor_edge &edge(std::size_t index) const { return m_edges[index]; }
+
+  // Nodes and edges that are left, the base node is first.
+  std::vector<unsigned> nodes() const {
+    std::vector<unsigned> res;
+    for (unsigned i = 0; i < m_node_alive.size(); ++i) {
+      if (m_node_alive[i]) res.push_back(i);
     }
+    return res;
   }
 
-  return {result_potentials, result_currents};
+  std::vector<std::size_t> edges() const {
+    std::vector<std::size_t> res;
+    for (std::size_t i = 0; i < m_edges.size(); ++i) {
+      if (m_edge_alive[i]) res.push_back(i);
+    }
+    return res;
+  }
+
+  // Potentials of nodes and currents of edges that are left have to be filled in, the rest are found.
+  void reconstruct(std::vector<double> &potentials, std::vector<double> &currents) const {
+    for (auto it = m_steps.rbegin(); it != m_steps.rend(); ++it) {
+      const auto &[kind, node, edges, result] = *it;
+
+      switch (kind) {
+      case step::dangling: {
+        const auto &edge = m_edges[edges[0]];
+        const auto  other = other_end(edge, node);
+        potentials[node] = potentials[other] + emf_from(edge, other);
+        currents[edges[0]] = 0;
+        break;
+      }
+
+      case step::series: {
+        const auto &first = m_edges[edges[0]], &second = m_edges[edges[1]], &joined = m_edges[result];
+        const auto  a = other_end(first, node);
+        const auto  current = current_from(joined, a, currents[result]); // From a through the node to the other end.
+        currents[edges[0]] = current_from(first, a, current);
+        currents[edges[1]] = current_from(second, node, current);
+        potentials[node] = potentials[a] + emf_from(first, a) - current * first.resistance;
+        break;
+      }
+
+      case step::parallel: {
+        const auto &joined = m_edges[result];
+        for (std::size_t i = 0; i < 2; ++i) {
+          const auto &edge = m_edges[edges[i]], &other = m_edges[edges[1 - i]];
+          if (!is_short_circuit(edge)) {
+            currents[edges[i]] = current_of(edge, potentials);
+          } else {
+            const auto rest = currents[result] - current_from(other, joined.first, current_of(other, potentials));
+            currents[edges[i]] = current_from(edge, joined.first, rest);
+          }
+        }
+        break;
+      }
+
+      case step::star: {
+        double total = 0, weighted = 0;
+        for (auto index : edges) {
+          const auto &edge = m_edges[index];
+          const auto  other = other_end(edge, node);
+          total += 1 / edge.resistance;
+          weighted += (potentials[other] + emf_from(edge, other)) / edge.resistance;
+        }
+        potentials[node] = weighted / total;
+        for (auto index : edges) {
+          currents[index] = current_of(m_edges[index], potentials);
+        }
+        break;
+      }
+      }
+    }
+  }
+};
+
+// Components are solved on their own pool, because their solves run parallel_for of the default one, which can't be
+// nested.
+throttle::utility::thread_pool &component_pool() {
+  static throttle::utility::thread_pool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+  return pool;
 }
 
-void resistor_network::insert(unsigned first, unsigned second, double resistance, double emf) {
+// Potentials of nodes and currents of edges of a connected component. Nodes are ids within the component, node 0 is
+// the base one.
+circuit_solution solve_component(std::size_t nodes, const std::vector<resistor_edge> &edges,
+                                 const solver_options &options, symbolic_ptr &symbolic, reduction_report &report) {
+  const auto reduction = network_reduction{nodes, edges, options};
+  const auto reduced_nodes = reduction.nodes();
+  const auto reduced_indices = reduction.edges();
+
+  std::vector<resistor_edge> reduced_edges;
+  reduced_edges.reserve(reduced_indices.size());
+  for (auto index : reduced_indices) {
+    reduced_edges.push_back(reduction.edge(index));
+  }
+
+  const auto layout = mna_layout{reduced_nodes, reduced_edges};
+  report.original_unknowns += nodes - 1 + std::count_if(edges.begin(), edges.end(), is_short_circuit);
+  report.reduced_unknowns += layout.size;
+
+  // Solve the linear system of equations to find unkown potentials and currents. A tree is reduced to the base node.
+  std::vector<double> unknowns;
+  if (layout.size) {
+    auto [system, rhs] = assemble(layout, reduced_edges);
+    unknowns = solve_system(system, rhs, (layout.short_circuits == 0), options, symbolic);
+  }
+
+  circuit_solution result{std::vector<double>(nodes), std::vector<double>(reduction.edge_count())};
+  for (std::size_t i = 0; i < reduced_nodes.size(); ++i) {
+    result.potentials[reduced_nodes[i]] = layout.potential(layout.rows[i], unknowns);
+  }
+  for (std::size_t i = 0; i < reduced_edges.size(); ++i) {
+    result.currents[reduced_indices[i]] = layout.current(i, reduced_edges[i], unknowns);
+  }
+
+  reduction.reconstruct(result.potentials, result.currents);
+  result.currents.resize(edges.size());
+  return result;
+}
+
+// Nodes and edges of every connected component in increasing order of ids, component i has nodes[node_ptr[i]] ...
+// nodes[node_ptr[i + 1] - 1] and the same for edges.
+struct component_lists {
+  std::vector<std::size_t> node_ptr, edge_ptr;
+  std::vector<unsigned>    nodes;
+  std::vector<std::size_t> edges;
+  std::vector<unsigned>    local; // Index of every node in its component.
+
+  explicit component_lists(const circuit_graph &graph) : node_ptr{0}, edge_ptr{0}, local(graph.nodes()) {
+    const auto labels = graph.component_labels();
+
+    // Roots of the disjoint sets are numbered in order, then both lists are filled with counting sort.
+    std::vector<std::size_t> number(graph.nodes(), npos);
+    for (unsigned i = 0; i < graph.nodes(); ++i) {
+      if (labels[i] != i) continue;
+      number[i] = node_ptr.size() - 1;
+      node_ptr.push_back(0);
+      edge_ptr.push_back(0);
+    }
+
+    for (unsigned i = 0; i < graph.nodes(); ++i) {
+      local[i] = node_ptr[number[labels[i]] + 1]++;
+    }
+    for (std::size_t i = 0; i < graph.edges(); ++i) {
+      ++edge_ptr[number[labels[graph.edge(i).first]] + 1];
+    }
+    for (std::size_t i = 0; i + 1 < node_ptr.size(); ++i) {
+      node_ptr[i + 1] += node_ptr[i];
+      edge_ptr[i + 1] += edge_ptr[i];
+    }
+
+    nodes.resize(graph.nodes());
+    edges.resize(graph.edges());
+    for (unsigned i = 0; i < graph.nodes(); ++i) {
+      nodes[node_ptr[number[labels[i]]] + local[i]] = i;
+    }
+    auto next = edge_ptr;
+    for (std::size_t i = 0; i < graph.edges(); ++i) {
+      edges[next[number[labels[graph.edge(i).first]]]++] = i;
+    }
+  }
+
+  std::size_t size() const { return node_ptr.size() - 1; }
+  std::size_t nodes_of(std::size_t comp) const { return node_ptr[comp + 1] - node_ptr[comp]; }
+
+  // Edges of a component with ends numbered within it.
+  std::vector<resistor_edge> local_edges(const circuit_graph &graph, std::size_t comp) const {
+    std::vector<resistor_edge> res;
+    res.reserve(edge_ptr[comp + 1] - edge_ptr[comp]);
+    for (auto k = edge_ptr[comp]; k < edge_ptr[comp + 1]; ++k) {
+      auto edge = graph.edge(edges[k]);
+      edge.first = local[edge.first];
+      edge.second = local[edge.second];
+      res.push_back(edge);
+    }
+    return res;
+  }
+};
+
+} // namespace
+
+std::size_t circuit_graph::insert(unsigned first, unsigned second, double resistance, double emf) {
   if (first == second) throw std::invalid_argument("Circuit graph can't have loops");
 
   if (first > second) {
@@ -161,64 +555,509 @@ void resistor_network::insert(unsigned first, unsigned second, double resistance
     emf = -emf;
   }
 
-  auto found = m_map.find(first);
-  if (found != m_map.end() && found->second.find(second) != found->second.end()) {
+  const auto id_of = [this](unsigned name) {
+    auto [found, inserted] = m_ids.try_emplace(name, m_names.size());
+    if (inserted) m_names.push_back(name);
+    return found->second;
+  };
+
+  m_edges.push_back({id_of(first), id_of(second), resistance, emf});
+  m_incident_ptr.clear();
+  return m_edges.size() - 1;
+}
+
+circuit_graph::circuit_graph(std::span<const resistor_edge> edges) {
+  m_edges.reserve(edges.size());
+
+  unsigned max_name = 0;
+  for (const auto &edge : edges) {
+    max_name = std::max({max_name, edge.first, edge.second});
+  }
+
+  // Netlists usually number nodes densely. Then ids are assigned through a table, and names are hashed once per node
+  // rather than once per end of an edge.
+  if (max_name / 4 > edges.size()) {
+    for (const auto &edge : edges) {
+      insert(edge.first, edge.second, edge.resistance, edge.emf);
+    }
+    return;
+  }
+
+  constexpr auto        none = std::numeric_limits<unsigned>::max();
+  std::vector<unsigned> ids(std::size_t{max_name} + 1, none);
+  const auto            id_of = [&](unsigned name) {
+    if (ids[name] == none) {
+      ids[name] = m_names.size();
+      m_names.push_back(name);
+    }
+    return ids[name];
+  };
+
+  for (auto edge : edges) {
+    if (edge.first == edge.second) throw std::invalid_argument("Circuit graph can't have loops");
+    if (edge.first > edge.second) {
+      std::swap(edge.first, edge.second);
+      edge.emf = -edge.emf;
+    }
+    m_edges.push_back({id_of(edge.first), id_of(edge.second), edge.resistance, edge.emf});
+  }
+
+  m_ids.reserve(m_names.size());
+  for (unsigned i = 0; i < m_names.size(); ++i) {
+    m_ids.emplace(m_names[i], i);
+  }
+}
+
+std::size_t circuit_graph::id(unsigned name) const {
+  auto found = m_ids.find(name);
+  return (found == m_ids.end() ? npos : found->second);
+}
+
+void circuit_graph::build_adjacency() const {
+  if (m_incident_ptr.size() == m_names.size() + 1) return;
+
+  std::vector<std::size_t> ptr(m_names.size() + 1), incident(2 * m_edges.size());
+  for (const auto &edge : m_edges) {
+    ++ptr[edge.first + 1];
+    ++ptr[edge.second + 1];
+  }
+  for (std::size_t i = 0; i < m_names.size(); ++i) {
+    ptr[i + 1] += ptr[i];
+  }
+
+  auto next = ptr;
+  for (std::size_t i = 0; i < m_edges.size(); ++i) {
+    incident[next[m_edges[i].first]++] = i;
+    incident[next[m_edges[i].second]++] = i;
+  }
+
+  for (unsigned node = 0; node < m_names.size(); ++node) {
+    const auto other = [this, node](std::size_t index) {
+      return (m_edges[index].first == node ? m_edges[index].second : m_edges[index].first);
+    };
+
+    auto first = incident.begin() + ptr[node], last = incident.begin() + ptr[node + 1];
+    std::sort(first, last, [&other](std::size_t a, std::size_t b) { return other(a) < other(b); });
+    if (std::adjacent_find(first, last, [&other](std::size_t a, std::size_t b) { return other(a) == other(b); }) !=
+        last) {
+      throw std::invalid_argument("Edge is already present in the graph");
+    }
+  }
+
+  m_incident = std::move(incident);
+  m_incident_ptr = std::move(ptr);
+}
+
+std::span<const std::size_t> circuit_graph::incident(unsigned node) const {
+  build_adjacency();
+  return {m_incident.data() + m_incident_ptr[node], m_incident.data() + m_incident_ptr[node + 1]};
+}
+
+std::size_t circuit_graph::find_edge(unsigned first, unsigned second) const {
+  const auto edges = incident(first);
+  const auto other = [this, first](std::size_t index) {
+    return (m_edges[index].first == first ? m_edges[index].second : m_edges[index].first);
+  };
+
+  auto found = std::partition_point(edges.begin(), edges.end(), [&](auto index) { return other(index) < second; });
+  return (found == edges.end() || other(*found) != second ? npos : *found);
+}
+
+std::size_t circuit_graph::find_named_edge(unsigned first, unsigned second) const {
+  const auto a = id(first), b = id(second);
+  return (a == npos || b == npos ? npos : find_edge(a, b));
+}
+
+void circuit_graph::update_edge(std::size_t id, double resistance, double emf) {
+  auto &edge = m_edges.at(id);
+  edge.resistance = resistance;
+  edge.emf = emf;
+}
+
+std::vector<unsigned> circuit_graph::component_labels() const {
+  std::vector<std::pair<unsigned, unsigned>> ends;
+  ends.reserve(m_edges.size());
+  for (const auto &edge : m_edges) {
+    ends.push_back({edge.first, edge.second});
+  }
+
+  throttle::concurrent_disjoint_set_forest dsu{static_cast<unsigned>(m_names.size())};
+  throttle::parallel_union(dsu, ends.begin(), ends.end());
+
+  std::vector<unsigned> labels(m_names.size());
+  for (unsigned i = 0; i < m_names.size(); ++i) {
+    labels[i] = dsu.find_set(i);
+  }
+  return labels;
+}
+
+circuit_solution circuit_graph::solve(const solver_options &options, reduction_report *report) const {
+  build_adjacency();
+  const auto lists = component_lists{*this};
+
+  // Components are handed out in order, so the largest ones go first and small ones fill the gaps in the end.
+  std::vector<std::size_t> order(lists.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&lists](auto a, auto b) { return lists.nodes_of(a) > lists.nodes_of(b); });
+
+  // Components have disjoint sets of nodes and edges, so their results are written in place.
+  circuit_solution                result{std::vector<double>(nodes()), std::vector<double>(edges())};
+  std::vector<reduction_report>   reports(lists.size());
+  std::vector<std::exception_ptr> errors(lists.size());
+  component_pool().parallel_for(lists.size(), [&](std::size_t i) {
+    const auto comp = order[i];
+    try {
+      symbolic_ptr symbolic;
+      const auto   solution =
+          solve_component(lists.nodes_of(comp), lists.local_edges(*this, comp), options, symbolic, reports[i]);
+      for (auto k = lists.node_ptr[comp]; k < lists.node_ptr[comp + 1]; ++k) {
+        result.potentials[lists.nodes[k]] = solution.potentials[k - lists.node_ptr[comp]];
+      }
+      for (auto k = lists.edge_ptr[comp]; k < lists.edge_ptr[comp + 1]; ++k) {
+        result.currents[lists.edges[k]] = solution.currents[k - lists.edge_ptr[comp]];
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+
+  for (std::size_t i = 0; i < lists.size(); ++i) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    if (report) {
+      report->original_unknowns += reports[i].original_unknowns;
+      report->reduced_unknowns += reports[i].reduced_unknowns;
+    }
+  }
+
+  return result;
+}
+
+namespace {
+
+std::uint64_t edge_key(unsigned first, unsigned second) {
+  return (std::uint64_t{std::min(first, second)} << 32) | std::max(first, second);
+}
+
+} // namespace
+
+void connected_resistor_network::insert(unsigned first, unsigned second, double resistance, double emf) {
+  if (first == second) throw std::invalid_argument("Circuit graph can't have loops");
+  if (m_edge_ids.contains(edge_key(first, second))) {
     throw std::invalid_argument("Edge is already present in the graph");
   }
+  m_edge_ids.emplace(edge_key(first, second), m_graph.insert(first, second, resistance, emf));
+}
 
-  m_map[first].insert({second, std::make_pair(resistance, emf)});
-  m_map[second].insert({first, std::make_pair(resistance, -emf)});
+void connected_resistor_network::try_insert(unsigned first, unsigned second, double resistance, double emf) {
+  if (first == second) throw std::invalid_argument("Circuit graph can't have loops");
+  const auto [found, inserted] = m_edge_ids.try_emplace(edge_key(first, second), m_graph.edges());
+  if (inserted) m_graph.insert(first, second, resistance, emf);
+}
+
+void connected_resistor_network::update_edge(unsigned first, unsigned second, double resistance, double emf) {
+  const auto found = m_edge_ids.find(edge_key(first, second));
+  if (found == m_edge_ids.end()) throw std::invalid_argument("Edge is not present in the graph");
+  const auto index = found->second;
+
+  // A short circuit has its own current variable, so the structure of the system only changes when the edge becomes
+  // or stops being one.
+  m_graph.update_edge(index, resistance, (m_graph.edge(index).first == m_graph.id(first) ? emf : -emf));
+}
+
+std::vector<unsigned> connected_resistor_network::nodes() const {
+  std::vector<unsigned> res(m_graph.nodes());
+  for (unsigned i = 0; i < res.size(); ++i) {
+    res[i] = m_graph.name(i);
+  }
+  return res;
+}
+
+std::vector<resistor_edge> connected_resistor_network::edges() const {
+  std::vector<resistor_edge> res(m_graph.edges());
+  for (std::size_t i = 0; i < res.size(); ++i) {
+    const auto &edge = m_graph.edge(i);
+    res[i] = {m_graph.name(edge.first), m_graph.name(edge.second), edge.resistance, edge.emf};
+  }
+  return res;
+}
+
+connected_resistor_network::solution connected_resistor_network::solve(const solver_options &options,
+                                                                      reduction_report    *report) const {
+  if (m_graph.empty()) throw std::invalid_argument{"Network can't be empty"};
+  m_graph.build_adjacency();
+
+  std::vector<resistor_edge> edges(m_graph.edges());
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    edges[i] = m_graph.edge(i);
+  }
+
+  reduction_report sizes;
+  const auto       result = solve_component(m_graph.nodes(), edges, options, m_symbolic, sizes);
+  if (report) {
+    report->original_unknowns += sizes.original_unknowns;
+    report->reduced_unknowns += sizes.reduced_unknowns;
+  }
+
+  auto result_potentials = solution_potentials{};
+  for (unsigned i = 0; i < m_graph.nodes(); ++i) {
+    result_potentials[m_graph.name(i)] = result.potentials[i];
+  }
+
+  auto result_currents = solution_currents{};
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    const auto first = m_graph.name(edges[i].first), second = m_graph.name(edges[i].second);
+    result_currents[first][second] = result.currents[i];
+    result_currents[second][first] = -result.currents[i];
+  }
+
+  return {result_potentials, result_currents};
+}
+
+void resistor_network::insert(unsigned first, unsigned second, double resistance, double emf) {
+  if (first == second) throw std::invalid_argument("Circuit graph can't have loops");
+  if (!m_edge_names.insert(edge_key(first, second)).second) {
+    throw std::invalid_argument("Edge is already present in the graph");
+  }
+  m_graph.insert(first, second, resistance, emf);
+}
+
+resistor_network::map_type resistor_network::graph() const {
+  map_type res;
+  for (std::size_t i = 0; i < m_graph.edges(); ++i) {
+    const auto &edge = m_graph.edge(i);
+    const auto  first = m_graph.name(edge.first), second = m_graph.name(edge.second);
+    res[first].insert({second, std::make_pair(edge.resistance, edge.emf)});
+    res[second].insert({first, std::make_pair(edge.resistance, -edge.emf)});
+  }
+  return res;
 }
 
 std::vector<connected_resistor_network> resistor_network::connected_components() const {
-  throttle::disjoint_set_forest<unsigned> dsu;
+  m_graph.build_adjacency();
+  const auto lists = component_lists{m_graph};
 
-  for (const auto &v : m_map) {
-    dsu.make_set(v.first);
+  std::vector<connected_resistor_network> result(lists.size());
+  for (std::size_t comp = 0; comp < lists.size(); ++comp) {
+    for (auto k = lists.edge_ptr[comp]; k < lists.edge_ptr[comp + 1]; ++k) {
+      const auto &edge = m_graph.edge(lists.edges[k]);
+      result[comp].insert(m_graph.name(edge.first), m_graph.name(edge.second), edge.resistance, edge.emf);
+    }
   }
 
-  for (const auto &v : m_map) {
-    for (const auto &p : v.second) {
-      // Here we do double work because each edge is visited twice, but this part isn't perfomance critical.
-      dsu.union_set(v.first, p.first);
+  return result;
+}
+
+resistor_network::solution resistor_network::solve(const solver_options &options, reduction_report *report) const {
+  const auto result = m_graph.solve(options, report);
+
+  solution res;
+  for (unsigned i = 0; i < m_graph.nodes(); ++i) {
+    res.first[m_graph.name(i)] = result.potentials[i];
+  }
+
+  for (std::size_t i = 0; i < m_graph.edges(); ++i) {
+    const auto &edge = m_graph.edge(i);
+    const auto  first = m_graph.name(edge.first), second = m_graph.name(edge.second);
+    res.second[first][second] = result.currents[i];
+    res.second[second][first] = -result.currents[i];
+  }
+
+  return res;
+}
+
+struct solved_resistor_network::component {
+  // Change of conductance g of the edge between unknown potentials first and second is g * u * u^T, where u has 1 at
+  // first and -1 at second. z = A^{-1} * u is kept, because it only depends on the edge.
+  struct rank_one_update {
+    std::size_t         first, second;
+    double              conductance;
+    std::vector<double> z;
+
+    double project(const std::vector<double> &vec) const {
+      return (first == npos ? 0.0 : vec[first]) - (second == npos ? 0.0 : vec[second]);
+    }
+  };
+
+  std::vector<unsigned>      names, nodes; // Names of nodes and their ids within the component.
+  std::vector<resistor_edge> edges;
+
+  mna_layout                                  layout;
+  std::vector<double>                         rhs;
+  symbolic_ptr                                symbolic;
+  std::optional<linmath::sparse_ldlt<double>> factor; // Empty if the component is solved iteratively.
+  std::vector<rank_one_update>                updates;
+
+  std::vector<double> unknowns;
+  std::vector<double> potentials, currents; // Last reported ones.
+  bool                changed = true, restructured = true;
+
+  void update_edge(std::size_t index, double resistance, double emf) {
+    auto      &edge = edges[index];
+    const auto old = edge;
+    edge.resistance = resistance;
+    edge.emf = emf;
+    changed = true;
+
+    if (is_short_circuit(old) != is_short_circuit(edge)) restructured = true;
+    if (restructured) return;
+
+    const auto [first, second, current] = layout.edges[index];
+    if (current != npos) {
+      rhs[current] = -emf;
+      return;
+    }
+
+    const auto source_delta = old.emf / old.resistance - emf / resistance;
+    if (first != npos) rhs[first] += source_delta;
+    if (second != npos) rhs[second] -= source_delta;
+
+    // Iteratively solved components are assembled again.
+    const auto conductance_delta = 1.0 / resistance - 1.0 / old.resistance;
+    if (!factor || conductance_delta == 0.0) return;
+
+    auto found = std::find_if(updates.begin(), updates.end(),
+                              [first, second](const auto &u) { return u.first == first && u.second == second; });
+    if (found == updates.end()) {
+      updates.push_back({first, second, conductance_delta, {}});
+    } else if ((found->conductance += conductance_delta) == 0.0) {
+      updates.erase(found);
     }
   }
 
-  std::unordered_map<unsigned, connected_resistor_network> connected_representatives;
-  // FindSet does not change the component representaive. Here we iterate over all the nodes and find their
-  // representaive to find all connected components.
-  for (const auto &v : m_map) {
-    const auto &found = dsu.find_set(v.first);
-    if (connected_representatives.contains(found)) continue;
-    connected_representatives.insert({found, connected_resistor_network{}});
+  void build(const solver_options &options) {
+    if (restructured) layout = mna_layout{nodes, edges};
+    auto [system, assembled_rhs] = assemble(layout, edges);
+    rhs = std::move(assembled_rhs);
+    factor.reset();
+    updates.clear();
+
+    // The previous solution is only a starting point, so it's fine if it was for another structure.
+    if (!fits_factor(system, options, symbolic)) {
+      if (unknowns.size() != layout.size) unknowns.clear();
+      auto result = solve_iteratively(system, rhs, (layout.short_circuits == 0), options, unknowns);
+      if (result.converged) {
+        unknowns = std::move(result.solution);
+        return;
+      }
+    }
+
+    factor.emplace(system, symbolic);
+    unknowns = factor->solve(rhs);
   }
 
-  for (const auto &v : m_map) {
-    for (const auto &p : v.second) {
-      const auto &found = dsu.find_set(v.first);
-      connected_representatives[found].try_insert(v.first, p.first, p.second.first, p.second.second);
+  // Sherman-Morrison-Woodbury: (A + U * G * U^T)^{-1} * b = y - Z * (G^{-1} + U^T * Z)^{-1} * U^T * y, where y =
+  // A^{-1} * b and Z = A^{-1} * U.
+  void apply_updates() {
+    auto solution = factor->solve(rhs);
+
+    const auto size = updates.size();
+    if (size) {
+      for (auto &u : updates) {
+        if (!u.z.empty()) continue;
+        std::vector<double> col(layout.size);
+        if (u.first != npos) col[u.first] = 1.0;
+        if (u.second != npos) col[u.second] = -1.0;
+        u.z = factor->solve(col);
+      }
+
+      linmath::matrix_d   capacitance{size, size};
+      std::vector<double> projected(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        for (std::size_t j = 0; j < size; ++j) {
+          capacitance[i][j] = updates[i].project(updates[j].z);
+        }
+        capacitance[i][i] += 1.0 / updates[i].conductance;
+        projected[i] = updates[i].project(solution);
+      }
+
+      const auto weights = linmath::lu_decomposition<double>{capacitance}.solve(projected);
+      for (std::size_t i = 0; i < size; ++i) {
+        const auto &z = updates[i].z;
+        for (std::size_t k = 0; k < solution.size(); ++k) {
+          solution[k] -= weights[i] * z[k];
+        }
+      }
     }
+
+    unknowns = std::move(solution);
   }
 
-  std::vector<connected_resistor_network> result;
-  for (const auto &v : connected_representatives) {
-    result.push_back(std::move(v.second));
+  void resolve(const solver_options &options) {
+    if (restructured || !factor || updates.size() > options.max_updates) {
+      build(options);
+    } else {
+      apply_updates();
+    }
+    restructured = false;
   }
+};
 
-  return result;
+solved_resistor_network::solved_resistor_network(const resistor_network &network, const solver_options &options)
+    : m_options{options}, m_graph{network.core()}, m_edge_places(m_graph.edges()) {
+  m_graph.build_adjacency();
+  const auto lists = component_lists{m_graph};
+
+  m_components.resize(lists.size());
+  for (std::size_t c = 0; c < lists.size(); ++c) {
+    auto &comp = m_components[c];
+    for (auto k = lists.node_ptr[c]; k < lists.node_ptr[c + 1]; ++k) {
+      comp.names.push_back(m_graph.name(lists.nodes[k]));
+      comp.nodes.push_back(k - lists.node_ptr[c]);
+    }
+
+    comp.edges = lists.local_edges(m_graph, c);
+    for (auto k = lists.edge_ptr[c]; k < lists.edge_ptr[c + 1]; ++k) {
+      m_edge_places[lists.edges[k]] = {c, k - lists.edge_ptr[c]};
+    }
+  }
+
+  resolve();
 }
 
-resistor_network::solution resistor_network::solve() const {
-  auto     components = connected_components();
-  solution result;
+solved_resistor_network::solved_resistor_network(solved_resistor_network &&) noexcept = default;
+solved_resistor_network &solved_resistor_network::operator=(solved_resistor_network &&) noexcept = default;
+solved_resistor_network::~solved_resistor_network() = default;
+
+void solved_resistor_network::update_edge(unsigned first, unsigned second, double resistance, double emf) {
+  const auto id = m_graph.find_named_edge(first, second);
+  if (id == circuit_graph::npos) throw std::invalid_argument("Edge is not present in the graph");
+
+  const auto [comp, index] = m_edge_places[id];
+  m_components[comp].update_edge(index, resistance, (m_graph.edge(id).first == m_graph.id(first) ? emf : -emf));
+}
 
-  for (const auto &comp : components) {
-    auto individual_sol = comp.solve();
-    result.first.merge(individual_sol.first);
-    result.second.merge(individual_sol.second);
+solved_resistor_network::solution solved_resistor_network::resolve() {
+  solution changes;
+
+  for (auto &comp : m_components) {
+    if (!comp.changed) continue;
+    comp.resolve(m_options);
+    comp.changed = false;
+
+    // Values that were never reported are NaN, so they differ from anything.
+    comp.potentials.resize(comp.nodes.size(), std::numeric_limits<double>::quiet_NaN());
+    comp.currents.resize(comp.edges.size(), std::numeric_limits<double>::quiet_NaN());
+
+    for (std::size_t i = 0; i < comp.nodes.size(); ++i) {
+      const auto potential = comp.layout.potential(comp.layout.rows[i], comp.unknowns);
+      if (throttle::is_roughly_equal(potential, comp.potentials[i])) continue;
+      comp.potentials[i] = potential;
+      m_solution.first[comp.names[i]] = changes.first[comp.names[i]] = potential;
+    }
+
+    for (std::size_t i = 0; i < comp.edges.size(); ++i) {
+      const auto &edge = comp.edges[i];
+      const auto  current = comp.layout.current(i, edge, comp.unknowns);
+      if (throttle::is_roughly_equal(current, comp.currents[i])) continue;
+      comp.currents[i] = current;
+
+      const auto first = comp.names[edge.first], second = comp.names[edge.second];
+      m_solution.second[first][second] = changes.second[first][second] = current;
+      m_solution.second[second][first] = changes.second[second][first] = -current;
+    }
   }
 
-  return result;
+  return changes;
 }
 
 } // namespace circuits
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "netlist.hpp"
+#include "resistor_network.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace netlist = circuits::netlist;
+
+namespace {
+
+void expect_edge(const circuits::resistor_edge &edge, unsigned first, unsigned second, double resistance, double emf) {
+  EXPECT_EQ(edge.first, first);
+  EXPECT_EQ(edge.second, second);
+  EXPECT_DOUBLE_EQ(edge.resistance, resistance);
+  EXPECT_DOUBLE_EQ(edge.emf, emf);
+}
+
+// Grid of side * side nodes with a source on every tenth edge, written with varying whitespace.
+std::string make_grid_text(unsigned side) {
+  std::string text;
+  unsigned    count = 0;
+  const auto  add = [&](unsigned a, unsigned b) {
+    text += std::to_string(a) + (count % 3 ? " -- " : "--") + std::to_string(b) + ", " + std::to_string(1 + count % 7);
+    text += (count % 10 ? ";\n" : ";   " + std::to_string(count % 5) + "V;\n");
+    if (count % 13 == 0) text += "                                                            \n";
+    ++count;
+  };
+
+  for (unsigned i = 0; i < side * side; ++i) {
+    if (i % side + 1 < side) add(i, i + 1);
+    if (i + side < side * side) add(i, i + side);
+  }
+  return text;
+}
+
+std::string temporary_path(const std::string &name) { return (std::filesystem::temp_directory_path() / name).string(); }
+
+} // namespace
+
+TEST(test_netlist, test_parse) {
+  const auto edges = netlist::parse("1 -- 2, 4.0;\n  2--3 , 1e1 ; 5 V ;\n3 -- 1, 2; -1.5V\n\t4 -- 1, +3;");
+  ASSERT_EQ(edges.size(), 4);
+  expect_edge(edges[0], 1, 2, 4, 0);
+  expect_edge(edges[1], 2, 3, 10, 5);
+  expect_edge(edges[2], 3, 1, 2, -1.5);
+  expect_edge(edges[3], 4, 1, 3, 0);
+
+  EXPECT_TRUE(netlist::parse(" \n\t ").empty());
+}
+
+TEST(test_netlist, test_errors) {
+  EXPECT_THROW(netlist::parse("1 -- 2, 4.0"), std::runtime_error);
+  EXPECT_THROW(netlist::parse("1 - 2, 4.0;"), std::runtime_error);
+  EXPECT_THROW(netlist::parse("1 -- 2, 4.0; 5"), std::runtime_error);
+
+  try {
+    netlist::parse("1 -- 2, 4.0;\n\n3 -- x, 1;\n");
+    FAIL();
+  } catch (std::runtime_error &e) {
+    EXPECT_NE(std::string{e.what()}.find("line 3"), std::string::npos);
+  }
+}
+
+TEST(test_netlist, test_parallel_parse) {
+  // Large enough to be parsed in chunks, and each chunk gives the same edges as a record-by-record parse.
+  const auto text = make_grid_text(250);
+  ASSERT_GT(text.size(), netlist::parallel_threshold);
+
+  const auto edges = netlist::parse(text);
+  ASSERT_EQ(edges.size(), 2 * 250 * 249);
+
+  std::size_t count = 0;
+  for (unsigned i = 0; i < 250 * 250; ++i) {
+    if (i % 250 + 1 < 250) {
+      expect_edge(edges[count], i, i + 1, 1 + count % 7, (count % 10 ? 0 : count % 5));
+      ++count;
+    }
+    if (i + 250 < 250 * 250) {
+      expect_edge(edges[count], i, i + 250, 1 + count % 7, (count % 10 ? 0 : count % 5));
+      ++count;
+    }
+  }
+
+  // Errors far from the beginning still report the line they are at.
+  try {
+    netlist::parse(text + "1 -- 2;\n");
+    FAIL();
+  } catch (std::runtime_error &e) {
+    const auto lines = std::count(text.begin(), text.end(), '\n');
+    EXPECT_NE(std::string{e.what()}.find("line " + std::to_string(lines + 1)), std::string::npos);
+  }
+}
+
+TEST(test_netlist, test_load) {
+  const auto text_path = temporary_path("test_netlist.txt"), binary_path = temporary_path("test_netlist.bin");
+  std::ofstream{text_path} << "1 -- 2, 4.0;\n2 -- 3, 2; 3V\n";
+
+  const auto edges = netlist::load(text_path);
+  ASSERT_EQ(edges.size(), 2);
+  netlist::save_binary(binary_path, edges);
+
+  const auto binary = netlist::load(binary_path);
+  ASSERT_EQ(binary.size(), 2);
+  expect_edge(binary[0], 1, 2, 4, 0);
+  expect_edge(binary[1], 2, 3, 2, 3);
+
+  std::filesystem::resize_file(binary_path, std::filesystem::file_size(binary_path) - 1);
+  EXPECT_THROW(netlist::load(binary_path), std::runtime_error);
+  EXPECT_THROW(netlist::load(temporary_path("test_netlist.missing")), std::runtime_error);
+
+  std::remove(text_path.c_str());
+  std::remove(binary_path.c_str());
+}
+
+TEST(test_netlist, test_load_malformed) {
+  const auto path = temporary_path("test_netlist_malformed.txt");
+  const auto open_descriptors = [] {
+    std::error_code error;
+    const auto      it = std::filesystem::directory_iterator{"/proc/self/fd", error};
+    return (error ? 0 : std::distance(it, std::filesystem::directory_iterator{}));
+  };
+
+  // Both the record-by-record and the chunked parse fail, and the file is closed once either way.
+  for (const auto &text : {std::string{"1 -- 2, 4.0;\n2 -- x, 1;\n"}, make_grid_text(250) + "1 -- 2;\n"}) {
+    std::ofstream{path} << text;
+    const auto before = open_descriptors();
+    EXPECT_THROW(netlist::load(path), std::runtime_error);
+    EXPECT_EQ(open_descriptors(), before);
+  }
+
+  std::ofstream{path} << "1 -- 2, 4.0;\n";
+  EXPECT_EQ(netlist::load(path).size(), 1);
+  std::remove(path.c_str());
+}
+
+TEST(test_netlist, test_bulk_graph) {
+  const auto edges = netlist::parse("5 -- 3, 1; 2V\n3 -- 7, 2;\n7 -- 5, 3;\n1000 -- 5, 0;\n");
+
+  // Same ids and orientation as inserting edges one by one.
+  const circuits::circuit_graph bulk{edges};
+  circuits::circuit_graph       inserted;
+  for (const auto &edge : edges) {
+    inserted.insert(edge.first, edge.second, edge.resistance, edge.emf);
+  }
+
+  ASSERT_EQ(bulk.nodes(), inserted.nodes());
+  ASSERT_EQ(bulk.edges(), inserted.edges());
+  for (unsigned i = 0; i < bulk.nodes(); ++i) {
+    EXPECT_EQ(bulk.name(i), inserted.name(i));
+    EXPECT_EQ(bulk.id(bulk.name(i)), i);
+  }
+  for (std::size_t i = 0; i < bulk.edges(); ++i) {
+    const auto &edge = inserted.edge(i);
+    expect_edge(bulk.edge(i), edge.first, edge.second, edge.resistance, edge.emf);
+  }
+
+  EXPECT_THROW(circuits::circuit_graph{netlist::parse("1 -- 1, 1;")}, std::invalid_argument);
+}
@@ -0,0 +1,332 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "equal.hpp"
+#include "resistor_network.hpp"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+// A single loop 0 - 1 - 2 - 0 with the source on the last edge.
+circuits::connected_resistor_network make_loop() {
+  circuits::connected_resistor_network network;
+  network.insert(0, 1, 2, 0);
+  network.insert(1, 2, 2, 0);
+  network.insert(2, 0, 1, 3);
+  return network;
+}
+
+struct edge {
+  unsigned first, second;
+  double   resistance, emf;
+};
+
+// Two components: a ladder with a source and a short circuit in it, and a separate loop.
+std::vector<edge> make_edges() {
+  std::vector<edge> edges;
+  for (unsigned i = 0; i < 10; ++i) {
+    edges.push_back({2 * i, 2 * i + 1, 1.0 + i % 3, 0});
+    if (i + 1 < 10) {
+      edges.push_back({2 * i, 2 * i + 2, 2.0, 0});
+      edges.push_back({2 * i + 1, 2 * i + 3, 0.5 + i % 2, 0});
+    }
+  }
+  edges[0].emf = 5;
+  edges[4].resistance = 0;
+  edges[4].emf = 1;
+
+  edges.push_back({100, 101, 1, 2});
+  edges.push_back({101, 102, 1, 0});
+  edges.push_back({102, 100, 1, 0});
+  return edges;
+}
+
+circuits::resistor_network make_network(const std::vector<edge> &edges) {
+  circuits::resistor_network network;
+  for (const auto &e : edges) {
+    network.insert(e.first, e.second, e.resistance, e.emf);
+  }
+  return network;
+}
+
+void expect_same(const circuits::resistor_network::solution &expected,
+                 const circuits::resistor_network::solution &actual) {
+  ASSERT_EQ(expected.first.size(), actual.first.size());
+  for (const auto &[node, potential] : expected.first) {
+    EXPECT_TRUE(throttle::is_roughly_equal(potential, actual.first.at(node)));
+  }
+  for (const auto &[first, adjacent] : expected.second) {
+    for (const auto &[second, current] : adjacent) {
+      EXPECT_TRUE(throttle::is_roughly_equal(current, actual.second.at(first).at(second)));
+    }
+  }
+}
+
+void sweep(const circuits::solver_options &options) {
+  auto edges = make_edges();
+  auto solved = circuits::solved_resistor_network{make_network(edges), options};
+  expect_same(make_network(edges).solve(), solved.current());
+
+  for (unsigned step = 0; step < 8; ++step) {
+    auto &changed = edges[(5 * step + 1) % 20];
+    changed.resistance = 0.5 + step;
+    changed.emf = (step % 2 ? 1.0 : 0.0);
+    solved.update_edge(changed.second, changed.first, changed.resistance, -changed.emf);
+
+    const auto changes = solved.resolve();
+    // The other component stays the same.
+    EXPECT_EQ(changes.first.count(100), 0);
+    EXPECT_EQ(changes.second.count(100), 0);
+    expect_same(make_network(edges).solve(), solved.current());
+  }
+
+  // A short circuit turns into a resistor and back.
+  edges[4].resistance = 3;
+  solved.update_edge(edges[4].first, edges[4].second, edges[4].resistance, edges[4].emf);
+  solved.resolve();
+  expect_same(make_network(edges).solve(), solved.current());
+
+  edges[4].resistance = 0;
+  edges[4].emf = 2;
+  solved.update_edge(edges[4].first, edges[4].second, edges[4].resistance, edges[4].emf);
+  solved.resolve();
+  expect_same(make_network(edges).solve(), solved.current());
+}
+
+// Small grids with chains of resistors instead of some edges, dangling trees and a few short circuits. Every chain
+// between grid nodes reduces to parallel edges.
+std::vector<edge> make_reducible(unsigned components, unsigned side) {
+  std::mt19937                     gen{7};
+  std::uniform_real_distribution<> dist{1, 10};
+  std::vector<edge>                edges;
+
+  unsigned next = 0;
+  for (unsigned c = 0; c < components; ++c) {
+    const auto first = next, nodes = side * side;
+    next += nodes;
+
+    const auto connect = [&](unsigned a, unsigned b, unsigned k) {
+      if (k % 5 == 1) {
+        edges.push_back({a, next, dist(gen), 1});
+        edges.push_back({next, next + 1, dist(gen), 0});
+        edges.push_back({next + 1, b, (k % 3 ? dist(gen) : 0.0), 2});
+        next += 2;
+      } else {
+        edges.push_back({a, b, (k % 7 == 3 ? 0.0 : dist(gen)), (k % 4 ? 0.0 : dist(gen))});
+      }
+    };
+
+    for (unsigned i = 0; i < nodes; ++i) {
+      if (i % side + 1 < side) connect(first + i, first + i + 1, 2 * i);
+      if (i + side < nodes) connect(first + i, first + i + side, 2 * i + 1);
+      if (i % 3 == 0) {
+        edges.push_back({first + i, next, dist(gen), 3});
+        edges.push_back({next, next + 1, (i % 2 ? 0.0 : dist(gen)), 0});
+        edges.push_back({next, next + 2, dist(gen), 1});
+        next += 3;
+      }
+    }
+  }
+
+  return edges;
+}
+
+} // namespace
+
+TEST(test_resistor_network, test_update_edge) {
+  auto network = make_loop();
+  EXPECT_TRUE(throttle::is_roughly_equal(network.solve().second[2][0], 0.6));
+
+  network.update_edge(0, 2, 1, -6);
+  EXPECT_TRUE(throttle::is_roughly_equal(network.solve().second[2][0], 1.2));
+
+  // Becoming a short circuit and back changes the structure of the system.
+  network.update_edge(1, 2, 0, 0);
+  auto [potentials, currents] = network.solve();
+  EXPECT_TRUE(throttle::is_roughly_equal(currents[2][0], 2.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(currents[1][2], 2.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(potentials[1], potentials[2]));
+
+  network.update_edge(2, 1, 2, 0);
+  EXPECT_TRUE(throttle::is_roughly_equal(network.solve().second[2][0], 1.2));
+
+  EXPECT_THROW(network.update_edge(0, 3, 1, 0), std::invalid_argument);
+}
+
+TEST(test_resistor_network, test_insert_duplicate) {
+  // Both adapters reject a parallel edge right away, whichever way its ends are given, and keep the first one.
+  circuits::resistor_network network;
+  network.insert(1, 2, 3, 0);
+  EXPECT_THROW(network.insert(2, 1, 4, 0), std::invalid_argument);
+  EXPECT_THROW(network.insert(1, 2, 4, 0), std::invalid_argument);
+  EXPECT_THROW(network.insert(3, 3, 1, 0), std::invalid_argument);
+  EXPECT_EQ(network.graph().at(1).at(2).first, 3);
+  EXPECT_NO_THROW(network.solve());
+
+  circuits::connected_resistor_network connected;
+  connected.insert(1, 2, 3, 0);
+  EXPECT_THROW(connected.insert(2, 1, 4, 0), std::invalid_argument);
+  EXPECT_EQ(connected.edges().size(), 1);
+}
+
+TEST(test_resistor_network, test_try_insert) {
+  // Duplicates are found without building adjacency, so a large grid is inserted edge by edge in linear time.
+  constexpr unsigned                   side = 300;
+  circuits::connected_resistor_network network;
+  for (unsigned pass = 0; pass < 2; ++pass) {
+    for (unsigned i = 0; i < side * side; ++i) {
+      // The second pass tries every edge again with swapped ends and other values.
+      if (i % side + 1 < side) pass ? network.try_insert(i + 1, i, 5, 5) : network.try_insert(i, i + 1, 1, 0);
+      if (i + side < side * side) pass ? network.try_insert(i + side, i, 5, 5) : network.try_insert(i, i + side, 2, 0);
+    }
+  }
+
+  const auto edges = network.edges();
+  ASSERT_EQ(edges.size(), 2 * side * (side - 1));
+  for (const auto &edge : edges) {
+    EXPECT_EQ(edge.resistance, (edge.second - edge.first == 1 ? 1 : 2));
+    EXPECT_EQ(edge.emf, 0);
+  }
+
+  network.update_edge(1, 0, 3, 1);
+  EXPECT_EQ(network.edges().front().resistance, 3);
+  EXPECT_EQ(network.edges().front().emf, -1);
+  EXPECT_THROW(network.update_edge(0, side + 1, 1, 0), std::invalid_argument);
+  EXPECT_THROW(network.try_insert(4, 4, 1, 0), std::invalid_argument);
+}
+
+TEST(test_resistor_network, test_direct_and_iterative) {
+  auto network = make_loop();
+  network.update_edge(1, 2, 0, 1);
+
+  const auto direct = network.solve();
+  const auto iterative = network.solve({.max_factor_size = 0});
+  for (const auto &[node, potential] : direct.first) {
+    EXPECT_TRUE(throttle::is_roughly_equal(potential, iterative.first.at(node)));
+  }
+}
+
+TEST(test_resistor_network, test_resolve) {
+  sweep({});
+  // A factorization is computed again after every two changes.
+  sweep({.max_updates = 2});
+  // Iterations start from the previous solution.
+  sweep({.max_factor_size = 0});
+}
+
+TEST(test_resistor_network, test_resolve_changes) {
+  auto edges = make_edges();
+  auto solved = circuits::solved_resistor_network{make_network(edges)};
+  EXPECT_TRUE(solved.resolve().first.empty());
+
+  // Only the EMF of the loop changes, so the potential of its base node and the currents of the ladder stay the same.
+  solved.update_edge(100, 101, 1, 4);
+  const auto [potentials, currents] = solved.resolve();
+  EXPECT_EQ(potentials.size(), 2);
+  EXPECT_EQ(currents.size(), 3);
+  EXPECT_TRUE(throttle::is_roughly_equal(currents.at(100).at(101), 4.0 / 3));
+
+  EXPECT_THROW(solved.update_edge(0, 3, 1, 0), std::invalid_argument);
+}
+
+TEST(test_resistor_network, test_reduction) {
+  const auto network = make_network(make_reducible(5, 6));
+
+  circuits::reduction_report unreduced, reduced, star_mesh;
+  const auto                 expected = network.solve({.reduce = false}, &unreduced);
+  expect_same(expected, network.solve({}, &reduced));
+  expect_same(expected, network.solve({.star_mesh = true}, &star_mesh));
+
+  EXPECT_EQ(unreduced.original_unknowns, unreduced.reduced_unknowns);
+  EXPECT_EQ(reduced.original_unknowns, unreduced.original_unknowns);
+  EXPECT_LT(reduced.reduced_unknowns, unreduced.reduced_unknowns);
+  EXPECT_LT(star_mesh.reduced_unknowns, reduced.reduced_unknowns);
+
+  // Node ids descend along the loop, so joined edges come out with their ends swapped and are turned around.
+  const auto loop = make_network({{9, 8, 1, 1}, {8, 7, 2, 0}, {7, 6, 1, 2}, {6, 5, 0, 1}, {5, 9, 3, 0}, {7, 9, 4, 1}});
+  expect_same(loop.solve({.reduce = false}), loop.solve());
+  expect_same(loop.solve({.reduce = false}), loop.solve({.star_mesh = true}));
+
+  // Trees have nothing left to solve.
+  auto tree = circuits::resistor_network{};
+  tree.insert(0, 1, 1, 2);
+  tree.insert(1, 2, 0, 1);
+  tree.insert(1, 3, 2, 0);
+  circuits::reduction_report tree_report;
+  const auto [potentials, currents] = tree.solve({}, &tree_report);
+  EXPECT_EQ(tree_report.reduced_unknowns, 0);
+  EXPECT_TRUE(throttle::is_roughly_equal(currents.at(1).at(2), 0.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(potentials.at(2) - potentials.at(1), 1.0));
+}
+
+TEST(test_resistor_network, test_singular_component) {
+  // Errors of components solved on other threads reach the caller.
+  auto network = make_network(make_reducible(3, 4));
+  network.insert(1000, 1001, 0, 1);
+  network.insert(1001, 1002, 0, 1);
+  network.insert(1002, 1000, 0, 1);
+  EXPECT_THROW(network.solve(), std::runtime_error);
+}
+
+TEST(test_resistor_network, test_circuit_graph) {
+  circuits::circuit_graph graph;
+  EXPECT_EQ(graph.insert(10, 5, 2, 3), 0);
+  EXPECT_EQ(graph.insert(10, 7, 1, 0), 1);
+  EXPECT_EQ(graph.insert(5, 7, 1, 0), 2);
+  EXPECT_THROW(graph.insert(7, 7, 1, 0), std::invalid_argument);
+
+  // Every edge goes from the smaller name, and nodes are numbered in the order they appear in edges.
+  EXPECT_EQ(graph.nodes(), 3);
+  EXPECT_EQ(graph.id(5), 0);
+  EXPECT_EQ(graph.id(6), circuits::circuit_graph::npos);
+  EXPECT_EQ(graph.edge(0).first, 0);
+  EXPECT_EQ(graph.edge(0).emf, -3);
+  EXPECT_EQ(graph.incident(0).size(), 2);
+  EXPECT_EQ(graph.find_named_edge(7, 5), 2);
+  EXPECT_EQ(graph.find_edge(graph.id(10), graph.id(5)), 0);
+
+  // The same network through the adapter.
+  auto network = circuits::resistor_network{};
+  network.insert(10, 5, 2, 3);
+  network.insert(10, 7, 1, 0);
+  network.insert(5, 7, 1, 0);
+  const auto expected = network.solve();
+
+  const auto solution = graph.solve();
+  for (unsigned i = 0; i < graph.nodes(); ++i) {
+    EXPECT_TRUE(throttle::is_roughly_equal(solution.potentials[i], expected.first.at(graph.name(i))));
+  }
+  for (std::size_t i = 0; i < graph.edges(); ++i) {
+    const auto &edge = graph.edge(i);
+    EXPECT_TRUE(throttle::is_roughly_equal(solution.currents[i],
+                                           expected.second.at(graph.name(edge.first)).at(graph.name(edge.second))));
+  }
+  EXPECT_TRUE(throttle::is_roughly_equal(solution.currents[0], -0.75));
+
+  // Parallel edges are found once adjacency is built.
+  graph.insert(7, 10, 1, 0);
+  EXPECT_THROW(graph.solve(), std::invalid_argument);
+}
+
+TEST(test_resistor_network, test_connected_components) {
+  const auto network = make_network(make_reducible(4, 3));
+  const auto components = network.connected_components();
+  ASSERT_EQ(components.size(), 4);
+
+  std::size_t nodes = 0;
+  for (const auto &comp : components) {
+    nodes += comp.size();
+    expect_same(comp.solve(), comp.solve({.reduce = false}));
+  }
+  EXPECT_EQ(nodes, network.core().nodes());
+}
@@ -0,0 +1,113 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* This file contains a lock-free Disjoint Set Union over dense indices 0, 1, ..., n - 1. Unlike disjoint_set_forest it
+ * can be used from many threads at once. Parent links are atomic and only ever change with compare-and-swap:
+ * 1. find_set uses path halving, every step tries to point a node to its grandparent. A failed CAS means that some other
+ *    thread has already shortened the path, so it's simply ignored.
+ * 2. union_set links the root with the smaller index under the root with the greater one. Links always go to greater
+ *    indices, so there can't be cycles, and a CAS on the parent of a root fails if the root has been linked meanwhile.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace throttle {
+
+class concurrent_disjoint_set_forest final {
+public:
+  using size_type = unsigned;
+
+private:
+  std::vector<std::atomic<size_type>> m_parent_vec;
+
+  size_type parent(size_type p_node) const { return m_parent_vec[p_node].load(std::memory_order_acquire); }
+
+public:
+  concurrent_disjoint_set_forest(size_type p_size = 0) : m_parent_vec(p_size) {
+    for (size_type i = 0; i < p_size; ++i) {
+      m_parent_vec[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  size_type size() const { return m_parent_vec.size(); }
+
+  size_type find_set(size_type p_node) {
+    if (p_node >= size()) throw std::out_of_range("Index is out of range");
+
+    size_type curr_parent = parent(p_node);
+    while (curr_parent != p_node) {
+      size_type grandparent = parent(curr_parent);
+      m_parent_vec[p_node].compare_exchange_weak(curr_parent, grandparent, std::memory_order_acq_rel);
+      p_node = grandparent;
+      curr_parent = parent(p_node);
+    }
+
+    return p_node;
+  }
+
+  // Returns true if two different sets have been merged by this call.
+  bool union_set(size_type p_left, size_type p_right) {
+    while (true) {
+      size_type left = find_set(p_left), right = find_set(p_right);
+      if (left == right) return false;
+      if (left > right) std::swap(left, right);
+
+      size_type expected = left;
+      if (m_parent_vec[left].compare_exchange_strong(expected, right, std::memory_order_acq_rel)) return true;
+    }
+  }
+
+  // A set is only merged into another one and never split, so two nodes are in different sets if the representative of
+  // one of them is still a root after the representative of the other has been found.
+  bool same_set(size_type p_left, size_type p_right) {
+    while (true) {
+      size_type left = find_set(p_left), right = find_set(p_right);
+      if (left == right) return true;
+      if (parent(left) == left) return false;
+    }
+  }
+};
+
+// Union endpoints of all edges in [p_start, p_finish) using up to p_threads threads. Edges are pairs of indices.
+template <typename t_rand_iter>
+void parallel_union(concurrent_disjoint_set_forest &p_dsu, t_rand_iter p_start, t_rand_iter p_finish,
+                    unsigned p_threads = std::thread::hardware_concurrency()) {
+  constexpr std::size_t min_edges_per_thread = 1 << 14;
+
+  const std::size_t count = std::distance(p_start, p_finish);
+  const std::size_t threads = std::clamp<std::size_t>(count / min_edges_per_thread, 1, std::max(p_threads, 1u));
+
+  auto worker = [&](std::size_t p_index) {
+    auto it = p_start + count * p_index / threads, end = p_start + count * (p_index + 1) / threads;
+    for (; it != end; ++it) {
+      p_dsu.union_set(it->first, it->second);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < threads; ++i) {
+    pool.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto &t : pool) {
+    t.join();
+  }
+}
+
+} // namespace throttle
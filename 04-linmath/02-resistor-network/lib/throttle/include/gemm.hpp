@@ -0,0 +1,193 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Matrix multiplication C += A * B for float and double, organized the same way as BLIS/GotoBLAS:
+ * 1. B is cut into blocks of kc rows and nc columns that fit in L3 and packed into panels of NR columns, so that the
+ *    microkernel reads them sequentially.
+ * 2. A is cut into blocks of mc rows and kc columns that fit in L2 and packed into panels of MR rows. Blocks of C rows
+ *    are independent, so they are distributed between threads of the pool, each one packing its own block of A.
+ * 3. The microkernel multiplies an MR x kc panel of A by a kc x NR panel of B. The MR x NR tile of C stays in
+ *    registers and the panel of B in L1. With AVX2 and FMA the tile is 6 x 16 floats or 6 x 8 doubles, which takes 12
+ *    of 16 vector registers, otherwise a plain loop is left to the compiler.
+ * Matrices are passed as arrays of row pointers, so rows don't have to be contiguous or in order.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#include "thread_pool.hpp"
+
+namespace throttle {
+namespace linmath {
+namespace detail {
+
+template <typename T>
+concept gemm_element = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template <gemm_element T> struct gemm_blocking {
+#if defined(__AVX2__) && defined(__FMA__)
+  static constexpr std::size_t mr = 6, nr = 64 / sizeof(T);
+#else
+  static constexpr std::size_t mr = 4, nr = 32 / sizeof(T);
+#endif
+  static constexpr std::size_t kc = 256, mc = mr * 16, nc = nr * 256;
+};
+
+// Panels of MR rows, each stored column by column. Rows past the end of A are zero.
+template <gemm_element T>
+void pack_a(const T *const *a, std::size_t m, std::size_t row, std::size_t mc, std::size_t col, std::size_t kc,
+            T *out) {
+  constexpr auto mr = gemm_blocking<T>::mr;
+  for (std::size_t i = 0; i < mc; i += mr) {
+    for (std::size_t p = 0; p < kc; ++p) {
+      for (std::size_t r = 0; r < mr; ++r) {
+        *out++ = (row + i + r < m ? a[row + i + r][col + p] : T{});
+      }
+    }
+  }
+}
+
+// Panels of NR columns, each stored row by row. Columns past the end of B are zero.
+template <gemm_element T>
+void pack_b_panel(const T *const *b, std::size_t n, std::size_t row, std::size_t kc, std::size_t col, T *out) {
+  constexpr auto nr = gemm_blocking<T>::nr;
+  const auto     width = std::min(nr, n - col);
+  for (std::size_t p = 0; p < kc; ++p) {
+    const T *b_row = b[row + p] + col;
+    std::copy(b_row, b_row + width, out);
+    std::fill(out + width, out + nr, T{});
+    out += nr;
+  }
+}
+
+// tile = a * b, where a is an MR x kc panel and b is a kc x NR panel. tile is MR x NR, row by row.
+template <gemm_element T> void microkernel(std::size_t kc, const T *a, const T *b, T *tile) {
+  constexpr auto mr = gemm_blocking<T>::mr, nr = gemm_blocking<T>::nr;
+
+#if defined(__AVX2__) && defined(__FMA__)
+  if constexpr (std::is_same_v<T, float>) {
+    __m256 c[mr][2];
+    for (std::size_t r = 0; r < mr; ++r) {
+      c[r][0] = c[r][1] = _mm256_setzero_ps();
+    }
+
+    for (std::size_t p = 0; p < kc; ++p, a += mr, b += nr) {
+      const __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+      // Accumulators have to stay in registers, which only happens if the loop is unrolled.
+#pragma GCC unroll 8
+      for (std::size_t r = 0; r < mr; ++r) {
+        const __m256 a_r = _mm256_broadcast_ss(a + r);
+        c[r][0] = _mm256_fmadd_ps(a_r, b0, c[r][0]);
+        c[r][1] = _mm256_fmadd_ps(a_r, b1, c[r][1]);
+      }
+    }
+
+    for (std::size_t r = 0; r < mr; ++r) {
+      _mm256_storeu_ps(tile + r * nr, c[r][0]);
+      _mm256_storeu_ps(tile + r * nr + 8, c[r][1]);
+    }
+  } else {
+    __m256d c[mr][2];
+    for (std::size_t r = 0; r < mr; ++r) {
+      c[r][0] = c[r][1] = _mm256_setzero_pd();
+    }
+
+    for (std::size_t p = 0; p < kc; ++p, a += mr, b += nr) {
+      const __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+      // Accumulators have to stay in registers, which only happens if the loop is unrolled.
+#pragma GCC unroll 8
+      for (std::size_t r = 0; r < mr; ++r) {
+        const __m256d a_r = _mm256_broadcast_sd(a + r);
+        c[r][0] = _mm256_fmadd_pd(a_r, b0, c[r][0]);
+        c[r][1] = _mm256_fmadd_pd(a_r, b1, c[r][1]);
+      }
+    }
+
+    for (std::size_t r = 0; r < mr; ++r) {
+      _mm256_storeu_pd(tile + r * nr, c[r][0]);
+      _mm256_storeu_pd(tile + r * nr + 4, c[r][1]);
+    }
+  }
+#else
+  T c[mr][nr] = {};
+  for (std::size_t p = 0; p < kc; ++p, a += mr, b += nr) {
+    for (std::size_t r = 0; r < mr; ++r) {
+      for (std::size_t j = 0; j < nr; ++j) {
+        c[r][j] += a[r] * b[j];
+      }
+    }
+  }
+
+  for (std::size_t r = 0; r < mr; ++r) {
+    std::copy(c[r], c[r] + nr, tile + r * nr);
+  }
+#endif
+}
+
+} // namespace detail
+
+// C += A * B, where A is m x k, B is k x n and C is m x n. a, b and c hold pointers to the rows of the matrices.
+template <detail::gemm_element T>
+void gemm(std::size_t m, std::size_t n, std::size_t k, const T *const *a, const T *const *b, T *const *c,
+          utility::thread_pool &pool = utility::default_thread_pool()) {
+  using blocking = detail::gemm_blocking<T>;
+  constexpr auto mr = blocking::mr, nr = blocking::nr, kc_max = blocking::kc, mc_max = blocking::mc,
+                 nc_max = blocking::nc;
+
+  std::vector<T> packed_b;
+  for (std::size_t jc = 0; jc < n; jc += nc_max) {
+    const auto nc = std::min(nc_max, n - jc), b_panels = (nc + nr - 1) / nr;
+
+    for (std::size_t pc = 0; pc < k; pc += kc_max) {
+      const auto kc = std::min(kc_max, k - pc);
+
+      packed_b.resize(b_panels * nr * kc);
+      pool.parallel_for(b_panels, [&](std::size_t panel) {
+        detail::pack_b_panel(b, n, pc, kc, jc + panel * nr, packed_b.data() + panel * nr * kc);
+      });
+
+      pool.parallel_for((m + mc_max - 1) / mc_max, [&](std::size_t block) {
+        const auto ic = block * mc_max, mc = std::min(mc_max, m - ic), a_panels = (mc + mr - 1) / mr;
+
+        thread_local std::vector<T> packed_a;
+        packed_a.resize(a_panels * mr * kc);
+        detail::pack_a(a, m, ic, a_panels * mr, pc, kc, packed_a.data());
+
+        T tile[mr * nr];
+        for (std::size_t jr = 0; jr < b_panels; ++jr) {
+          for (std::size_t ir = 0; ir < a_panels; ++ir) {
+            detail::microkernel(kc, packed_a.data() + ir * mr * kc, packed_b.data() + jr * nr * kc, tile);
+
+            const auto row = ic + ir * mr, col = jc + jr * nr;
+            const auto rows = std::min(mr, m - row), cols = std::min(nr, n - col);
+            for (std::size_t r = 0; r < rows; ++r) {
+              T *c_row = c[row + r] + col;
+              for (std::size_t j = 0; j < cols; ++j) {
+                c_row[j] += tile[r * nr + j];
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+}
+
+} // namespace linmath
+} // namespace throttle
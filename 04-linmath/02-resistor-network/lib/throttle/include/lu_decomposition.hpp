@@ -0,0 +1,134 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* PA = LU factorization with partial pivoting, computed once and reused for any number of right-hand sides. The blocked
+ * factorization itself is in lu_kernel.hpp, which matrix::determinant() uses as well.
+ *
+ */
+
+#pragma once
+
+#include "lu_kernel.hpp"
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace throttle::linmath {
+
+template <std::floating_point T> class lu_decomposition {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  static constexpr size_type block_size = detail::lu_block_size;
+
+private:
+  contiguous_matrix<T>   m_lu;   // Pivoted rows. L is below the diagonal with implicit ones on it, U is above.
+  std::vector<size_type> m_perm; // Row i of m_lu comes from row m_perm[i] of the decomposed matrix.
+  int                    m_sign = 1;
+
+public:
+  explicit lu_decomposition(const matrix<T> &mat) : m_lu{mat.rows(), mat.cols()}, m_perm(mat.rows()) {
+    if (!mat.square()) throw std::runtime_error("Mismatched matrix size for LU decomposition");
+
+    const auto size = mat.rows();
+    // Rows are swapped through pointers while factoring and put in order at the end.
+    contiguous_matrix<T> work{size, size};
+    std::vector<T *>     rows(size);
+    for (size_type i = 0; i < size; ++i) {
+      const auto row = mat[i];
+      std::copy(row.begin(), row.end(), work[i].begin());
+      rows[i] = work.data() + i * size;
+      m_perm[i] = i;
+    }
+
+    m_sign = detail::lu_factor(rows, m_perm);
+
+    for (size_type i = 0; i < size; ++i) {
+      std::copy(rows[i], rows[i] + size, m_lu[i].begin());
+    }
+  }
+
+  size_type size() const { return m_lu.rows(); }
+
+  // Same criterion as row echelon based solving used: a roughly zero pivot makes the matrix singular.
+  bool singular() const {
+    for (size_type i = 0; i < size(); ++i) {
+      if (is_roughly_equal(m_lu[i][i], T{})) return true;
+    }
+    return false;
+  }
+
+  value_type determinant() const {
+    value_type val = m_sign;
+    for (size_type i = 0; i < size(); ++i) {
+      val *= m_lu[i][i];
+    }
+    return val;
+  }
+
+  // Solves A * X = B for all columns of B at once.
+  matrix<T> solve(const matrix<T> &rhs) const {
+    if (rhs.rows() != size()) throw std::runtime_error("Mismatched matrix sizes");
+    if (singular()) throw std::runtime_error("Singular matrix provided");
+
+    const auto size = this->size();
+    matrix<T>  res{size, rhs.cols()};
+    for (size_type i = 0; i < size; ++i) {
+      const auto row = rhs[m_perm[i]];
+      std::copy(row.begin(), row.end(), res[i].begin());
+    }
+
+    const auto eliminate = [&res](size_type row, size_type pivot_row, T coef) {
+      if (coef == T{}) return;
+      auto first = res[row];
+      auto second = res[pivot_row];
+      std::transform(first.begin(), first.end(), second.begin(), first.begin(),
+                     [coef](T left, T right) { return left - coef * right; });
+    };
+
+    for (size_type i = 1; i < size; ++i) {
+      for (size_type p = 0; p < i; ++p) {
+        eliminate(i, p, m_lu[i][p]);
+      }
+    }
+
+    for (size_type i = size; i-- > 0;) {
+      for (size_type p = i + 1; p < size; ++p) {
+        eliminate(i, p, m_lu[i][p]);
+      }
+      const T diag = m_lu[i][i];
+      for (auto &val : res[i]) {
+        val /= diag;
+      }
+    }
+
+    return res;
+  }
+
+  std::vector<T> solve(const std::vector<T> &rhs) const {
+    const auto     col = solve(matrix<T>{rhs.size(), 1, rhs.begin(), rhs.end()});
+    std::vector<T> res(col.rows());
+    for (size_type i = 0; i < col.rows(); ++i) {
+      res[i] = col[i][0];
+    }
+    return res;
+  }
+
+  matrix<T> inverse() const { return solve(matrix<T>::unity(size())); }
+};
+
+} // namespace throttle::linmath
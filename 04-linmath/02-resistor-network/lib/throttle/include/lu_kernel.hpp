@@ -0,0 +1,133 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* In-place PA = LU factorization with partial pivoting, shared by matrix::determinant() and lu_decomposition.
+ * The right-looking blocked algorithm processes lu_block_size columns at a time:
+ * 1. The panel of the current columns is eliminated column by column. Pivot rows are swapped whole, so the permutation
+ *    is applied to the already computed part of L and to the trailing columns as well.
+ * 2. The rows of the panel to the right of it are multiplied by the inverse of its unit lower triangle, giving U12.
+ * 3. The trailing submatrix is updated as A22 -= L21 * U12. This takes almost all of the O(n^3) work and goes to gemm
+ *    for float and double.
+ * The matrix is passed as an array of row pointers, so pivoting only swaps pointers.
+ *
+ */
+
+#pragma once
+
+#include "gemm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace throttle::linmath::detail {
+
+inline constexpr std::size_t lu_block_size = 64;
+
+// c -= a * b, where a is m x k, b is k x n and c is m x n, all given by row pointers.
+template <std::floating_point T>
+void lu_subtract_product(std::size_t m, std::size_t n, std::size_t k, const T *const *a, const T *const *b,
+                         T *const *c) {
+  if constexpr (gemm_element<T>) {
+    // gemm only accumulates, so a is negated into a temporary block.
+    std::vector<T>         neg_a(m * k);
+    std::vector<const T *> neg_rows(m);
+    for (std::size_t i = 0; i < m; ++i) {
+      neg_rows[i] = neg_a.data() + i * k;
+      std::transform(a[i], a[i] + k, neg_a.data() + i * k, [](T val) { return -val; });
+    }
+    gemm(m, n, k, neg_rows.data(), b, c);
+  } else {
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t p = 0; p < k; ++p) {
+        const T coef = a[i][p];
+        for (std::size_t j = 0; j < n; ++j) {
+          c[i][j] -= coef * b[p][j];
+        }
+      }
+    }
+  }
+}
+
+// Unblocked elimination of columns [col, col + width) below the diagonal. Returns the sign of the row swaps.
+template <std::floating_point T>
+int lu_factor_panel(std::vector<T *> &rows, std::vector<std::size_t> &perm, std::size_t col, std::size_t width) {
+  const auto size = rows.size(), past_col = col + width;
+  int        sign = 1;
+
+  for (std::size_t j = col; j < past_col; ++j) {
+    std::size_t pivot = j;
+    for (std::size_t i = j + 1; i < size; ++i) {
+      if (std::abs(rows[pivot][j]) < std::abs(rows[i][j])) pivot = i;
+    }
+
+    if (pivot != j) {
+      std::swap(rows[j], rows[pivot]);
+      std::swap(perm[j], perm[pivot]);
+      sign = -sign;
+    }
+
+    const T pivot_elem = rows[j][j];
+    if (pivot_elem == T{}) continue; // The column is already zero below the diagonal.
+
+    for (std::size_t i = j + 1; i < size; ++i) {
+      const T coef = (rows[i][j] /= pivot_elem);
+      for (std::size_t c = j + 1; c < past_col; ++c) {
+        rows[i][c] -= coef * rows[j][c];
+      }
+    }
+  }
+
+  return sign;
+}
+
+// Factors the square matrix with the given rows in place and returns the sign of the permutation. Afterwards rows[i]
+// holds row perm[i] of the original matrix, L is below its diagonal with implicit ones on it and U is above.
+template <std::floating_point T> int lu_factor(std::vector<T *> &rows, std::vector<std::size_t> &perm) {
+  const auto size = rows.size();
+  int        sign = 1;
+
+  std::vector<const T *> l21, u12;
+  std::vector<T *>       a22;
+
+  for (std::size_t k = 0; k < size; k += lu_block_size) {
+    const auto width = std::min(lu_block_size, size - k), next = k + width, rest = size - next;
+    sign *= lu_factor_panel(rows, perm, k, width);
+    if (!rest) break;
+
+    for (std::size_t j = k; j < next; ++j) {
+      for (std::size_t i = j + 1; i < next; ++i) {
+        const T coef = rows[i][j];
+        for (std::size_t c = next; c < size; ++c) {
+          rows[i][c] -= coef * rows[j][c];
+        }
+      }
+    }
+
+    l21.resize(rest);
+    a22.resize(rest);
+    u12.resize(width);
+    for (std::size_t i = 0; i < rest; ++i) {
+      l21[i] = rows[next + i] + k;
+      a22[i] = rows[next + i] + next;
+    }
+    for (std::size_t p = 0; p < width; ++p) {
+      u12[p] = rows[k + p] + next;
+    }
+    lu_subtract_product(rest, rest, width, l21.data(), u12.data(), a22.data());
+  }
+
+  return sign;
+}
+
+} // namespace throttle::linmath::detail
@@ -12,6 +12,8 @@
 
 #include "contiguous_matrix.hpp"
 #include "equal.hpp"
+#include "gemm.hpp"
+#include "lu_kernel.hpp"
 #include "utility.hpp"
 
 #include <algorithm>
@@ -26,6 +28,7 @@
 #include <optional>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace throttle::linmath {
 
@@ -250,15 +253,19 @@ public:
   value_type determinant() const requires std::is_floating_point_v<value_type> {
     if (!square()) throw std::runtime_error("Mismatched matrix size for determinant");
 
-    matrix tmp{*this};
-    auto   res = tmp.convert_to_row_echelon();
-    if (!res) return value_type{};
-
-    value_type val = res.value();
-    for (size_type i = 0; i < rows(); i++) {
-      val *= tmp[i][i];
+    // Blocked PA = LU on a copy, the determinant is the product of the diagonal of U with the sign of P.
+    contiguous_matrix<value_type> work = m_contiguous_matrix;
+    std::vector<pointer>          work_rows(rows());
+    std::vector<size_type>        perm(rows());
+    for (size_type i = 0; i < rows(); ++i) {
+      work_rows[i] = work.data() + i * cols();
+      perm[i] = i;
     }
 
+    value_type val = detail::lu_factor(work_rows, perm);
+    for (size_type i = 0; i < rows(); ++i) {
+      val *= work_rows[i][i];
+    }
     return val;
   }
 
@@ -297,6 +304,14 @@ public:
   matrix &operator*=(const matrix &rhs) {
     if (cols() != rhs.rows()) throw std::runtime_error("Mismatched matrix sizes");
 
+    // float and double go to the blocked multithreaded kernel, other rings use plain dot products.
+    if constexpr (detail::gemm_element<value_type>) {
+      matrix res{rows(), rhs.cols()};
+      gemm(rows(), rhs.cols(), cols(), m_rows_vec.data(), rhs.m_rows_vec.data(), res.m_rows_vec.data());
+      std::swap(*this, res);
+      return *this;
+    }
+
     matrix res{rows(), rhs.cols()}, t_rhs = rhs;
     t_rhs.transpose();
 
@@ -332,4 +347,4 @@ template <typename T> matrix<T> transpose(const matrix<T> &mat) { auto res = mat
 using matrix_d = matrix<double>;
 using matrix_f = matrix<float>;
 
-} // namespace throttle::linmath
\ No newline at end of file
+} // namespace throttle::linmath
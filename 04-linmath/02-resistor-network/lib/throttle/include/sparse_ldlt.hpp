@@ -0,0 +1,715 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Sparse LDL^T factorization of symmetric matrices, split into two phases:
+ * 1. Symbolic analysis only looks at the structure. It finds an approximate minimum degree ordering, postorders the
+ *    elimination tree, counts non-zeros in columns of L and groups columns with nearly the same structure into
+ *    supernodes. It also remembers where every element of the matrix goes in the factor, so that the analysis is
+ *    reused for any matrix with the same structure.
+ * 2. Numeric factorization goes over supernodes left to right. The columns of a supernode are factored as a dense
+ *    block, then their contribution L * D * L^T is added to the supernodes to the right. Large products go to gemm.
+ * Matrices of modified nodal analysis are indefinite and may have zero pivots, for example at a node that only has
+ * short circuits. Pivots that are too small are replaced with a small value of the same sign (static pivoting), and
+ * solve() makes up for it with iterative refinement.
+ *
+ */
+
+#pragma once
+
+#include "gemm.hpp"
+#include "sparse_matrix.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace throttle::linmath {
+
+// Approximate minimum degree ordering (Amestoy, Davis and Duff) of a square matrix, whose structure is symmetrized
+// first. Eliminated variables are kept in a quotient graph as elements, cliques of their neighbours, so the graph never
+// grows. Degrees are upper bounds computed from sizes of adjacent elements. Returns order[i], the index of the row and
+// column that should be eliminated i-th.
+// Variables without a diagonal element, like currents through voltage sources, would have zero pivots if they came
+// first. They wait until one of their neighbours is eliminated, which makes the diagonal element non-zero.
+template <typename T> std::vector<std::size_t> approximate_minimum_degree(const sparse_matrix<T> &mat) {
+  using size_type = std::size_t;
+  if (!mat.square()) throw std::runtime_error("Mismatched matrix sizes");
+
+  const auto size = mat.rows();
+
+  std::vector<std::vector<size_type>> vars(size), elems(size), elem_vars(size);
+  std::vector<bool>                   waiting(size, true);
+  for (size_type i = 0; i < size; ++i) {
+    for (auto col : mat.row_cols(i)) {
+      if (col == i) {
+        waiting[i] = false;
+        continue;
+      }
+      vars[i].push_back(col);
+      vars[col].push_back(i);
+    }
+  }
+
+  // Variables with the same degree are kept in doubly linked lists.
+  constexpr auto         npos = std::numeric_limits<size_type>::max();
+  std::vector<size_type> degree(size), head(size, npos), next(size), prev(size);
+  size_type              min_degree = 0;
+
+  const auto push = [&](size_type var) {
+    const auto d = degree[var];
+    next[var] = head[d];
+    prev[var] = npos;
+    if (head[d] != npos) prev[head[d]] = var;
+    head[d] = var;
+    min_degree = std::min(min_degree, d);
+  };
+
+  const auto remove = [&](size_type var) {
+    (prev[var] == npos ? head[degree[var]] : next[prev[var]]) = next[var];
+    if (next[var] != npos) prev[next[var]] = prev[var];
+  };
+
+  for (size_type i = 0; i < size; ++i) {
+    std::sort(vars[i].begin(), vars[i].end());
+    vars[i].erase(std::unique(vars[i].begin(), vars[i].end()), vars[i].end());
+    degree[i] = vars[i].size();
+    if (!waiting[i]) push(i);
+  }
+
+  std::vector<bool>      eliminated(size), absorbed(size);
+  std::vector<size_type> mark(size), weight_mark(size), weight(size), order, pivot_vars;
+  size_type              next_waiting = 0;
+  order.reserve(size);
+
+  for (size_type stamp = 1; order.size() < size; ++stamp) {
+    while (min_degree < size && head[min_degree] == npos) {
+      ++min_degree;
+    }
+
+    // Only waiting variables connected to each other are left, one of them gets a zero pivot anyway.
+    if (min_degree == size) {
+      while (!waiting[next_waiting]) {
+        ++next_waiting;
+      }
+      waiting[next_waiting] = false;
+      push(next_waiting);
+    }
+
+    const auto pivot = head[min_degree];
+    remove(pivot);
+
+    eliminated[pivot] = true;
+    order.push_back(pivot);
+
+    // Variables adjacent to the pivot directly or through its elements form the new element, which absorbs the old.
+    pivot_vars.clear();
+    const auto add_var = [&](size_type var) {
+      if (eliminated[var] || mark[var] == stamp) return;
+      mark[var] = stamp;
+      pivot_vars.push_back(var);
+    };
+
+    for (auto var : vars[pivot]) {
+      add_var(var);
+    }
+    for (auto elem : elems[pivot]) {
+      for (auto var : elem_vars[elem]) {
+        add_var(var);
+      }
+      absorbed[elem] = true;
+      elem_vars[elem] = {};
+    }
+
+    vars[pivot] = {};
+    elems[pivot] = {};
+    elem_vars[pivot] = pivot_vars;
+
+    // weight[e] = |L_e \ L_p| for every element e that shares variables with the new one.
+    for (auto var : pivot_vars) {
+      for (auto elem : elems[var]) {
+        if (absorbed[elem]) continue;
+        if (weight_mark[elem] != stamp) {
+          weight_mark[elem] = stamp;
+          weight[elem] = elem_vars[elem].size();
+        }
+        --weight[elem];
+      }
+    }
+
+    const auto remaining = size - order.size();
+    for (auto var : pivot_vars) {
+      // Variables of the new element are adjacent through it now. Elements that are inside of it are absorbed too.
+      std::erase_if(vars[var], [&](size_type other) { return (eliminated[other] || mark[other] == stamp); });
+      std::erase_if(elems[var], [&](size_type elem) {
+        if (!absorbed[elem] && weight[elem] == 0) {
+          absorbed[elem] = true;
+          elem_vars[elem] = {};
+        }
+        return absorbed[elem];
+      });
+
+      size_type var_degree = vars[var].size() + pivot_vars.size() - 1;
+      for (auto elem : elems[var]) {
+        var_degree += weight[elem];
+      }
+      elems[var].push_back(pivot);
+
+      if (waiting[var]) {
+        waiting[var] = false;
+      } else {
+        remove(var);
+      }
+      degree[var] = std::min(var_degree, remaining - 1);
+      push(var);
+    }
+  }
+
+  return order;
+}
+
+class sparse_ldlt_symbolic {
+public:
+  using size_type = std::size_t;
+  static constexpr size_type npos = std::numeric_limits<size_type>::max();
+  // Supernodes up to this width are merged with their parents regardless of the number of zeros.
+  static constexpr size_type max_relaxed_width = 4;
+
+private:
+  size_type              m_size = 0;
+  std::vector<size_type> m_row_ptr, m_col_idx; // Structure of the analysed matrix.
+  std::vector<size_type> m_order;              // Row and column m_order[i] of the matrix are eliminated i-th.
+  std::vector<size_type> m_super_ptr;          // Supernode s has columns [m_super_ptr[s], m_super_ptr[s + 1]).
+  std::vector<size_type> m_super_of;           // Supernode of every column.
+  std::vector<size_type> m_rows_ptr, m_rows;   // Rows of every supernode below its diagonal block, sorted.
+  std::vector<size_type> m_block_ptr;          // Offset of the dense block of every supernode in factor storage.
+  std::vector<size_type> m_value_dest;         // Offset in factor storage for every stored element, npos if above the
+                                               // diagonal after permutation.
+
+  // Lower triangle of the symmetrized and permuted structure by rows, and its elimination tree.
+  struct permuted_structure {
+    std::vector<std::vector<size_type>> lower;
+    std::vector<size_type>              parent;
+  };
+
+  template <typename T> permuted_structure permute(const sparse_matrix<T> &mat) const {
+    std::vector<size_type> position(m_size);
+    for (size_type i = 0; i < m_size; ++i) {
+      position[m_order[i]] = i;
+    }
+
+    permuted_structure res{std::vector<std::vector<size_type>>(m_size), std::vector<size_type>(m_size, npos)};
+    for (size_type r = 0; r < m_size; ++r) {
+      for (auto c : mat.row_cols(r)) {
+        const auto i = position[r], j = position[c];
+        if (i != j) res.lower[std::max(i, j)].push_back(std::min(i, j));
+      }
+    }
+
+    // Liu's algorithm, ancestors are path compressed.
+    std::vector<size_type> ancestor(m_size, npos);
+    for (size_type i = 0; i < m_size; ++i) {
+      auto &row = res.lower[i];
+      std::sort(row.begin(), row.end());
+      row.erase(std::unique(row.begin(), row.end()), row.end());
+
+      for (auto k : row) {
+        while (ancestor[k] != npos && ancestor[k] != i) {
+          k = std::exchange(ancestor[k], i);
+        }
+        if (ancestor[k] == npos) {
+          ancestor[k] = i;
+          res.parent[k] = i;
+        }
+      }
+    }
+
+    return res;
+  }
+
+  // Calls visit(k) for every k < i, such that L[i][k] is not zero. These are the nodes of the elimination tree on paths
+  // from the elements of row i of the matrix up to i.
+  template <typename F>
+  static void row_pattern(const permuted_structure &structure, size_type i, std::vector<size_type> &mark, F visit) {
+    mark[i] = i;
+    for (auto k : structure.lower[i]) {
+      for (; mark[k] != i; k = structure.parent[k]) {
+        mark[k] = i;
+        visit(k);
+      }
+    }
+  }
+
+public:
+  template <typename T> explicit sparse_ldlt_symbolic(const sparse_matrix<T> &mat) : m_size{mat.rows()} {
+    if (!mat.square()) throw std::runtime_error("Mismatched matrix sizes");
+
+    m_row_ptr.reserve(m_size + 1);
+    m_row_ptr.push_back(0);
+    for (size_type i = 0; i < m_size; ++i) {
+      const auto cols = mat.row_cols(i);
+      m_col_idx.insert(m_col_idx.end(), cols.begin(), cols.end());
+      m_row_ptr.push_back(m_col_idx.size());
+    }
+
+    // Postordering doesn't change the fill-in, but puts chains of the elimination tree next to each other, so that
+    // they form supernodes.
+    m_order = approximate_minimum_degree(mat);
+    {
+      const auto                          structure = permute(mat);
+      std::vector<std::vector<size_type>> children(m_size);
+      std::vector<size_type>              roots;
+      for (size_type i = 0; i < m_size; ++i) {
+        (structure.parent[i] == npos ? roots : children[structure.parent[i]]).push_back(i);
+      }
+
+      std::vector<size_type>                      postorder;
+      std::vector<std::pair<size_type, size_type>> stack; // Node and the number of its visited children.
+      postorder.reserve(m_size);
+      for (auto root : roots) {
+        stack.push_back({root, 0});
+        while (!stack.empty()) {
+          auto &[node, visited] = stack.back();
+          if (visited < children[node].size()) {
+            stack.push_back({children[node][visited++], 0});
+            continue;
+          }
+          postorder.push_back(node);
+          stack.pop_back();
+        }
+      }
+
+      std::vector<size_type> order(m_size);
+      for (size_type i = 0; i < m_size; ++i) {
+        order[i] = m_order[postorder[i]];
+      }
+      m_order = std::move(order);
+    }
+
+    const auto structure = permute(mat);
+
+    std::vector<size_type> mark(m_size, npos), col_count(m_size), child_count(m_size);
+    for (size_type i = 0; i < m_size; ++i) {
+      row_pattern(structure, i, mark, [&col_count](size_type k) { ++col_count[k]; });
+      if (structure.parent[i] != npos) ++child_count[structure.parent[i]];
+    }
+
+    // Fundamental supernodes: a column joins the previous one if it's its only child and has the same structure.
+    std::vector<size_type> fundamental_ptr, fundamental_of(m_size);
+    for (size_type j = 0; j < m_size; ++j) {
+      const bool joins = (j > 0 && structure.parent[j - 1] == j && child_count[j] == 1 &&
+                          col_count[j - 1] == col_count[j] + 1);
+      if (!joins) fundamental_ptr.push_back(j);
+      fundamental_of[j] = fundamental_ptr.size() - 1;
+    }
+    fundamental_ptr.push_back(m_size);
+
+    const auto                          fundamentals = fundamental_ptr.size() - 1;
+    std::vector<std::vector<size_type>> rows(fundamentals);
+    std::fill(mark.begin(), mark.end(), npos);
+    for (size_type i = 0; i < m_size; ++i) {
+      row_pattern(structure, i, mark, [&](size_type k) {
+        const auto s = fundamental_of[k];
+        if (k == fundamental_ptr[s] && i >= fundamental_ptr[s + 1]) rows[s].push_back(i);
+      });
+    }
+
+    // Relaxed amalgamation. Rows of a supernode are a subset of the columns and rows of its parent, so a child that
+    // comes right before the parent is merged by padding its columns with zeros. Wider supernodes do more of the work
+    // in dense loops, this is worth it while zeros stay a small part of the block.
+    std::vector<size_type> head(fundamentals), first(fundamentals), non_zeros(fundamentals);
+    for (size_type s = fundamentals; s-- > 0;) {
+      head[s] = s;
+      first[s] = fundamental_ptr[s];
+      for (auto j = fundamental_ptr[s]; j < fundamental_ptr[s + 1]; ++j) {
+        non_zeros[s] += col_count[j] + 1;
+      }
+      if (rows[s].empty()) continue;
+
+      const auto p = head[fundamental_of[rows[s].front()]];
+      if (first[p] != fundamental_ptr[s + 1]) continue;
+
+      const auto width = fundamental_ptr[p + 1] - fundamental_ptr[s];
+      const auto dense = width * (width + 1) / 2 + width * rows[p].size(), merged = non_zeros[p] + non_zeros[s];
+      if (width > max_relaxed_width && (dense - merged) * 10 > dense) continue;
+
+      head[s] = p;
+      first[p] = fundamental_ptr[s];
+      non_zeros[p] = merged;
+    }
+
+    m_super_of.resize(m_size);
+    m_rows_ptr.push_back(0);
+    m_block_ptr.push_back(0);
+    for (size_type s = 0; s < fundamentals; ++s) {
+      if (head[s] != s) continue;
+      const auto width = fundamental_ptr[s + 1] - first[s];
+      std::fill(m_super_of.begin() + first[s], m_super_of.begin() + fundamental_ptr[s + 1], m_super_ptr.size());
+      m_super_ptr.push_back(first[s]);
+      m_rows.insert(m_rows.end(), rows[s].begin(), rows[s].end());
+      m_rows_ptr.push_back(m_rows.size());
+      m_block_ptr.push_back(m_block_ptr.back() + (width + rows[s].size()) * width);
+    }
+    m_super_ptr.push_back(m_size);
+
+    std::vector<size_type> position(m_size);
+    for (size_type i = 0; i < m_size; ++i) {
+      position[m_order[i]] = i;
+    }
+
+    m_value_dest.reserve(m_col_idx.size());
+    for (size_type r = 0; r < m_size; ++r) {
+      for (size_type k = m_row_ptr[r]; k < m_row_ptr[r + 1]; ++k) {
+        const auto i = position[r], j = position[m_col_idx[k]];
+        m_value_dest.push_back(i < j ? npos : offset(i, j));
+      }
+    }
+  }
+
+  // Whether mat has exactly the structure that was analysed.
+  template <typename T> bool matches(const sparse_matrix<T> &mat) const {
+    if (mat.rows() != m_size || mat.cols() != m_size || mat.non_zeros() != m_col_idx.size()) return false;
+    for (size_type i = 0; i < m_size; ++i) {
+      const auto cols = mat.row_cols(i);
+      if (!std::equal(cols.begin(), cols.end(), m_col_idx.begin() + m_row_ptr[i], m_col_idx.begin() + m_row_ptr[i + 1]))
+        return false;
+    }
+    return true;
+  }
+
+  size_type size() const { return m_size; }
+  size_type supernodes() const { return m_super_ptr.size() - 1; }
+  size_type factor_size() const { return m_block_ptr.back(); }
+
+  const std::vector<size_type> &order() const { return m_order; }
+  const std::vector<size_type> &value_dest() const { return m_value_dest; }
+
+  size_type first_col(size_type s) const { return m_super_ptr[s]; }
+  size_type width(size_type s) const { return m_super_ptr[s + 1] - m_super_ptr[s]; }
+  size_type supernode_of(size_type col) const { return m_super_of[col]; }
+  size_type block_offset(size_type s) const { return m_block_ptr[s]; }
+
+  const size_type *rows_begin(size_type s) const { return m_rows.data() + m_rows_ptr[s]; }
+  const size_type *rows_end(size_type s) const { return m_rows.data() + m_rows_ptr[s + 1]; }
+
+  // Offset of L[i][j] in factor storage, i >= j in permuted numbering.
+  size_type offset(size_type i, size_type j) const {
+    const auto s = m_super_of[j], first = m_super_ptr[s], last = m_super_ptr[s + 1], w = last - first;
+    const auto local = (i < last ? i - first : w + (std::lower_bound(rows_begin(s), rows_end(s), i) - rows_begin(s)));
+    return m_block_ptr[s] + local * w + (j - first);
+  }
+};
+
+template <std::floating_point T> class sparse_ldlt {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  // Columns of a supernode are factored in panels of block_size, so that updates from the previous panels go to gemm.
+  static constexpr size_type block_size = 64;
+  // Largest number of multiplications in a product that is done without gemm.
+  static constexpr size_type small_product = 1 << 15;
+
+private:
+  std::shared_ptr<const sparse_ldlt_symbolic> m_symbolic;
+  sparse_matrix<T>                            m_matrix; // Kept for iterative refinement.
+  std::vector<T>                              m_blocks; // Dense row-major blocks of supernodes.
+  std::vector<T>                              m_diag;
+  size_type                                   m_perturbed = 0;
+
+  // c[i][j] -= sum of a[i][p] * diag[p] * b[j][p], where a is m x k, b is n x k and c is m x n. All are row-major with
+  // the given distances between rows.
+  static void subtract_scaled_product(size_type m, size_type n, size_type k, const T *a, size_type lda, const T *b,
+                                      size_type ldb, const T *diag, T *c, size_type ldc) {
+    if (!m || !n || !k) return;
+
+    if constexpr (detail::gemm_element<T>) {
+      if (m * n * k > small_product) {
+        // gemm only accumulates, so the scaled and transposed b is negated.
+        std::vector<T> scaled(k * n);
+        for (size_type j = 0; j < n; ++j) {
+          for (size_type p = 0; p < k; ++p) {
+            scaled[p * n + j] = -diag[p] * b[j * ldb + p];
+          }
+        }
+
+        std::vector<const T *> a_rows(m), scaled_rows(k);
+        std::vector<T *>       c_rows(m);
+        for (size_type i = 0; i < m; ++i) {
+          a_rows[i] = a + i * lda;
+          c_rows[i] = c + i * ldc;
+        }
+        for (size_type p = 0; p < k; ++p) {
+          scaled_rows[p] = scaled.data() + p * n;
+        }
+        gemm(m, n, k, a_rows.data(), scaled_rows.data(), c_rows.data());
+        return;
+      }
+    }
+
+    std::vector<T> scaled(k);
+    for (size_type j = 0; j < n; ++j) {
+      for (size_type p = 0; p < k; ++p) {
+        scaled[p] = diag[p] * b[j * ldb + p];
+      }
+      for (size_type i = 0; i < m; ++i) {
+        const T *a_row = a + i * lda;
+        T        sum{};
+        for (size_type p = 0; p < k; ++p) {
+          sum += a_row[p] * scaled[p];
+        }
+        c[i * ldc + j] -= sum;
+      }
+    }
+  }
+
+  // Dense LDL^T of the columns of a supernode, block has height rows and w columns. Panels are factored left-looking:
+  // first the previous panels are subtracted with one product, then the columns of the panel are eliminated one by one.
+  void factor_block(T *block, size_type height, size_type w, T *diag, T delta) {
+    for (size_type j0 = 0; j0 < w; j0 += block_size) {
+      const auto j1 = std::min(w, j0 + block_size);
+      subtract_scaled_product(height - j0, j1 - j0, j0, block + j0 * w, w, block + j0 * w, w, diag, block + j0 * w + j0,
+                              w);
+
+      for (size_type j = j0; j < j1; ++j) {
+        T *row_j = block + j * w;
+        T  d = row_j[j];
+        for (size_type k = j0; k < j; ++k) {
+          d -= row_j[k] * row_j[k] * diag[k];
+        }
+        if (std::abs(d) < delta) {
+          d = (d < T{} ? -delta : delta);
+          ++m_perturbed;
+        }
+        diag[j] = d;
+
+        for (size_type i = j + 1; i < height; ++i) {
+          T *row_i = block + i * w;
+          T  val = row_i[j];
+          for (size_type k = j0; k < j; ++k) {
+            val -= row_i[k] * diag[k] * row_j[k];
+          }
+          row_i[j] = val / d;
+        }
+      }
+    }
+  }
+
+  void factorize() {
+    const auto &sym = *m_symbolic;
+    m_blocks.assign(sym.factor_size(), T{});
+    m_diag.assign(sym.size(), T{});
+
+    T max_abs{};
+    for (size_type i = 0, k = 0; i < m_matrix.rows(); ++i) {
+      for (auto val : m_matrix.row_values(i)) {
+        const auto dest = sym.value_dest()[k++];
+        if (dest == sparse_ldlt_symbolic::npos) continue;
+        m_blocks[dest] += val;
+        max_abs = std::max(max_abs, std::abs(val));
+      }
+    }
+
+    const T delta = std::sqrt(std::numeric_limits<T>::epsilon()) * (max_abs == T{} ? T{1} : max_abs);
+
+    std::vector<T>         update;
+    std::vector<size_type> local;
+
+    for (size_type s = 0; s < sym.supernodes(); ++s) {
+      const auto first = sym.first_col(s), w = sym.width(s);
+      const auto rows = sym.rows_begin(s);
+      const auto m = static_cast<size_type>(sym.rows_end(s) - rows);
+      T         *block = m_blocks.data() + sym.block_offset(s);
+      T         *diag = m_diag.data() + first;
+
+      factor_block(block, w + m, w, diag, delta);
+      if (m == 0) continue;
+
+      // update = -L_off * D * L_off^T. Only the lower triangle is needed, so it's computed by chunks of rows, each up
+      // to its last column.
+      update.assign(m * m, T{});
+      const T *off = block + w * w;
+      for (size_type a0 = 0; a0 < m; a0 += block_size) {
+        const auto a1 = std::min(m, a0 + block_size);
+        subtract_scaled_product(a1 - a0, a1, w, off + a0 * w, w, off, w, diag, update.data() + a0 * m, m);
+      }
+
+      // Columns rows[b] of one target supernode are next to each other. The rows below them in this supernode are a
+      // subset of the rows of the target, so their local indices are found by merging.
+      local.resize(m);
+      for (size_type b0 = 0; b0 < m;) {
+        const auto t = sym.supernode_of(rows[b0]);
+        const auto t_first = sym.first_col(t), t_w = sym.width(t), t_last = t_first + t_w;
+
+        size_type b1 = b0;
+        while (b1 < m && rows[b1] < t_last) {
+          ++b1;
+        }
+
+        const auto *t_rows = sym.rows_begin(t);
+        for (size_type a = b0; a < m; ++a) {
+          if (rows[a] < t_last) {
+            local[a] = rows[a] - t_first;
+            continue;
+          }
+          while (*t_rows != rows[a]) {
+            ++t_rows;
+          }
+          local[a] = t_w + (t_rows - sym.rows_begin(t));
+        }
+
+        T *target = m_blocks.data() + sym.block_offset(t);
+        for (size_type b = b0; b < b1; ++b) {
+          const auto col = rows[b] - t_first;
+          for (size_type a = b; a < m; ++a) {
+            target[local[a] * t_w + col] += update[a * m + b];
+          }
+        }
+
+        b0 = b1;
+      }
+    }
+  }
+
+  // Solves L * D * L^T * x = P * col and returns P^T * x.
+  std::vector<T> apply(const std::vector<T> &col) const {
+    const auto &sym = *m_symbolic;
+    const auto &order = sym.order();
+    const auto  size = sym.size();
+
+    std::vector<T> y(size);
+    for (size_type i = 0; i < size; ++i) {
+      y[i] = col[order[i]];
+    }
+
+    // Blocks are row-major, so rows below the diagonal block take dot products with the solved part of y.
+    for (size_type s = 0; s < sym.supernodes(); ++s) {
+      const auto first = sym.first_col(s), w = sym.width(s);
+      const auto rows = sym.rows_begin(s);
+      const auto m = static_cast<size_type>(sym.rows_end(s) - rows);
+      const T   *block = m_blocks.data() + sym.block_offset(s);
+      T         *y_s = y.data() + first;
+
+      for (size_type i = 1; i < w; ++i) {
+        T sum{};
+        for (size_type j = 0; j < i; ++j) {
+          sum += block[i * w + j] * y_s[j];
+        }
+        y_s[i] -= sum;
+      }
+
+      for (size_type a = 0; a < m; ++a) {
+        const T *row = block + (w + a) * w;
+        T        sum{};
+        for (size_type j = 0; j < w; ++j) {
+          sum += row[j] * y_s[j];
+        }
+        y[rows[a]] -= sum;
+      }
+    }
+
+    for (size_type i = 0; i < size; ++i) {
+      y[i] /= m_diag[i];
+    }
+
+    for (size_type s = sym.supernodes(); s-- > 0;) {
+      const auto first = sym.first_col(s), w = sym.width(s);
+      const auto rows = sym.rows_begin(s);
+      const auto m = static_cast<size_type>(sym.rows_end(s) - rows);
+      const T   *block = m_blocks.data() + sym.block_offset(s);
+      T         *y_s = y.data() + first;
+
+      for (size_type a = 0; a < m; ++a) {
+        const T *row = block + (w + a) * w;
+        const T  y_a = y[rows[a]];
+        for (size_type j = 0; j < w; ++j) {
+          y_s[j] -= row[j] * y_a;
+        }
+      }
+
+      for (size_type i = w; i-- > 1;) {
+        const T y_i = y_s[i];
+        for (size_type j = 0; j < i; ++j) {
+          y_s[j] -= block[i * w + j] * y_i;
+        }
+      }
+    }
+
+    std::vector<T> res(size);
+    for (size_type i = 0; i < size; ++i) {
+      res[order[i]] = y[i];
+    }
+    return res;
+  }
+
+public:
+  // Reuses symbolic if it was computed for a matrix of the same structure, analyses mat otherwise.
+  explicit sparse_ldlt(const sparse_matrix<T> &mat, std::shared_ptr<const sparse_ldlt_symbolic> symbolic = nullptr)
+      : m_symbolic{std::move(symbolic)}, m_matrix{mat} {
+    if (!m_symbolic || !m_symbolic->matches(mat)) m_symbolic = std::make_shared<const sparse_ldlt_symbolic>(mat);
+    factorize();
+  }
+
+  const std::shared_ptr<const sparse_ldlt_symbolic> &symbolic() const { return m_symbolic; }
+  size_type                                          size() const { return m_symbolic->size(); }
+
+  // Number of pivots that were replaced during factorization.
+  size_type perturbed_pivots() const { return m_perturbed; }
+
+  // Pivots are chosen statically, without Bunch-Kaufman interchanges, so the entries of the factor of an indefinite
+  // matrix may grow and the accuracy of a solve depends on that growth even when no pivot was perturbed. Iterative
+  // refinement recovers it: it runs if pivots were perturbed or the residual is above the square root of epsilon,
+  // and goes on while it halves the residual. Throws if the result doesn't solve the system, which means that the
+  // matrix is singular.
+  std::vector<T> solve(const std::vector<T> &col, size_type max_refinements = 10) const {
+    if (col.size() != size()) throw std::invalid_argument("A column of matching size should be provided");
+
+    const auto norm = [](const std::vector<T> &vec) {
+      return std::sqrt(std::inner_product(vec.begin(), vec.end(), vec.begin(), T{}));
+    };
+
+    const auto col_norm = (norm(col) == T{} ? T{1} : norm(col));
+    const auto tolerance = std::sqrt(std::numeric_limits<T>::epsilon());
+    auto       x = apply(col);
+
+    std::vector<T> res(size());
+    T              residual = std::numeric_limits<T>::max();
+    for (size_type step = 0;; ++step) {
+      m_matrix.multiply(x, res);
+      for (size_type i = 0; i < size(); ++i) {
+        res[i] = col[i] - res[i];
+      }
+
+      const auto next_residual = norm(res) / col_norm;
+      const bool improved = (next_residual < residual / 2);
+      residual = next_residual;
+      if (!m_perturbed && residual <= tolerance) break;
+      if (!improved || step == max_refinements || residual <= std::numeric_limits<T>::epsilon()) break;
+
+      const auto correction = apply(res);
+      for (size_type i = 0; i < size(); ++i) {
+        x[i] += correction[i];
+      }
+    }
+
+    const bool solved = (residual <= tolerance);
+    if (!solved) throw std::runtime_error("Singular matrix provided");
+    return x;
+  }
+};
+
+} // namespace throttle::linmath
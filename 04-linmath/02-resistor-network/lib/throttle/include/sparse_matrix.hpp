@@ -0,0 +1,234 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace throttle::linmath {
+
+// Compressed sparse row storage. Columns in every row are sorted and unique. Elements that were added explicitly stay
+// in the structure even if they sum up to zero, so the structure only depends on which elements were set.
+template <typename T>
+requires models_ring<T>
+class sparse_matrix {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+private:
+  size_type              m_rows = 0, m_cols = 0;
+  std::vector<size_type> m_row_ptr, m_col_idx;
+  std::vector<T>         m_values;
+
+public:
+  // Collects elements in coordinate (COO) format in any order. Repeated elements are summed up.
+  class builder {
+    struct triplet {
+      size_type  row, col;
+      value_type val;
+    };
+
+    size_type            m_rows, m_cols;
+    std::vector<triplet> m_triplets;
+
+  public:
+    builder(size_type rows, size_type cols) : m_rows{rows}, m_cols{cols} {}
+
+    void reserve(size_type count) { m_triplets.reserve(count); }
+
+    void add(size_type row, size_type col, value_type val) {
+      if (row >= m_rows || col >= m_cols) throw std::out_of_range("Element is out of sparse matrix bounds");
+      m_triplets.push_back({row, col, val});
+    }
+
+    sparse_matrix build() const {
+      sparse_matrix res{m_rows, m_cols};
+
+      // Counting sort by rows, then every row is sorted by columns separately.
+      std::vector<size_type> start(m_rows + 1);
+      for (const auto &t : m_triplets) {
+        ++start[t.row + 1];
+      }
+      for (size_type i = 0; i < m_rows; ++i) {
+        start[i + 1] += start[i];
+      }
+
+      std::vector<std::pair<size_type, value_type>> sorted(m_triplets.size());
+      auto                                          next = start;
+      for (const auto &t : m_triplets) {
+        sorted[next[t.row]++] = {t.col, t.val};
+      }
+
+      res.m_col_idx.reserve(sorted.size());
+      res.m_values.reserve(sorted.size());
+      for (size_type i = 0; i < m_rows; ++i) {
+        auto first = sorted.begin() + start[i], last = sorted.begin() + start[i + 1];
+        std::sort(first, last, [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        for (; first != last; ++first) {
+          if (res.m_col_idx.size() > res.m_row_ptr[i] && res.m_col_idx.back() == first->first) {
+            res.m_values.back() += first->second;
+          } else {
+            res.m_col_idx.push_back(first->first);
+            res.m_values.push_back(first->second);
+          }
+        }
+        res.m_row_ptr[i + 1] = res.m_col_idx.size();
+      }
+
+      return res;
+    }
+  };
+
+  sparse_matrix() = default;
+  sparse_matrix(size_type rows, size_type cols) : m_rows{rows}, m_cols{cols}, m_row_ptr(rows + 1) {}
+
+  size_type rows() const { return m_rows; }
+  size_type cols() const { return m_cols; }
+  bool      square() const { return (m_rows == m_cols); }
+  size_type non_zeros() const { return m_values.size(); }
+
+  std::span<const size_type>  row_cols(size_type row) const { return {row_begin(row), row_end(row)}; }
+  std::span<const value_type> row_values(size_type row) const {
+    return {m_values.data() + m_row_ptr[row], m_values.data() + m_row_ptr[row + 1]};
+  }
+
+  // Value of an element, which is zero if it's not stored.
+  value_type at(size_type row, size_type col) const {
+    if (row >= m_rows || col >= m_cols) throw std::out_of_range("Element is out of sparse matrix bounds");
+    auto found = std::lower_bound(row_begin(row), row_end(row), col);
+    if (found == row_end(row) || *found != col) return value_type{};
+    return m_values[found - m_col_idx.data()];
+  }
+
+  // res = *this * vec. Blocks of rows are distributed between threads of the pool.
+  void multiply(std::span<const value_type> vec, std::span<value_type> res,
+                utility::thread_pool &pool = utility::default_thread_pool()) const {
+    if (vec.size() != m_cols || res.size() != m_rows) throw std::runtime_error("Mismatched matrix sizes");
+
+    constexpr size_type block = 4096;
+    pool.parallel_for((m_rows + block - 1) / block, [&](size_type index) {
+      for (size_type i = index * block, last = std::min(m_rows, i + block); i < last; ++i) {
+        value_type sum{};
+        for (size_type k = m_row_ptr[i]; k < m_row_ptr[i + 1]; ++k) {
+          sum += m_values[k] * vec[m_col_idx[k]];
+        }
+        res[i] = sum;
+      }
+    });
+  }
+
+  std::vector<value_type> operator*(const std::vector<value_type> &vec) const {
+    std::vector<value_type> res(m_rows);
+    multiply(vec, res);
+    return res;
+  }
+
+  // Symmetric permutation P * A * P^T, where row and column order[i] become the i-th ones.
+  sparse_matrix permuted(const std::vector<size_type> &order) const {
+    if (!square() || order.size() != m_rows) throw std::invalid_argument("Permutation of mismatched size provided");
+
+    std::vector<size_type> position(m_rows);
+    for (size_type i = 0; i < m_rows; ++i) {
+      position[order[i]] = i;
+    }
+
+    sparse_matrix                                 res{m_rows, m_cols};
+    std::vector<std::pair<size_type, value_type>> row;
+    res.m_col_idx.reserve(non_zeros());
+    res.m_values.reserve(non_zeros());
+
+    for (size_type i = 0; i < m_rows; ++i) {
+      row.clear();
+      for (size_type k = m_row_ptr[order[i]]; k < m_row_ptr[order[i] + 1]; ++k) {
+        row.push_back({position[m_col_idx[k]], m_values[k]});
+      }
+      std::sort(row.begin(), row.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+      for (const auto &[col, val] : row) {
+        res.m_col_idx.push_back(col);
+        res.m_values.push_back(val);
+      }
+      res.m_row_ptr[i + 1] = res.m_col_idx.size();
+    }
+
+    return res;
+  }
+
+  matrix<T> to_dense() const requires models_ordered_ring<T> {
+    matrix<T> res{m_rows, m_cols};
+    for (size_type i = 0; i < m_rows; ++i) {
+      for (size_type k = m_row_ptr[i]; k < m_row_ptr[i + 1]; ++k) {
+        res[i][m_col_idx[k]] = m_values[k];
+      }
+    }
+    return res;
+  }
+
+private:
+  const size_type *row_begin(size_type row) const { return m_col_idx.data() + m_row_ptr[row]; }
+  const size_type *row_end(size_type row) const { return m_col_idx.data() + m_row_ptr[row + 1]; }
+};
+
+// Reverse Cuthill-McKee ordering of a square matrix with symmetric structure. Returns order[i], the index of the row
+// and column that should go i-th. Breadth-first search from a low degree vertex numbers neighbours close to each other,
+// which keeps the non-zeros near the diagonal and reduces fill-in during elimination.
+template <typename T> std::vector<std::size_t> reverse_cuthill_mckee(const sparse_matrix<T> &mat) {
+  using size_type = std::size_t;
+  const auto size = mat.rows();
+
+  std::vector<size_type> order, by_degree(size);
+  std::vector<bool>      visited(size);
+  order.reserve(size);
+
+  for (size_type i = 0; i < size; ++i) {
+    by_degree[i] = i;
+  }
+  std::stable_sort(by_degree.begin(), by_degree.end(),
+                   [&mat](size_type a, size_type b) { return mat.row_cols(a).size() < mat.row_cols(b).size(); });
+
+  std::vector<size_type> neighbours;
+  for (auto root : by_degree) {
+    if (visited[root]) continue;
+
+    visited[root] = true;
+    auto head = order.size();
+    order.push_back(root);
+
+    for (; head < order.size(); ++head) {
+      neighbours.clear();
+      for (auto col : mat.row_cols(order[head])) {
+        if (visited[col]) continue;
+        visited[col] = true;
+        neighbours.push_back(col);
+      }
+      std::sort(neighbours.begin(), neighbours.end(),
+                [&mat](size_type a, size_type b) { return mat.row_cols(a).size() < mat.row_cols(b).size(); });
+      order.insert(order.end(), neighbours.begin(), neighbours.end());
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+using sparse_matrix_d = sparse_matrix<double>;
+using sparse_matrix_f = sparse_matrix<float>;
+
+} // namespace throttle::linmath
@@ -0,0 +1,112 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace throttle {
+namespace utility {
+
+// Fixed set of worker threads that are started once and reused by every parallel_for, so that short parallel loops
+// don't pay for spawning threads.
+class thread_pool {
+  std::vector<std::thread>          m_workers;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex                        m_mutex;
+  std::condition_variable           m_cv;
+  bool                              m_stop = false;
+
+  void worker_loop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock{m_mutex};
+        m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+        if (m_tasks.empty()) return;
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+public:
+  explicit thread_pool(unsigned workers) {
+    for (unsigned i = 0; i < workers; ++i) {
+      m_workers.emplace_back([this]() { worker_loop(); });
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto &t : m_workers) {
+      t.join();
+    }
+  }
+
+  // Number of threads that run a parallel_for, including the calling one.
+  unsigned concurrency() const { return m_workers.size() + 1; }
+
+  // Calls func(i) for every i in [0, count) and returns when all calls are done. Indices are handed out one by one, so
+  // uneven iterations are balanced. The calling thread takes part in the work. func must not throw or call
+  // parallel_for of the same pool.
+  template <typename F> void parallel_for(std::size_t count, F func) {
+    if (!count) return;
+
+    std::atomic<std::size_t> next{0};
+    auto                     run = [&]() {
+      for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+        func(i);
+      }
+    };
+
+    const auto helpers = std::min<std::size_t>(m_workers.size(), count - 1);
+    std::latch finished{static_cast<std::ptrdiff_t>(helpers)};
+    {
+      std::lock_guard lock{m_mutex};
+      for (std::size_t i = 0; i < helpers; ++i) {
+        m_tasks.emplace_back([&]() {
+          run();
+          finished.count_down();
+        });
+      }
+    }
+    m_cv.notify_all();
+
+    run();
+    finished.wait();
+  }
+};
+
+// Shared pool with a worker for every hardware thread except the calling one.
+inline thread_pool &default_thread_pool() {
+  static thread_pool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+  return pool;
+}
+
+} // namespace utility
+} // namespace throttle
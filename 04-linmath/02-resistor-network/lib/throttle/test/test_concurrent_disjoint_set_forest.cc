@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrent_disjoint_set_forest.hpp"
+
+TEST(test_concurrent_disjoint_set_forest, test_1) {
+  throttle::concurrent_disjoint_set_forest dsu{6};
+  EXPECT_TRUE(dsu.union_set(0, 1));
+  EXPECT_TRUE(dsu.union_set(2, 3));
+  EXPECT_TRUE(dsu.union_set(1, 3));
+  EXPECT_FALSE(dsu.union_set(0, 2));
+
+  EXPECT_TRUE(dsu.same_set(0, 3));
+  EXPECT_FALSE(dsu.same_set(0, 4));
+  EXPECT_FALSE(dsu.same_set(4, 5));
+  EXPECT_EQ(dsu.find_set(0), dsu.find_set(2));
+  EXPECT_THROW(dsu.find_set(6), std::out_of_range);
+}
+
+TEST(test_concurrent_disjoint_set_forest, test_2) {
+  // Every index is connected to the one 1000 positions before it, so there are exactly 1000 components.
+  const unsigned size = 1 << 20, components = 1000;
+  std::vector<std::pair<unsigned, unsigned>> edges;
+  for (unsigned i = components; i < size; ++i) {
+    edges.push_back({i, i - components});
+  }
+  std::shuffle(edges.begin(), edges.end(), std::mt19937{42});
+
+  throttle::concurrent_disjoint_set_forest dsu{size};
+  throttle::parallel_union(dsu, edges.begin(), edges.end(), 8);
+
+  for (unsigned i = 0; i < size; ++i) {
+    ASSERT_EQ(dsu.find_set(i), dsu.find_set(i % components));
+  }
+
+  for (unsigned i = 1; i < components; ++i) {
+    EXPECT_FALSE(dsu.same_set(i - 1, i));
+  }
+}
+
+TEST(test_concurrent_disjoint_set_forest, test_3) {
+  // Concurrent finds and unions of the same elements.
+  const unsigned                           size = 1 << 16;
+  throttle::concurrent_disjoint_set_forest dsu{size};
+  std::vector<std::thread>                 threads;
+  std::vector<unsigned>                    merged(4);
+
+  for (unsigned t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (unsigned i = 1; i < size; ++i) {
+        merged[t] += dsu.union_set(i - 1, i);
+        dsu.find_set((i * 7919) % size);
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(merged[0] + merged[1] + merged[2] + merged[3], size - 1);
+  EXPECT_TRUE(dsu.same_set(0, size - 1));
+}
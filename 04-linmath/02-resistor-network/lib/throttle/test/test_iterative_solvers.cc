@@ -0,0 +1,128 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "linear_solver.hpp"
+#include "sparse_matrix.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace linmath = throttle::linmath;
+
+namespace {
+
+constexpr std::size_t side = 30, nodes = side * side;
+
+// Grounded grid of random conductances, which is symmetric positive definite. With constraint, an extra voltage
+// equation between the second and the last nodes makes it a saddle point system, like a short circuit does.
+linmath::sparse_matrix_d make_grid(bool constraint) {
+  std::mt19937                     gen{1};
+  std::uniform_real_distribution<> dist{1, 10};
+
+  const auto                        size = nodes + constraint;
+  linmath::sparse_matrix_d::builder builder{size, size};
+
+  const auto connect = [&](std::size_t a, std::size_t b) {
+    const auto conductance = 1 / dist(gen);
+    builder.add(a, a, conductance);
+    builder.add(b, b, conductance);
+    builder.add(a, b, -conductance);
+    builder.add(b, a, -conductance);
+  };
+
+  builder.add(0, 0, 1);
+  for (std::size_t i = 0; i < nodes; ++i) {
+    if (i % side + 1 < side) connect(i, i + 1);
+    if (i + side < nodes) connect(i, i + side);
+  }
+
+  if (constraint) {
+    builder.add(nodes, 1, 1);
+    builder.add(1, nodes, 1);
+    builder.add(nodes, nodes - 1, -1);
+    builder.add(nodes - 1, nodes, -1);
+  }
+
+  return builder.build();
+}
+
+std::vector<double> make_rhs(std::size_t size) {
+  std::mt19937                     gen{2};
+  std::uniform_real_distribution<> dist{-1, 1};
+  std::vector<double>              rhs(size);
+  std::generate(rhs.begin(), rhs.end(), [&]() { return dist(gen); });
+  return rhs;
+}
+
+void expect_solution(const linmath::sparse_matrix_d &mat, const std::vector<double> &rhs,
+                     const linmath::iterative_result<double> &result) {
+  EXPECT_TRUE(result.converged);
+  EXPECT_LE(result.residual, 1e-10);
+
+  const auto direct = linmath::nonsingular_solver(mat, rhs);
+  for (std::size_t i = 0; i < direct.size(); ++i) {
+    EXPECT_TRUE(throttle::is_roughly_equal(result.solution[i], direct[i]));
+  }
+}
+
+} // namespace
+
+TEST(test_iterative_solvers, test_conjugate_gradient_jacobi) {
+  const auto mat = make_grid(false);
+  const auto rhs = make_rhs(mat.rows());
+  expect_solution(mat, rhs, linmath::conjugate_gradient(mat, rhs, linmath::jacobi_preconditioner{mat}));
+}
+
+TEST(test_iterative_solvers, test_conjugate_gradient_cholesky) {
+  const auto mat = make_grid(false);
+  const auto rhs = make_rhs(mat.rows());
+
+  const auto jacobi = linmath::conjugate_gradient(mat, rhs, linmath::jacobi_preconditioner{mat});
+  const auto cholesky = linmath::conjugate_gradient(mat, rhs, linmath::incomplete_cholesky_preconditioner{mat});
+  expect_solution(mat, rhs, cholesky);
+  EXPECT_LT(cholesky.iterations, jacobi.iterations);
+}
+
+TEST(test_iterative_solvers, test_cholesky_breakdown) {
+  EXPECT_THROW(linmath::incomplete_cholesky_preconditioner{make_grid(true)}, std::runtime_error);
+}
+
+TEST(test_iterative_solvers, test_bicgstab) {
+  const auto mat = make_grid(true);
+  const auto rhs = make_rhs(mat.rows());
+  expect_solution(mat, rhs, linmath::bicgstab(mat, rhs, linmath::jacobi_preconditioner{mat}, {1e-12, 10000}));
+}
+
+TEST(test_iterative_solvers, test_gmres) {
+  const auto mat = make_grid(true);
+  const auto rhs = make_rhs(mat.rows());
+  expect_solution(mat, rhs, linmath::gmres(mat, rhs, linmath::jacobi_preconditioner{mat}, {1e-12, 10000}));
+}
+
+TEST(test_iterative_solvers, test_iteration_limit) {
+  const auto mat = make_grid(false);
+  const auto rhs = make_rhs(mat.rows());
+  const auto result = linmath::conjugate_gradient(mat, rhs, linmath::jacobi_preconditioner{mat}, {1e-10, 5});
+  EXPECT_FALSE(result.converged);
+  EXPECT_EQ(result.iterations, 5);
+  EXPECT_GT(result.residual, 1e-10);
+}
+
+TEST(test_iterative_solvers, test_initial_guess) {
+  const auto mat = make_grid(false);
+  const auto rhs = make_rhs(mat.rows());
+  const auto jacobi = linmath::jacobi_preconditioner{mat};
+  const auto first = linmath::conjugate_gradient(mat, rhs, jacobi);
+  const auto second = linmath::conjugate_gradient(mat, rhs, jacobi, {}, first.solution);
+  EXPECT_TRUE(second.converged);
+  EXPECT_EQ(second.iterations, 0);
+}
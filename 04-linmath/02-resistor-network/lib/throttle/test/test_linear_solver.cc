@@ -1,15 +1,18 @@
+#include <cmath>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include "linear_solver.hpp"
 #include "matrix.hpp"
 
 TEST(test_linear_solver, test_1) {
-  throttle::matrix_d coefs{3, 3, {1, 1, 1, 0, 2, 5, 2, 5, -1}};
-  throttle::matrix_d col{3, 1, {6, -4, 27}};
-  throttle::matrix_d sol{3, 1, {5, 3, -2}};
+  throttle::linmath::matrix_d coefs{3, 3, {1, 1, 1, 0, 2, 5, 2, 5, -1}};
+  throttle::linmath::matrix_d col{3, 1, {6, -4, 27}};
+  throttle::linmath::matrix_d sol{3, 1, {5, 3, -2}};
 
-  auto res = throttle::nonsingular_solver(coefs, col);
+  auto res = throttle::linmath::nonsingular_solver(coefs, col);
   for (unsigned i = 0; i < res.rows(); i++)
     for (unsigned j = 0; j < res.cols(); j++)
       std::cout << res[i][j] << " ";
@@ -18,33 +21,98 @@ TEST(test_linear_solver, test_1) {
 }
 
 TEST(test_linear_solver, test_2) {
-  throttle::matrix_d coefs{3, 3, {1, 3, -2, 3, 5, 6, 2, 4, 3}};
-  throttle::matrix_d col{3, 1, {5, 7, 8}};
-  throttle::matrix_d sol{3, 1, {-15, 8, 2}};
+  throttle::linmath::matrix_d coefs{3, 3, {1, 3, -2, 3, 5, 6, 2, 4, 3}};
+  throttle::linmath::matrix_d col{3, 1, {5, 7, 8}};
+  throttle::linmath::matrix_d sol{3, 1, {-15, 8, 2}};
 
-  auto res = throttle::nonsingular_solver(coefs, col);
+  auto res = throttle::linmath::nonsingular_solver(coefs, col);
   EXPECT_EQ(res, sol);
 }
 
 TEST(test_linear_solver, dependent_system_1) {
-  throttle::matrix_d coefs{3, 2, {-1, 2, 2, 3, 1, -2}};
-  throttle::matrix_d col{3, 1, {0, 0, 0}};
-  throttle::matrix_d sol{2, 1, {0, 0}};
-  auto               res = throttle::nonsingular_solver(coefs, col);
+  throttle::linmath::matrix_d coefs{3, 2, {-1, 2, 2, 3, 1, -2}};
+  throttle::linmath::matrix_d col{3, 1, {0, 0, 0}};
+  throttle::linmath::matrix_d sol{2, 1, {0, 0}};
+  auto                        res = throttle::linmath::nonsingular_solver(coefs, col);
   EXPECT_EQ(res, sol);
 }
 
 TEST(test_linear_solver, dependent_system_2) {
-  throttle::matrix_d coefs{4, 3, {1, 1, 1, 0, -4, -10, 0, 2, 5, 2, 5, -1}};
-  throttle::matrix_d col{4, 1, {6, 8, -4, 27}};
-  throttle::matrix_d sol{3, 1, {5, 3, -2}};
+  throttle::linmath::matrix_d coefs{4, 3, {1, 1, 1, 0, -4, -10, 0, 2, 5, 2, 5, -1}};
+  throttle::linmath::matrix_d col{4, 1, {6, 8, -4, 27}};
+  throttle::linmath::matrix_d sol{3, 1, {5, 3, -2}};
 
-  auto res = throttle::nonsingular_solver(coefs, col);
+  auto res = throttle::linmath::nonsingular_solver(coefs, col);
   EXPECT_EQ(res, sol);
 }
 
 TEST(test_linear_solver, singular_system) {
-  throttle::matrix_d coefs{4, 3, {1, 1, 1, 0, 5, -10, 0, 2, 5, 2, 5, -1}};
-  throttle::matrix_d col{4, 1, {6, 8, -4, 27}};
-  EXPECT_THROW(throttle::nonsingular_solver(coefs, col), std::runtime_error);
-}
\ No newline at end of file
+  throttle::linmath::matrix_d coefs{4, 3, {1, 1, 1, 0, 5, -10, 0, 2, 5, 2, 5, -1}};
+  throttle::linmath::matrix_d col{4, 1, {6, 8, -4, 27}};
+  EXPECT_THROW(throttle::linmath::nonsingular_solver(coefs, col), std::runtime_error);
+}
+namespace {
+
+// Random matrix with a heavier diagonal, which keeps it well conditioned.
+throttle::linmath::matrix_d make_random(std::size_t size, double diag) {
+  std::mt19937                     gen{1};
+  std::uniform_real_distribution<> dist{-1, 1};
+  throttle::linmath::matrix_d      mat{size, size};
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      mat[i][j] = dist(gen) + (i == j ? diag : 0);
+    }
+  }
+  return mat;
+}
+
+} // namespace
+
+TEST(test_linear_solver, mixed_precision) {
+  const auto          coefs = make_random(150, 10);
+  std::vector<double> col(150);
+  for (std::size_t i = 0; i < col.size(); ++i) {
+    col[i] = std::sin(i);
+  }
+
+  const auto result = throttle::linmath::mixed_precision_solver(coefs, col);
+  EXPECT_TRUE(result.converged);
+  EXPECT_GT(result.iterations, 0);
+  EXPECT_LT(result.iterations, 5);
+  EXPECT_LT(result.residual, 1e-14);
+
+  const auto direct = throttle::linmath::lu_decomposition<double>{coefs}.solve(col);
+  for (std::size_t i = 0; i < col.size(); ++i) {
+    EXPECT_NEAR(result.solution[i], direct[i], 1e-13);
+  }
+
+  EXPECT_TRUE(throttle::linmath::mixed_precision_solver(coefs, std::vector<double>(150)).converged);
+  EXPECT_THROW(throttle::linmath::mixed_precision_solver(coefs, {1, 2}), std::invalid_argument);
+}
+
+TEST(test_linear_solver, mixed_precision_fallback) {
+  // Hilbert matrix of size 10 has condition number about 1e13, refinement in float can't converge. It's scaled so that
+  // pivots aren't roughly zero.
+  constexpr std::size_t       size = 10;
+  throttle::linmath::matrix_d coefs{size, size};
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      coefs[i][j] = 1e14 / (i + j + 1);
+    }
+  }
+
+  const std::vector<double> col(size, 1.0);
+  const auto                result = throttle::linmath::mixed_precision_solver(coefs, col);
+  EXPECT_FALSE(result.converged);
+  EXPECT_LT(result.residual, 1e-6);
+
+  const auto direct = throttle::linmath::lu_decomposition<double>{coefs}.solve(col);
+  EXPECT_EQ(result.solution, direct);
+
+  // Elements out of the range of float go to double right away.
+  throttle::linmath::matrix_d large{2, 2, {1e300, 0, 0, 1}};
+  const auto                  large_result = throttle::linmath::mixed_precision_solver(large, {1e300, 1});
+  EXPECT_FALSE(large_result.converged);
+  EXPECT_EQ(large_result.iterations, 0);
+  EXPECT_DOUBLE_EQ(large_result.solution[0], 1);
+}
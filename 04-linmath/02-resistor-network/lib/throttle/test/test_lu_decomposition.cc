@@ -0,0 +1,97 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "lu_decomposition.hpp"
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using matrix_d = throttle::linmath::matrix_d;
+using lu_d = throttle::linmath::lu_decomposition<double>;
+
+namespace {
+
+// Diagonally dominant, so that it's well conditioned, with rows shuffled to make pivoting necessary.
+matrix_d random_matrix(std::size_t size, unsigned seed) {
+  std::mt19937                     gen{seed};
+  std::uniform_real_distribution<> dist{-1, 1};
+
+  std::vector<std::size_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), gen);
+
+  matrix_d res{size, size};
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      res[order[i]][j] = dist(gen) + (i == j ? size : 0);
+    }
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(test_lu_decomposition, test_solve_1) {
+  matrix_d coefs{3, 3, {1, 1, 1, 0, 2, 5, 2, 5, -1}};
+  lu_d     lu{coefs};
+
+  EXPECT_EQ(lu.solve(matrix_d{3, 1, {6, -4, 27}}), (matrix_d{3, 1, {5, 3, -2}}));
+  EXPECT_EQ(lu.solve(matrix_d{3, 1, {3, 7, 6}}), (matrix_d{3, 1, {1, 1, 1}}));
+
+  auto res = lu.solve(std::vector<double>{6, -4, 27});
+  ASSERT_EQ(res.size(), 3);
+  EXPECT_TRUE(throttle::is_roughly_equal(res[0], 5.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(res[1], 3.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(res[2], -2.0));
+}
+
+TEST(test_lu_decomposition, test_determinant) {
+  matrix_d a{3, 3, {1, 3, 2, -3, -1, -3, 2, 3, 1}}, b{2, 2, {0, 1, 1, 0}}, c{3, 3, {1, 2, 3, 2, 4, 6, 1, 1, 1}};
+  EXPECT_DOUBLE_EQ(lu_d{a}.determinant(), -15);
+  EXPECT_DOUBLE_EQ(lu_d{b}.determinant(), -1);
+  EXPECT_EQ(lu_d{c}.determinant(), 0);
+
+  // matrix::determinant() runs the same blocked kernel, also past the first block.
+  EXPECT_DOUBLE_EQ(a.determinant(), -15);
+  EXPECT_EQ(c.determinant(), 0);
+  EXPECT_THROW(matrix_d(2, 3).determinant(), std::runtime_error);
+
+  const auto big = random_matrix(2 * lu_d::block_size + 5, 3);
+  EXPECT_DOUBLE_EQ(big.determinant(), lu_d{big}.determinant());
+}
+
+TEST(test_lu_decomposition, test_singular) {
+  lu_d lu{matrix_d{3, 3, {1, 2, 3, 2, 4, 6, 1, 1, 1}}};
+  EXPECT_TRUE(lu.singular());
+  EXPECT_THROW(lu.solve(matrix_d{3, 1}), std::runtime_error);
+  EXPECT_THROW(lu_d{matrix_d(2, 3)}, std::runtime_error);
+}
+
+// Large enough for several blocks and a partial last one, so the trailing updates go through gemm.
+TEST(test_lu_decomposition, test_blocked) {
+  constexpr std::size_t size = 2 * lu_d::block_size + 17;
+  const auto            a = random_matrix(size, 1);
+  lu_d                  lu{a};
+
+  auto inverse = lu.inverse();
+  EXPECT_EQ(a * inverse, matrix_d::unity(size));
+
+  matrix_d rhs{size, 3};
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      rhs[i][j] = double(i) - double(j * size) / 2;
+    }
+  }
+  EXPECT_EQ(a * lu.solve(rhs), rhs);
+}
@@ -0,0 +1,170 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "linear_solver.hpp"
+#include "sparse_ldlt.hpp"
+#include "sparse_matrix.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace linmath = throttle::linmath;
+
+namespace {
+
+// Grounded grid of random conductances. Every short circuit adds a voltage equation between two nodes, the first one
+// also connects a node that has no resistors at all, so its diagonal element is zero.
+linmath::sparse_matrix_d make_grid(std::size_t side, std::size_t shorts, unsigned seed = 1) {
+  std::mt19937                     gen{seed};
+  std::uniform_real_distribution<> dist{1, 10};
+
+  const auto                        nodes = side * side, size = nodes + 1 + shorts;
+  linmath::sparse_matrix_d::builder builder{size, size};
+
+  const auto connect = [&](std::size_t a, std::size_t b) {
+    const auto conductance = 1 / dist(gen);
+    builder.add(a, a, conductance);
+    builder.add(b, b, conductance);
+    builder.add(a, b, -conductance);
+    builder.add(b, a, -conductance);
+  };
+
+  const auto short_circuit = [&](std::size_t row, std::size_t a, std::size_t b) {
+    builder.add(row, a, 1);
+    builder.add(a, row, 1);
+    builder.add(row, b, -1);
+    builder.add(b, row, -1);
+  };
+
+  builder.add(0, 0, 1);
+  for (std::size_t i = 0; i < nodes; ++i) {
+    if (i % side + 1 < side) connect(i, i + 1);
+    if (i + side < nodes) connect(i, i + side);
+  }
+
+  if (shorts) short_circuit(nodes + 1, nodes, side + 1);
+  for (std::size_t k = 1; k < shorts; ++k) {
+    short_circuit(nodes + 1 + k, k, nodes - 1 - k);
+  }
+
+  // The node that only has the short circuit would make the matrix singular otherwise.
+  if (!shorts) builder.add(nodes, nodes, 1);
+  return builder.build();
+}
+
+std::vector<double> make_rhs(std::size_t size) {
+  std::mt19937                     gen{2};
+  std::uniform_real_distribution<> dist{-1, 1};
+  std::vector<double>              rhs(size);
+  std::generate(rhs.begin(), rhs.end(), [&]() { return dist(gen); });
+  return rhs;
+}
+
+void expect_solution(const linmath::sparse_matrix_d &mat, const std::vector<double> &rhs,
+                     const std::vector<double> &solution) {
+  const auto direct = linmath::nonsingular_solver(mat, rhs);
+  ASSERT_EQ(solution.size(), direct.size());
+  for (std::size_t i = 0; i < direct.size(); ++i) {
+    EXPECT_TRUE(throttle::is_roughly_equal(solution[i], direct[i]));
+  }
+}
+
+} // namespace
+
+TEST(test_sparse_ldlt, test_minimum_degree_star) {
+  // Eliminating the center of a star early would fill the whole matrix. When one leaf is left, both have degree 1.
+  linmath::sparse_matrix_d::builder builder{6, 6};
+  for (std::size_t i = 0; i < 6; ++i) {
+    builder.add(i, i, 4);
+    if (i == 2) continue;
+    builder.add(i, 2, 1);
+    builder.add(2, i, 1);
+  }
+
+  auto order = linmath::approximate_minimum_degree(builder.build());
+  EXPECT_GE(std::find(order.begin(), order.end(), 2) - order.begin(), 4);
+  std::sort(order.begin(), order.end());
+  EXPECT_EQ(order, (std::vector<std::size_t>{0, 1, 2, 3, 4, 5}));
+}
+
+TEST(test_sparse_ldlt, test_small) {
+  linmath::matrix_d                 dense{3, 3, {4, 1, 2, 1, -3, 0, 2, 0, 5}};
+  linmath::sparse_matrix_d::builder builder{3, 3};
+  for (std::size_t i = 0; i < 3; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      if (dense[i][j] != 0) builder.add(i, j, dense[i][j]);
+    }
+  }
+
+  const auto          mat = builder.build();
+  std::vector<double> rhs{1, 2, 3};
+  expect_solution(mat, rhs, linmath::sparse_ldlt<double>{mat}.solve(rhs));
+  EXPECT_THROW(linmath::sparse_ldlt<double>{mat}.solve({1, 2}), std::invalid_argument);
+}
+
+TEST(test_sparse_ldlt, test_grid) {
+  const auto mat = make_grid(40, 0);
+  const auto rhs = make_rhs(mat.rows());
+
+  const auto ldlt = linmath::sparse_ldlt<double>{mat};
+  EXPECT_EQ(ldlt.perturbed_pivots(), 0);
+  EXPECT_LT(ldlt.symbolic()->supernodes(), mat.rows());
+  expect_solution(mat, rhs, ldlt.solve(rhs));
+}
+
+TEST(test_sparse_ldlt, test_saddle_point) {
+  const auto mat = make_grid(30, 20);
+  const auto rhs = make_rhs(mat.rows());
+
+  // Currents and the node without resistors are eliminated after their neighbours, so no pivot is zero.
+  const auto ldlt = linmath::sparse_ldlt<double>{mat};
+  EXPECT_EQ(ldlt.perturbed_pivots(), 0);
+  expect_solution(mat, rhs, ldlt.solve(rhs));
+}
+
+TEST(test_sparse_ldlt, test_symbolic_reuse) {
+  const auto first = linmath::sparse_ldlt<double>{make_grid(20, 5, 1)};
+
+  // Other conductances with the same structure reuse the analysis.
+  const auto mat = make_grid(20, 5, 3);
+  const auto rhs = make_rhs(mat.rows());
+  const auto second = linmath::sparse_ldlt<double>{mat, first.symbolic()};
+  EXPECT_EQ(second.symbolic(), first.symbolic());
+  expect_solution(mat, rhs, second.solve(rhs));
+
+  const auto third = linmath::sparse_ldlt<double>{make_grid(20, 6, 1), first.symbolic()};
+  EXPECT_NE(third.symbolic(), first.symbolic());
+}
+
+TEST(test_sparse_ldlt, test_singular) {
+  linmath::sparse_matrix_d::builder builder{3, 3};
+  builder.add(0, 0, 1);
+  builder.add(0, 1, -1);
+  builder.add(1, 0, -1);
+  builder.add(1, 1, 1);
+  builder.add(2, 2, 1);
+
+  EXPECT_THROW(linmath::sparse_ldlt<double>{builder.build()}.solve({1, 0, 0}), std::runtime_error);
+}
+
+TEST(test_sparse_ldlt, test_zero_pivot) {
+  // A node connected to the base one by a short circuit: [0 1; 1 0] has no order without a zero pivot.
+  linmath::sparse_matrix_d::builder builder{2, 2};
+  builder.add(0, 1, 1);
+  builder.add(1, 0, 1);
+
+  const auto          mat = builder.build();
+  const auto          ldlt = linmath::sparse_ldlt<double>{mat};
+  std::vector<double> rhs{2, 3};
+  EXPECT_EQ(ldlt.perturbed_pivots(), 1);
+  expect_solution(mat, rhs, ldlt.solve(rhs));
+}
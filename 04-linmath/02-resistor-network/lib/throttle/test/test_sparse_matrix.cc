@@ -0,0 +1,135 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "linear_solver.hpp"
+#include "sparse_matrix.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using sparse_matrix_d = throttle::linmath::sparse_matrix_d;
+using matrix_d = throttle::linmath::matrix_d;
+
+TEST(test_sparse_matrix, test_builder) {
+  sparse_matrix_d::builder builder{3, 4};
+  builder.add(2, 3, 1);
+  builder.add(0, 1, 2);
+  builder.add(2, 0, 3);
+  builder.add(0, 1, 4);
+  builder.add(1, 2, 0);
+  EXPECT_THROW(builder.add(3, 0, 1), std::out_of_range);
+
+  auto mat = builder.build();
+  EXPECT_EQ(mat.rows(), 3);
+  EXPECT_EQ(mat.cols(), 4);
+  EXPECT_EQ(mat.non_zeros(), 4);
+  EXPECT_EQ(mat.at(0, 1), 6);
+  EXPECT_EQ(mat.at(2, 0), 3);
+  EXPECT_EQ(mat.at(2, 3), 1);
+  EXPECT_EQ(mat.at(1, 1), 0);
+  EXPECT_EQ(mat.row_cols(2).size(), 2);
+  EXPECT_EQ(mat.row_cols(2)[0], 0);
+
+  EXPECT_EQ(mat.to_dense(), (matrix_d{3, 4, {0, 6, 0, 0, 0, 0, 0, 0, 3, 0, 0, 1}}));
+  std::vector<double> vec{1, 2, 3, 4}, expected{12, 0, 7};
+  EXPECT_EQ(mat * vec, expected);
+}
+
+TEST(test_sparse_matrix, test_reverse_cuthill_mckee) {
+  // Path 0 - 3 - 1 - 4 - 2 numbered out of order.
+  sparse_matrix_d::builder builder{5, 5};
+  for (auto [a, b] : std::vector<std::pair<int, int>>{{0, 3}, {3, 1}, {1, 4}, {4, 2}}) {
+    builder.add(a, b, 1);
+    builder.add(b, a, 1);
+  }
+  for (int i = 0; i < 5; ++i) {
+    builder.add(i, i, 2);
+  }
+
+  auto order = throttle::linmath::reverse_cuthill_mckee(builder.build());
+  EXPECT_TRUE(order == (std::vector<std::size_t>{2, 4, 1, 3, 0}) || order == (std::vector<std::size_t>{0, 3, 1, 4, 2}));
+}
+
+TEST(test_sparse_matrix, test_permuted) {
+  sparse_matrix_d::builder builder{3, 3};
+  builder.add(0, 0, 1);
+  builder.add(0, 2, 2);
+  builder.add(1, 1, 3);
+  builder.add(2, 0, 4);
+
+  auto permuted = builder.build().permuted({2, 0, 1});
+  EXPECT_EQ(permuted.to_dense(), (matrix_d{3, 3, {0, 4, 0, 2, 1, 0, 0, 0, 3}}));
+  EXPECT_THROW(permuted.permuted({0, 1}), std::invalid_argument);
+}
+
+TEST(test_sparse_matrix, test_solver_1) {
+  matrix_d                 dense{3, 3, {1, 1, 1, 0, 2, 5, 2, 5, -1}};
+  sparse_matrix_d::builder builder{3, 3};
+  for (std::size_t i = 0; i < 3; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      if (dense[i][j] != 0) builder.add(i, j, dense[i][j]);
+    }
+  }
+
+  auto res = throttle::linmath::nonsingular_solver(builder.build(), std::vector<double>{6, -4, 27});
+  ASSERT_EQ(res.size(), 3);
+  EXPECT_TRUE(throttle::is_roughly_equal(res[0], 5.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(res[1], 3.0));
+  EXPECT_TRUE(throttle::is_roughly_equal(res[2], -2.0));
+}
+
+TEST(test_sparse_matrix, test_solver_singular) {
+  sparse_matrix_d::builder builder{3, 3};
+  builder.add(0, 0, 1);
+  builder.add(0, 1, 2);
+  builder.add(1, 0, 2);
+  builder.add(1, 1, 4);
+  builder.add(2, 2, 1);
+  EXPECT_THROW(throttle::linmath::nonsingular_solver(builder.build(), std::vector<double>(3)), std::runtime_error);
+}
+
+// Grid Laplacian with a zero diagonal constraint row, like a short circuit in nodal analysis.
+TEST(test_sparse_matrix, test_solver_grid) {
+  constexpr std::size_t side = 20, nodes = side * side, size = nodes + 1;
+
+  std::mt19937                     gen{1};
+  std::uniform_real_distribution<> dist{1, 10};
+  sparse_matrix_d::builder         builder{size, size};
+
+  const auto connect = [&](std::size_t a, std::size_t b) {
+    const auto conductance = 1 / dist(gen);
+    builder.add(a, a, conductance);
+    builder.add(b, b, conductance);
+    builder.add(a, b, -conductance);
+    builder.add(b, a, -conductance);
+  };
+
+  for (std::size_t i = 0; i < nodes; ++i) {
+    builder.add(i, i, 0.01);
+    if (i % side + 1 < side) connect(i, i + 1);
+    if (i + side < nodes) connect(i, i + side);
+  }
+  builder.add(nodes, 0, 1);
+  builder.add(0, nodes, 1);
+  builder.add(nodes, nodes - 1, -1);
+  builder.add(nodes - 1, nodes, -1);
+
+  std::vector<double> rhs(size);
+  std::generate(rhs.begin(), rhs.end(), [&]() { return dist(gen); });
+
+  const auto mat = builder.build();
+  const auto res = throttle::linmath::nonsingular_solver(mat, rhs);
+  const auto check = mat * res;
+  for (std::size_t i = 0; i < size; ++i) {
+    EXPECT_TRUE(throttle::is_roughly_equal(check[i], rhs[i]));
+  }
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <boost/lexical_cast/bad_lexical_cast.hpp>
 #include <cctype>
 #include <chrono>
@@ -6,7 +7,6 @@
 #include <iterator>
 #include <set>
 #include <string>
-#include <tuple>
 
 #include "contiguous_matrix.hpp"
 #include "matrix.hpp"
@@ -42,8 +42,12 @@
 #endif
 
 #include "linear_solver.hpp"
+#include "netlist.hpp"
 #include "resistor_network.hpp"
 
+#include <limits>
+#include <unistd.h>
+
 namespace po = boost::program_options;
 
 #ifndef USE_BISON
@@ -98,7 +102,7 @@ BOOST_SPIRIT_DEFINE(edge);
 
 struct edge_class : x3::annotate_on_success, error_handler {};
 
-std::optional<std::vector<circuit_parser::graph::network_edge>> parse_circuit() {
+std::optional<std::vector<circuits::resistor_edge>> parse_circuit() {
   std::vector<circuit_parser::graph::network_edge> parse_result;
 
   using ascii::space;
@@ -119,7 +123,11 @@ std::optional<std::vector<circuit_parser::graph::network_edge>> parse_circuit()
 
   if (!res) return std::nullopt;
 
-  return parse_result;
+  std::vector<circuits::resistor_edge> edges;
+  for (const auto &v : parse_result) {
+    edges.push_back({v.first, v.second, v.res, v.emf.value_or(0.0)});
+  }
+  return edges;
 }
 
 } // namespace circuit_parser
@@ -128,7 +136,7 @@ std::optional<std::vector<circuit_parser::graph::network_edge>> parse_circuit()
 
 namespace circuit_parser {
 
-std::optional<std::vector<circuits::network_edge>> parse_circuit() {
+std::optional<std::vector<circuits::resistor_edge>> parse_circuit() {
   std::vector<circuits::network_edge> parse_result;
 
   std::string input;
@@ -144,7 +152,11 @@ std::optional<std::vector<circuits::network_edge>> parse_circuit() {
 
   if (!res) return std::nullopt;
 
-  return drv.m_parsed;
+  std::vector<circuits::resistor_edge> edges;
+  for (const auto &v : drv.m_parsed) {
+    edges.push_back({v.first, v.second, v.res, v.emf.value_or(0.0)});
+  }
+  return edges;
 }
 
 } // namespace circuit_parser
@@ -155,7 +167,12 @@ int main(int argc, char *argv[]) try {
   bool non_verbose = false;
 
   po::options_description desc("Available options");
-  desc.add_options()("help,h", "Print this help message")("nonverbose,n", "Non-verbose output");
+  desc.add_options()("help,h", "Print this help message")("nonverbose,n", "Non-verbose output")(
+      "report,r", "Print the number of unknowns before and after the graph is reduced")(
+      "time,t", "Print time it took to solve the network")(
+      "input,i", po::value<std::string>(), "Read the netlist from a file instead of stdin, text or binary")(
+      "legacy,l", "Parse stdin with the original grammar-based parser")(
+      "save-binary,b", po::value<std::string>(), "Save the netlist in binary form to a file");
   po::variables_map vm;
   po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
   po::notify(vm);
@@ -166,57 +183,68 @@ int main(int argc, char *argv[]) try {
   }
 
   non_verbose = vm.count("nonverbose");
-  auto parsed = circuit_parser::parse_circuit();
-
-  if (!parsed) {
-    std::cerr << "Aborting...\n";
-    return EXIT_FAILURE;
-  }
-
-  auto                       result = parsed.value();
-  circuits::resistor_network network;
-
-  std::unordered_map<unsigned, unsigned> input_vertex_to_mapped;
-  std::unordered_map<unsigned, unsigned> mapped_to_input_vertex;
 
-  unsigned count = 0;
-
-  const auto get_or_insert = [&count, &input_vertex_to_mapped, &mapped_to_input_vertex](unsigned index) {
-    if (input_vertex_to_mapped.contains(index)) {
-      return input_vertex_to_mapped.at(index);
+  std::vector<circuits::resistor_edge> input;
+  if (vm.count("legacy")) {
+    auto parsed = circuit_parser::parse_circuit();
+    if (!parsed) {
+      std::cerr << "Aborting...\n";
+      return EXIT_FAILURE;
+    }
+    input = std::move(parsed.value());
+  } else {
+    try {
+      input = (vm.count("input") ? circuits::netlist::load(vm["input"].as<std::string>())
+                                 : circuits::netlist::load(STDIN_FILENO));
+    } catch (std::runtime_error &e) {
+      std::cerr << e.what() << "\nAborting...\n";
+      return EXIT_FAILURE;
     }
+  }
 
-    auto this_index = count++;
-    input_vertex_to_mapped[index] = this_index;
-    mapped_to_input_vertex[this_index] = index;
+  if (vm.count("save-binary")) circuits::netlist::save_binary(vm["save-binary"].as<std::string>(), input);
 
-    return this_index;
-  };
+  // Every resistor is put between two temporary nodes connected to its ends by short circuits, so that loops and
+  // parallel resistors in the input become distinct edges. Temporaries are named after the largest name in the input.
+  unsigned max_name = 0;
+  for (const auto &v : input) {
+    max_name = std::max({max_name, v.first, v.second});
+  }
 
-  std::vector<std::tuple<unsigned, unsigned, unsigned, unsigned>> currents_to_print;
+  if ((std::numeric_limits<unsigned>::max() - max_name) / 2 < input.size()) {
+    std::cerr << "Too many nodes in the network\n";
+    return EXIT_FAILURE;
+  }
 
-  for (const auto &v : result) {
-    auto first_mapped = get_or_insert(v.first), second_mapped = get_or_insert(v.second);
-    auto temporary_first = count++, temporary_second = count++;
-    network.insert(first_mapped, temporary_first);
-    network.insert(temporary_first, temporary_second, v.res, v.emf.value_or(0.0));
-    network.insert(temporary_second, second_mapped);
-    currents_to_print.push_back(std::make_tuple(temporary_first, temporary_second, v.first, v.second));
+  std::vector<circuits::resistor_edge> wrapped;
+  wrapped.reserve(3 * input.size());
+  for (unsigned temporary = max_name + 1; const auto &v : input) {
+    const auto temporary_first = temporary++, temporary_second = temporary++;
+    wrapped.push_back({v.first, temporary_first, 0, 0});
+    wrapped.push_back({temporary_first, temporary_second, v.resistance, v.emf});
+    wrapped.push_back({temporary_second, v.second, 0, 0});
   }
 
-  circuits::resistor_network::solution_currents currents;
+  // The resistor of input edge i is edge 3 * i + 1, the current goes from its first temporary node to the second one.
+  const circuits::circuit_graph network{wrapped};
+
+  circuits::circuit_solution solution;
+  circuits::reduction_report report;
+  auto                       start = std::chrono::high_resolution_clock::now();
   try {
-    std::tie(std::ignore, currents) = network.solve();
+    solution = network.solve({}, &report);
   } catch (std::exception &) {
     std::cerr << "Network doesn't have a solution\n";
     return EXIT_FAILURE;
   }
 
-  for (const auto &v : currents_to_print) {
-    auto [temp_1, temp_2, name_1, name_2] = v;
+  auto duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    const auto name_1 = input[i].first, name_2 = input[i].second;
     constexpr auto precision = 1e-6;
 
-    auto current = currents[temp_1][temp_2];
+    auto current = solution.currents[3 * i + 1];
     auto rounded_current = (std::abs(current) > precision ? current : 0.0);
 
     if (!non_verbose) {
@@ -225,6 +253,15 @@ int main(int argc, char *argv[]) try {
       std::cout << rounded_current << "\n";
     }
   }
+
+  if (vm.count("report")) {
+    std::cout << "Unknowns: " << report.original_unknowns << ", after reduction: " << report.reduced_unknowns << "\n";
+  }
+
+  if (vm.count("time")) {
+    std::cout << "Solved " << network.edges() << " edges in " << duration << " ms, "
+              << network.edges() / duration * 1000 << " edges/s\n";
+  }
 } catch (std::exception &e) {
   std::cerr << "Encountered error: " << e.what() << "\n";
 } catch (...) {
@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "linear_solver.hpp"
+#include "lu_decomposition.hpp"
+#include "matrix.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/program_options/option.hpp>
+
+namespace po = boost::program_options;
+namespace linmath = throttle::linmath;
+
+namespace {
+
+// Random matrix with elements in [-1, 1] and diag added to the diagonal. The smaller diag, the worse the conditioning.
+linmath::matrix_d make_matrix(std::size_t size, double diag) {
+  std::mt19937                     gen{1};
+  std::uniform_real_distribution<> dist{-1, 1};
+  linmath::matrix_d                mat{size, size};
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      mat[i][j] = dist(gen) + (i == j ? diag : 0);
+    }
+  }
+  return mat;
+}
+
+double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t size;
+  double      diag;
+
+  po::options_description desc("Available options");
+  desc.add_options()("help,h", "Print this help message")(
+      "size,n", po::value<std::size_t>(&size)->default_value(1000), "Size of the system")(
+      "diag,d", po::value<double>(&diag)->default_value(0),
+      "Value added to the diagonal of the random matrix, larger values make it better conditioned");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  const auto          coefs = make_matrix(size, diag);
+  std::vector<double> col(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    col[i] = std::sin(static_cast<double>(i));
+  }
+
+  auto       start = std::chrono::high_resolution_clock::now();
+  const auto direct = linmath::lu_decomposition<double>{coefs}.solve(col);
+  const auto full = elapsed_ms(start);
+  std::cout << "Double LU solve took " << full << "ms\n";
+
+  start = std::chrono::high_resolution_clock::now();
+  const auto mixed = linmath::mixed_precision_solver(coefs, col);
+  const auto refined = elapsed_ms(start);
+  std::cout << "Mixed precision solve took " << refined << "ms, " << full / refined << "x faster, "
+            << mixed.iterations << " refinement steps, " << (mixed.converged ? "converged" : "solved in double")
+            << "\n";
+
+  double max_diff = 0, max_abs = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    max_diff = std::max(max_diff, std::abs(direct[i] - mixed.solution[i]));
+    max_abs = std::max(max_abs, std::abs(direct[i]));
+  }
+  std::cout << "Relative residual: " << mixed.residual << ", maximum relative difference from double solve: "
+            << max_diff / max_abs << "\n";
+}
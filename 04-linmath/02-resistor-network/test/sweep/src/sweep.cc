@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "resistor_network.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/program_options/option.hpp>
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct edge {
+  unsigned first, second;
+  double   resistance, emf;
+};
+
+// Grid of resistors with a source in the corner. With a short circuit, the corners are connected through a zero
+// resistance source.
+std::vector<edge> make_grid(unsigned side, bool short_circuit) {
+  std::vector<edge> edges;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      const auto id = y * side + x;
+      if (x + 1 < side) edges.push_back({id, id + 1, 1.0 + id % 7, (id == 0 ? 10.0 : 0.0)});
+      if (y + 1 < side) edges.push_back({id, id + side, 2.0 + id % 5, 0.0});
+    }
+  }
+  if (short_circuit) edges.push_back({0, side * side - 1, 0.0, 3.0});
+  return edges;
+}
+
+circuits::resistor_network make_network(const std::vector<edge> &edges) {
+  circuits::resistor_network network;
+  for (const auto &e : edges) {
+    network.insert(e.first, e.second, e.resistance, e.emf);
+  }
+  return network;
+}
+
+double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  unsigned    side, steps, tuned;
+  std::size_t max_updates;
+
+  po::options_description desc("Available options");
+  desc.add_options()("help,h", "Print this help message")(
+      "side,n", po::value<unsigned>(&side)->default_value(200), "Number of nodes in a side of the grid")(
+      "steps,s", po::value<unsigned>(&steps)->default_value(1000), "Number of changes in the sweep")(
+      "tuned,t", po::value<unsigned>(&tuned)->default_value(4), "Number of resistors that are tuned")(
+      "max-updates,u", po::value<std::size_t>(&max_updates)->default_value(32),
+      "Changes applied to a factorization before it's computed again")("short", "Add a short circuit");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  auto edges = make_grid(side, vm.count("short"));
+  std::cout << "Grid of " << side * side << " nodes and " << edges.size() << " edges\n";
+
+  auto start = std::chrono::high_resolution_clock::now();
+  make_network(edges).solve();
+  const auto full = elapsed_ms(start);
+  std::cout << "Solving from scratch took " << full << "ms\n";
+
+  start = std::chrono::high_resolution_clock::now();
+  circuits::solved_resistor_network solved{make_network(edges), {.max_updates = max_updates}};
+  std::cout << "Initial solve of the handle took " << elapsed_ms(start) << "ms\n";
+
+  std::mt19937                            gen{1};
+  std::uniform_int_distribution<unsigned> edge_dist{0, static_cast<unsigned>(edges.size()) - 2};
+  std::uniform_real_distribution<>        resistance_dist{0.5, 10};
+
+  std::vector<unsigned> tuned_edges(tuned);
+  std::generate(tuned_edges.begin(), tuned_edges.end(), [&]() { return edge_dist(gen); });
+
+  std::size_t changed = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (unsigned step = 0; step < steps; ++step) {
+    auto &e = edges[tuned_edges[step % tuned]];
+    e.resistance = resistance_dist(gen);
+    solved.update_edge(e.first, e.second, e.resistance, e.emf);
+    changed += solved.resolve().first.size();
+  }
+  const auto sweep = elapsed_ms(start);
+
+  std::cout << "Sweep of " << steps << " changes took " << sweep << "ms, " << sweep / steps << "ms per change, "
+            << full * steps / sweep << "x faster than solving from scratch\n";
+  std::cout << "Changed potentials per step: " << static_cast<double>(changed) / steps << "\n";
+
+  const auto expected = make_network(edges).solve();
+  double     max_diff = 0;
+  for (const auto &[node, potential] : expected.first) {
+    max_diff = std::max(max_diff, std::abs(potential - solved.current().first.at(node)));
+  }
+  std::cout << "Maximum difference of potentials: " << max_diff << "\n";
+}